@@ -9,17 +9,27 @@
 
 #include "asset.h"
 #include "asset_cache.h"
+#include "asset_pool.h"
 #include "collision.h"
 #include "forces.h"
+#include "profiler.h"
+#include "render_snapshot.h"
 #include "sdl_wrapper.h"
+#include "sound_stream.h"
+#include "static_layer.h"
 #include "vector.h"
 
+// The game's own allocations are counted as "other"
+#include "alloc.h"
+
 const vector_t MIN = {0, 0};
 const vector_t MAX = {1000, 1000};
 const double HALFWAY_VERTICAL_DISTANCE = 2600;
 
 // Filepaths
 const char *BACKGROUND_PATH = "assets/background.png";
+// Where profiled builds write their trace on exit
+const char *TRACE_PATH = "trace.json";
 const char *VICTORY_BACKGROUND_PATH = "assets/victory_background.png";
 const char *PAUSE_BUTTON_PATH = "assets/pause_button.png";
 const char *RESET_BUTTON_PATH = "assets/reset_button.png";
@@ -46,6 +56,7 @@ const char *PLATFORM_IMPACT_PATH = "assets/platform_land.wav";
 const char *WALL_IMPACT_PATH = "assets/wall_impact.wav";
 const char *MUSIC_PATH = "assets/Pixel-Drama.wav";
 const char *SPIKE_PATH = "assets/spike.png";
+const char *ASSET_PACK_PATH = "assets/assets.pack";
 
 // User Constants
 const double USER_MASS = 5;
@@ -141,7 +152,8 @@ const double POWERUP_ELASTICITY = 1;
 const size_t JUMP_POWERUP_JUMPS = 2;
 
 // Sound Constants
-const size_t SOUND_SIZE = 5;
+const size_t SOUND_SIZE = 4;
+const size_t SOUND_VOICES = 4; // on the channels from IMPACT_CHANNEL up
 const double HIT_BUFFER = 0.3;
 const double COLLIDING_BUFFER = 0.36;
 const double FALL_BUFFER = 0.2;
@@ -161,9 +173,6 @@ const size_t SPIKE_RADIUS = 150;
 const size_t SPIKE_MASS = 10;
 const double SPIKE_OFFSET = 800;
 const size_t NUM_SPIKES = 3;
-const size_t SPIKE1_INDEX = 0;
-const size_t SPIKE2_INDEX = 1;
-const size_t SPIKE3_INDEX = 2;
 const double SPIKE_ELASTICITY = 0;
 
 // Button and Title Constants
@@ -213,17 +222,19 @@ typedef enum { USER, LEFT_WALL, RIGHT_WALL, PLATFORM, JUMP_POWER,
 typedef enum { GAME_START, GAME_RUNNING, GAME_PAUSED, 
               GAME_OVER, GAME_VICTORY } game_state_t;
 
-typedef enum { GHOST_IMPACT, WIND, GAS_IMPACT, 
+typedef enum { GHOST_IMPACT, GAS_IMPACT, 
               PLATFORM_IMPACT, WALL_IMPACT } sound_type_t;
 
 typedef struct sound {
-  Mix_Chunk *player;
-  sound_type_t *info;
+  sound_handle_t handle;
+  bool loaded; // whether the sound bank has it yet
 } sound_t;
 
 struct state {
   scene_t *scene;
-  list_t *body_assets;
+  asset_pool_t *body_assets;
+  static_layer_t *static_layer; // walls, platforms and the island
+  render_snapshot_t *frame; // what emscripten_main() draws each tick
   asset_t *background_asset;
   asset_t *user_sprite;
   body_t *user;
@@ -243,8 +254,10 @@ struct state {
   body_t *collided_obj; // the object that the user is collided with
   
   size_t jump_powerup_jumps;
-  size_t jump_powerup_index;
-  size_t health_powerup_index;
+  asset_handle_t jump_powerup_asset;
+  asset_handle_t health_powerup_asset;
+  body_handle_t jump_powerup_body;
+  body_handle_t health_powerup_body;
 
   asset_t *start_button;
   asset_t *game_title;
@@ -258,13 +271,14 @@ struct state {
   bool distance_halfpoint;
   bool distance_portal;
 
-  list_t *sounds;
+  list_t *sounds; // indexed by sound_type_t
+  sound_bank_t *sound_bank;
+  sound_stream_t *wind; // streamed, since it is much longer than the rest
   Mix_Music *music;
   double colliding_buffer;
 
-  list_t *spikes;
-  size_t spike2_idx;
-  size_t spike3_idx;
+  asset_pool_t *spikes;
+  asset_handle_t *spike_assets; // indexed by spike number, from SPIKE1
 };
 
 
@@ -275,51 +289,67 @@ struct state {
  * @param sound the pointer to the sound type
 */
 void sound_free(sound_t *sound){
-  Mix_FreeChunk(sound->player);
-  free(sound->info);
+  asset_cache_release_sound(sound->handle);
   free(sound);
 }
 
 /**
  * Initializes all of the sound paths and 
  * stores them inside of the list sounds field
- * in the state
+ * in the state, and defines them in the sound bank
+ * that plays them. The sounds are decoded in the background,
+ * and stay silent until they arrive.
  * 
  * @param state the pointer to the state
 */
 void sound_init(state_t *state){
   list_t *sounds = list_init(SOUND_SIZE, (free_func_t) sound_free);
-  const char* paths[] = {GHOST_HIT_PATH, WIND_PATH, GAS_IMPACT_PATH, 
+  const char* paths[] = {GHOST_HIT_PATH, GAS_IMPACT_PATH, 
                         PLATFORM_IMPACT_PATH, WALL_IMPACT_PATH};
+  // Getting hurt matters most, so it is never cut off by the other sounds
+  const size_t max_instances[] = {2, 2, 1, 1};
+  const int priorities[] = {2, 1, 1, 0};
+  state->sound_bank = sdl_sound_bank_init(SOUND_SIZE, IMPACT_CHANNEL,
+                                          SOUND_VOICES);
   for (size_t i = 0; i < SOUND_SIZE; i++){
     sound_t *sound = malloc(sizeof(sound_t));
-    sound_type_t *info = malloc(sizeof(sound_type_t));
     assert(sound);
-    assert(info);
-    *info = i;
-    sound->info = info;
-    sound->player = sdl_load_sound(paths[i]);
+    sound->handle = asset_cache_preload_sound(paths[i]);
+    sound->loaded = false;
     list_add(sounds, sound);
+    sdl_sound_bank_define(state->sound_bank, i, NULL, max_instances[i],
+                          priorities[i]);
   }
   state->sounds = sounds;
 }
 
 /**
- * Gets the actual sound file from the state from
- * the type passed in
+ * Requests a sound from the sound bank. Requests for the
+ * same sound in one frame are played once, by sound_update.
  * 
  * @param state the pointer to the state
  * @param sound_type the type of sound to be played
 */
-Mix_Chunk *get_sound(state_t *state, sound_type_t sound_type){
-  list_t* sounds = state->sounds;
+void play_sound(state_t *state, sound_type_t sound_type){
+  sdl_sound_bank_play(state->sound_bank, sound_type);
+}
+
+/**
+ * Hands the sounds that have finished loading to the sound
+ * bank, then plays the sounds requested this frame.
+ * 
+ * @param state the pointer to the state
+*/
+void sound_update(state_t *state){
   for (size_t i = 0; i < SOUND_SIZE; i++){
-    sound_t *sound = list_get(sounds, i);
-    if (*(sound->info) == sound_type){
-      return sound->player;
+    sound_t *sound = list_get(state->sounds, i);
+    if (!sound->loaded){
+      Mix_Chunk *chunk = asset_cache_sound(sound->handle);
+      sdl_sound_bank_set(state->sound_bank, i, chunk);
+      sound->loaded = chunk != NULL;
     }
   }
-  return NULL;
+  sdl_sound_bank_update(state->sound_bank);
 }
 
 /**
@@ -531,7 +561,7 @@ void create_walls_and_platforms(state_t *state) {
       scene_add_body(scene, wall);
       asset_t *wall_asset = asset_make_image_with_body(WALL_PATH, wall, 
                                                       VERTICAL_OFFSET);
-      list_add(state->body_assets, wall_asset);
+      static_layer_add(state->static_layer, wall_asset);
     }
   }
 
@@ -544,7 +574,7 @@ void create_walls_and_platforms(state_t *state) {
     asset_t *wall_asset_platform = asset_make_image_with_body(PLATFORM_PATH, 
                                                               platform, 
                                                               VERTICAL_OFFSET);
-    list_add(state->body_assets, wall_asset_platform);
+    static_layer_add(state->static_layer, wall_asset_platform);
     state->collided_obj = platform; // inital start location
   }
 
@@ -564,14 +594,8 @@ void health_powerup_collision(body_t *body1, body_t *body2, vector_t axis,
   state_t *state = aux;
   if (state->user_health < FULL_HEALTH) {
       body_remove(body2);
-      list_remove(state->body_assets, state->health_powerup_index);
+      asset_pool_remove(state->body_assets, state->health_powerup_asset);
       state->user_health++;
-  } else {
-    return;
-  }
-
-  if (state->jump_powerup_index > state->health_powerup_index) {
-    state->jump_powerup_index--;
   }
 }
 
@@ -588,14 +612,10 @@ void jump_powerup_collision(body_t *body1, body_t *body2, vector_t axis,
                             void *aux, double force_const) {
   state_t *state = aux;
   body_remove(body2);
-  list_remove(state->body_assets, state->jump_powerup_index);
+  asset_pool_remove(state->body_assets, state->jump_powerup_asset);
 
   // set number of extra jumps the user can take
   state->jump_powerup_jumps = JUMP_POWERUP_JUMPS;
-
-  if (state->health_powerup_index > state->jump_powerup_index) {
-    state->health_powerup_index--;
-  }
 }
 
 
@@ -610,10 +630,10 @@ void create_jump_power_up(state_t *state) {
   asset_t *powerup_asset = asset_make_image_with_body(JUMP_POWERUP_PATH, 
                                                       powerup, 
                                                       state->vertical_offset);
-  state->jump_powerup_index = list_size(state->body_assets);
+  state->jump_powerup_asset = asset_pool_add(state->body_assets,
+                                             powerup_asset);
   state->jump_powerup_jumps = 0;
-  list_add(state->body_assets, powerup_asset);
-  scene_add_body(state->scene, powerup);
+  state->jump_powerup_body = scene_add_body(state->scene, powerup);
   create_collision(state->scene, state->user, powerup,
                   (collision_handler_t)jump_powerup_collision, 
                         state, POWERUP_ELASTICITY);
@@ -630,9 +650,9 @@ void create_health_power_up(state_t *state) {
   asset_t *powerup_asset = asset_make_image_with_body(HEALTH_POWERUP_PATH, 
                                                       powerup, 
                                                       state->vertical_offset);
-  state->health_powerup_index = list_size(state->body_assets);
-  list_add(state->body_assets, powerup_asset);
-  scene_add_body(state->scene, powerup);
+  state->health_powerup_asset = asset_pool_add(state->body_assets,
+                                               powerup_asset);
+  state->health_powerup_body = scene_add_body(state->scene, powerup);
   create_collision(state->scene, state->user, powerup,
                   (collision_handler_t)health_powerup_collision, 
                   state, POWERUP_ELASTICITY);
@@ -648,7 +668,7 @@ void create_portal(state_t *state) {
                                         make_type_info(PORTAL), NULL);
   asset_t *portal_asset = asset_make_image_with_body(PORTAL_PATH, portal, 
                                                     state->vertical_offset);
-  list_add(state->body_assets, portal_asset);
+  asset_pool_add(state->body_assets, portal_asset);
   scene_add_body(state->scene, portal);
 }
 
@@ -662,7 +682,7 @@ void create_island(state_t *state) {
                                         make_type_info(QUICKSAND_ISLAND), NULL);
   asset_t *island_asset = asset_make_image_with_body(ISLAND_PATH, island, 
                                                     state->vertical_offset);
-  list_add(state->body_assets, island_asset);
+  static_layer_add(state->static_layer, island_asset);
   scene_add_body(state->scene, island);
 }
 
@@ -672,17 +692,18 @@ void create_island(state_t *state) {
  * @param state state object representing the current demo state
 */
 void update_health_bar(state_t *state) {
-  asset_t *health_bar_asset = asset_make_image(FULL_HEALTH_BAR_PATH, HEALTH_BAR_BOX);
+  const char *path = FULL_HEALTH_BAR_PATH;
   
   if (state->user_health == 2) {
-    health_bar_asset = asset_make_image(HEALTH_BAR_2_PATH, HEALTH_BAR_BOX);
+    path = HEALTH_BAR_2_PATH;
   } else if (state->user_health == 1) {
-    health_bar_asset = asset_make_image(HEALTH_BAR_1_PATH, HEALTH_BAR_BOX);
+    path = HEALTH_BAR_1_PATH;
   } else if (state->user_health == 0) {
-    health_bar_asset = asset_make_image(HEALTH_BAR_0_PATH, HEALTH_BAR_BOX);
+    path = HEALTH_BAR_0_PATH;
   }
 
-  state->health_bar = health_bar_asset;
+  // Swap the sprite in place rather than making a new asset every frame
+  asset_set_image(state->health_bar, path);
 }
 
 /**
@@ -704,7 +725,7 @@ void sticky_collision(body_t *body1, body_t *body2, vector_t axis, void *aux,
   state->jumping = false;
   state->collided_obj = body2;
   if (state->colliding_buffer > COLLIDING_BUFFER){
-    Mix_PlayChannel(IMPACT_CHANNEL, get_sound(state, PLATFORM_IMPACT), 0);
+    play_sound(state, PLATFORM_IMPACT);
   }
 
   state->colliding_buffer = 0;
@@ -727,7 +748,7 @@ void damaging_collision(body_t *user, body_t *body, vector_t axis, void *aux,
   if (state->user_immunity > IMMUNITY){
     if (state->user_health >= ONE_HEART){
       state->user_health --;
-      sdl_play_sound(get_sound(state, GHOST_IMPACT));
+      play_sound(state, GHOST_IMPACT);
     }
     state->user_immunity = 0;
   }
@@ -748,28 +769,16 @@ void damaging_collision(body_t *user, body_t *body, vector_t axis, void *aux,
 void spike_collision(body_t *user, body_t *spike, vector_t axis, void *aux,
                 double force_const){
   state_t *state = aux;
+  // Spikes replaced by a restart linger until the next tick ends
+  if (body_is_removed(spike)){
+    return;
+  }
   if (state->user_health >= ONE_HEART){
     state->user_health --;
-    sdl_play_sound(get_sound(state, GHOST_IMPACT));
+    play_sound(state, GHOST_IMPACT);
   }
-  switch (get_type(spike)) {
-    case SPIKE1:{
-      list_remove(state->spikes, SPIKE1_INDEX);
-      state->spike2_idx --;
-      state->spike3_idx --;
-      break;
-    }
-    case SPIKE2:{
-      list_remove(state->spikes, state->spike2_idx);
-      state->spike3_idx --;
-    }
-      break;
-    case SPIKE3:
-      list_remove(state->spikes, state->spike3_idx);
-      break;
-    default:
-      break;
-    }
+  asset_pool_remove(state->spikes, 
+                    state->spike_assets[get_type(spike) - SPIKE1]);
   body_remove(spike);
   state->user_immunity = 0;
 }
@@ -785,7 +794,7 @@ void create_spikes(state_t *state) {
                                           make_type_info(SPIKE1_ENUM + i), NULL);
     asset_t *spike_asset = asset_make_image_with_body(SPIKE_PATH, spike, 
                                                       state->vertical_offset);
-    list_add(state->spikes, spike_asset);
+    state->spike_assets[i] = asset_pool_add(state->spikes, spike_asset);
     create_collision(state->scene, state->user, spike,
                       (collision_handler_t)spike_collision, state, 
                       SPIKE_ELASTICITY);
@@ -825,7 +834,7 @@ void spawn_ghost(state_t *state) {
   create_collision(state->scene, state->user, ghost,
                   (collision_handler_t)damaging_collision, 
                   state, GHOST_ELASTICITY);
-  list_add(state->body_assets, ghost_asset);
+  asset_pool_add(state->body_assets, ghost_asset);
   state->ghost_counter++;
   state->ghost_timer = 0;
 }
@@ -836,12 +845,14 @@ void spawn_ghost(state_t *state) {
  * @param state pointer to the current state of the game
  */
 void ghost_move(state_t *state){
+  if (state->velocity_timer <= VELOCITY_BUFFER){
+    return;
+  }
   scene_t *scene = state->scene;
   size_t num_bodies = scene_bodies(scene);
   for (size_t i = 0; i < num_bodies; i++){
     body_t *body = scene_get_body(scene, i);
-    if (get_type(body) == GHOST && 
-    (state->velocity_timer > VELOCITY_BUFFER)){
+    if (get_type(body) == GHOST){
       vector_t user_center = body_get_centroid(state->user);
       vector_t ghost_center = body_get_centroid(body);
       vector_t direction = vec_unit(vec_add(user_center, 
@@ -851,11 +862,9 @@ void ghost_move(state_t *state){
                                   RAND_VELOCITY, i);
       vector_t rand_velocity = vec_add(velocity, rand_add);
       body_set_velocity(body, rand_velocity);
-      if (i == num_bodies - 1){
-        state->velocity_timer = 0;
-      }
     }
   }
+  state->velocity_timer = 0;
 }
 
 
@@ -871,7 +880,7 @@ void spawn_gas(state_t *state) {
     scene_add_body(state->scene, gas);
     asset_t *gas_asset = asset_make_image_with_body(GAS_PATH, gas, 
                                                     VERTICAL_OFFSET);
-    list_add(state->body_assets, gas_asset);
+    asset_pool_add(state->body_assets, gas_asset);
   }
 }
 
@@ -887,7 +896,9 @@ void spawn_and_move_ghosts(state_t *state) {
   }
 
   if (state->restart_buffer > RESTART_BUFFER){
+    PROFILE_BEGIN("ghost_move");
     ghost_move(state);
+    PROFILE_END("ghost_move");
   }
 }
 
@@ -970,10 +981,6 @@ void reset_button_handler(state_t *state) {
   state->restart_buffer = 0;
   state->distance_halfpoint = false;
 
-
-  bool contains_jump = false;
-  bool contains_health = false;
-
   // Update user and ghost centers
   vector_t user_center = {MIN.x + RADIUS + WALL_WIDTH.x, 
                     MIN.y + RADIUS + PLATFORM_HEIGHT + PLATFORM_LENGTH.y};
@@ -991,27 +998,20 @@ void reset_button_handler(state_t *state) {
       body_set_centroid(body, ghost_center);
       body_set_velocity(body, VEC_ZERO);
     }
-    if (get_type(body) == JUMP_POWER){
-      contains_jump = true;
-    }
-    if (get_type(body) == HEALTH_POWER){
-      contains_health = true;
-    }
     if (get_type(body) == SPIKE1 || get_type(body) == SPIKE2 ||
         get_type(body) == SPIKE3){
       body_remove(body);
     }
   }
-  if (!contains_jump){
+  // Replace the power ups that were picked up
+  if (scene_resolve_body(state->scene, state->jump_powerup_body) == NULL){
     create_jump_power_up(state);
-    
   }
-  if (!contains_health){
+  if (scene_resolve_body(state->scene, state->health_powerup_body) == NULL){
     create_health_power_up(state);
   }
-  state->spikes = list_init(NUM_SPIKES, (free_func_t) asset_destroy);
-  state->spike2_idx = SPIKE2_INDEX;
-  state->spike3_idx = SPIKE3_INDEX;
+  asset_pool_free(state->spikes);
+  state->spikes = asset_pool_init(NUM_SPIKES);
   create_spikes(state);
 }
 
@@ -1159,22 +1159,57 @@ void print_story(state_t *state) {
   }
 }
 
+/**
+ * Packs the sprites drawn while climbing into shared atlas textures,
+ * so a frame of the level draws them without switching textures.
+ */
+static void load_sprite_atlas() {
+  const char *paths[] = {USER_PATH, WALL_PATH, PLATFORM_PATH, JUMP_POWERUP_PATH,
+                         HEALTH_POWERUP_PATH, FULL_HEALTH_BAR_PATH,
+                         HEALTH_BAR_2_PATH, HEALTH_BAR_1_PATH,
+                         HEALTH_BAR_0_PATH, GHOST_PATH, GAS_PATH, PORTAL_PATH,
+                         ISLAND_PATH, SPIKE_PATH, PAUSE_BUTTON_PATH};
+  asset_cache_load_atlas(paths, sizeof(paths) / sizeof(paths[0]));
+}
+
+/**
+ * Starts decoding the large images that aren't on the title screen, so the
+ * title screen appears without waiting for them.
+ */
+static void preload_images() {
+  const char *paths[] = {BACKGROUND_PATH, VICTORY_BACKGROUND_PATH,
+                         VICTORY_TEXT_PATH, RESET_BUTTON_PATH};
+  for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+    // The assets made from these images hold their own handles
+    asset_cache_release_image(asset_cache_preload_image(paths[i]));
+  }
+}
+
 state_t *emscripten_init() {
   sdl_init(MIN, MAX);
   asset_cache_init();
+  // Uses the pre-decoded assets if 'make assets/assets.pack' has been run
+  asset_cache_open_pack(ASSET_PACK_PATH);
+  preload_images();
+  load_sprite_atlas();
   state_t *state = malloc(sizeof(state_t));
   assert(state);
 
   // Initialize scene
   state->scene = scene_init();
-  state->body_assets = list_init(BODY_ASSETS, (free_func_t)asset_destroy);
+  state->body_assets = asset_pool_init(BODY_ASSETS);
+  state->static_layer = static_layer_init();
+  state->frame = render_snapshot_init();
 
   // Initialize sound and music
   Mix_OpenAudio(FREQUENCY, MIX_DEFAULT_FORMAT, STEREO, AUDIO_BUFFER);
   Mix_Volume(DEFAULT_CHANNEL, MIX_MAX_VOLUME/2);
   sound_init(state);
   state->colliding_buffer = 0;
-  Mix_PlayChannel(WIND_CHANNEL, get_sound(state, WIND), LOOPS);
+  state->wind = asset_cache_open_stream(WIND_PATH);
+  if (state->wind != NULL) {
+    sound_stream_play(state->wind, WIND_CHANNEL, LOOPS);
+  }
   state->music = Mix_LoadMUS(MUSIC_PATH);
   
   // Initialize backgrounds
@@ -1196,7 +1231,7 @@ state_t *emscripten_init() {
   create_user(state);
   asset_t *user_asset = asset_make_image_with_body(USER_PATH, state->user, 
                                                   state->vertical_offset);
-  list_add(state->body_assets, user_asset);
+  asset_pool_add(state->body_assets, user_asset);
 
   // Intialize walls and platforms
   create_walls_and_platforms(state);
@@ -1211,10 +1246,10 @@ state_t *emscripten_init() {
   create_island(state);
   
 
-  // Initialize spike idx
-  state->spikes = list_init(NUM_SPIKES, (free_func_t) asset_destroy);
-  state->spike2_idx = SPIKE2_INDEX;
-  state->spike3_idx = SPIKE3_INDEX;
+  // Initialize spikes
+  state->spikes = asset_pool_init(NUM_SPIKES);
+  state->spike_assets = malloc(NUM_SPIKES * sizeof(asset_handle_t));
+  assert(state->spike_assets);
   create_spikes(state);
 
   // Initialize buttons and in-game text
@@ -1264,10 +1299,11 @@ state_t *emscripten_init() {
   return state;
 }
 
-bool emscripten_main(state_t *state) {
+void emscripten_update(state_t *state, double dt,
+                       render_snapshot_t *snapshot) {
+  PROFILE_BEGIN("emscripten_update");
   print_story(state);
 
-  double dt = time_since_last_tick();
   update_buffers(state, dt);
   
   body_t *user = state->user;
@@ -1278,67 +1314,104 @@ bool emscripten_main(state_t *state) {
     body_tick(user, dt);
   }
 
-  sdl_clear();
-
+  PROFILE_BEGIN("check_gravity_and_friction");
   check_gravity_and_friction(state);
+  PROFILE_END("check_gravity_and_friction");
 
   vector_t player_pos = body_get_centroid(user);
   state->vertical_offset = player_pos.y - VERTICAL_OFFSET;
+  double offset = state->vertical_offset;
 
   spawn_and_move_ghosts(state);
   
-  // Render assets
-  asset_render(state->background_asset, state->vertical_offset);
-  for (size_t i = 0; i < list_size(state->body_assets); i++) {
-    asset_render(list_get(state->body_assets, i), state->vertical_offset);
+  // Record assets
+  PROFILE_BEGIN("record_assets");
+  render_snapshot_clear(snapshot, offset);
+  asset_snapshot(state->background_asset, snapshot, offset);
+  render_snapshot_add_layer(snapshot, state->static_layer);
+  for (size_t i = 0; i < asset_pool_slots(state->body_assets); i++) {
+    asset_t *asset = asset_pool_get_slot(state->body_assets, i);
+    if (asset != NULL) {
+      asset_snapshot(asset, snapshot, offset);
+    }
   }
-  for (size_t i = 0; i < list_size(state->spikes); i++) {
-    asset_render(list_get(state->spikes, i), state->vertical_offset);
+  for (size_t i = 0; i < asset_pool_slots(state->spikes); i++) {
+    asset_t *spike = asset_pool_get_slot(state->spikes, i);
+    if (spike != NULL) {
+      asset_snapshot(spike, snapshot, offset);
+    }
   }
   update_health_bar(state);
-  asset_render(state->health_bar, state->vertical_offset);
+  asset_snapshot(state->health_bar, snapshot, offset);
 
-  // Render buttons and/or title based on game state
+  // Record buttons and/or title based on game state
   if (state->game_state == GAME_START) {
-    asset_render(state->game_title, state->vertical_offset);
-    asset_render(state->start_button, state->vertical_offset);
+    asset_snapshot(state->game_title, snapshot, offset);
+    asset_snapshot(state->start_button, snapshot, offset);
   } else if (state->game_state == GAME_RUNNING) {
-    asset_render(state->pause_button, state->vertical_offset);
+    asset_snapshot(state->pause_button, snapshot, offset);
   } else if (state->game_state == GAME_PAUSED) {
-    asset_render(state->pause_button, state->vertical_offset);
-    asset_render(state->reset_button, state->vertical_offset);
+    asset_snapshot(state->pause_button, snapshot, offset);
+    asset_snapshot(state->reset_button, snapshot, offset);
   } else if (state->game_state == GAME_OVER) {
-    asset_render(state->reset_button, state->vertical_offset);
+    asset_snapshot(state->reset_button, snapshot, offset);
   } else if (state->game_state == GAME_VICTORY) {
     state->distance_halfpoint = false;
     state->distance_portal = false;
-    asset_render(state->victory_background, state->vertical_offset);
-    asset_render(state->reset_button, state->vertical_offset);
-    asset_render(state->victory_text, state->vertical_offset);
+    asset_snapshot(state->victory_background, snapshot, offset);
+    asset_snapshot(state->reset_button, snapshot, offset);
+    asset_snapshot(state->victory_text, snapshot, offset);
   }
+  PROFILE_END("record_assets");
 
+  sound_update(state);
   if (Mix_PlayingMusic() == 0) {
     Mix_PlayMusic(state->music, -1);
     Mix_VolumeMusic(MUSIC_VOLUME);
   }
 
-  sdl_show(state->vertical_offset);
-
   if (state->user_health == 0) {
     state->game_state = GAME_OVER;
   }
+  PROFILE_END("emscripten_update");
+}
+
+bool emscripten_main(state_t *state) {
+  double dt = time_since_last_tick();
+  emscripten_update(state, dt, state->frame);
 
+  render_snapshot_resolve(state->frame);
+  sdl_clear();
+  render_snapshot_draw(state->frame);
+  sdl_show(state->vertical_offset);
   return false;
 }
 
 void emscripten_free(state_t *state) {
-  TTF_Quit();
+#ifdef PROFILE
+  frame_timer_print(sdl_get_frame_timer(), stdout);
+#endif
+  PROFILE_WRITE(TRACE_PATH);
+  PROFILE_SHUTDOWN();
+  sdl_sound_bank_free(state->sound_bank);
   list_free(state->sounds);
+  if (state->wind != NULL) {
+    sound_stream_close(state->wind);
+  }
   Mix_FreeMusic(state->music);
+  static_layer_free(state->static_layer);
+  render_snapshot_free(state->frame);
   scene_free(state->scene);
-  list_free(state->body_assets);
-  list_free(state->spikes);
+  asset_pool_free(state->body_assets);
+  asset_destroy(state->health_bar);
+  asset_pool_free(state->spikes);
+  free(state->spike_assets);
   body_free(state->user);
   asset_cache_destroy();
   free(state);
+  sdl_quit();
+#ifdef TRACK_ALLOC
+  // Anything still live here was leaked
+  alloc_report(stdout);
+#endif
 }
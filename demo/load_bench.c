@@ -0,0 +1,95 @@
+#include <SDL2/SDL.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "asset_pack.h"
+#include "sdl_wrapper.h"
+
+/**
+ * Compares how long it takes to load every asset in a pack from its PNG or
+ * WAV file against loading it from the pack, including opening the pack.
+ *
+ * Usage (from the repository root): bin/load_bench [pack] [rounds]
+ * where pack defaults to assets/assets.pack (see 'make assets/assets.pack').
+ */
+
+const vector_t LOAD_BENCH_MIN = {0, 0};
+const vector_t LOAD_BENCH_MAX = {1000, 500};
+const char *DEFAULT_PACK_PATH = "assets/assets.pack";
+const size_t DEFAULT_ROUNDS = 10;
+const double MS_PER_SECOND = 1000;
+
+/** Returns the seconds since an earlier performance counter value */
+double seconds_since(uint64_t start) {
+  return (double)(SDL_GetPerformanceCounter() - start) /
+         SDL_GetPerformanceFrequency();
+}
+
+/** Loads every asset in the pack from its original file */
+double load_from_files(asset_pack_t *pack) {
+  uint64_t start = SDL_GetPerformanceCounter();
+  for (size_t i = 0; i < asset_pack_size(pack); i++) {
+    const pack_entry_t *entry = asset_pack_get(pack, i);
+    if (entry->type == PACK_IMAGE) {
+      SDL_Texture *texture = sdl_load_image(entry->path);
+      assert(texture != NULL);
+      SDL_DestroyTexture(texture);
+    } else {
+      Mix_Chunk *sound = Mix_LoadWAV(entry->path);
+      assert(sound != NULL);
+      Mix_FreeChunk(sound);
+    }
+  }
+  return seconds_since(start);
+}
+
+/** Opens the pack and loads every asset in it */
+double load_from_pack(const char *pack_path) {
+  uint64_t start = SDL_GetPerformanceCounter();
+  asset_pack_t *pack = asset_pack_open(pack_path);
+  assert(pack != NULL);
+  for (size_t i = 0; i < asset_pack_size(pack); i++) {
+    const pack_entry_t *entry = asset_pack_get(pack, i);
+    if (entry->type == PACK_IMAGE) {
+      SDL_Surface *image = asset_pack_image(pack, entry->path);
+      SDL_Texture *texture = sdl_create_texture(image);
+      assert(texture != NULL);
+      SDL_FreeSurface(image);
+      SDL_DestroyTexture(texture);
+    } else {
+      Mix_Chunk *sound = asset_pack_sound(pack, entry->path);
+      assert(sound != NULL);
+      Mix_FreeChunk(sound);
+    }
+  }
+  asset_pack_close(pack);
+  return seconds_since(start);
+}
+
+int main(int argc, char *argv[]) {
+  const char *pack_path = argc > 1 ? argv[1] : DEFAULT_PACK_PATH;
+  size_t rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_ROUNDS;
+  assert(rounds > 0);
+
+  sdl_init_headless(LOAD_BENCH_MIN, LOAD_BENCH_MAX, LOAD_BENCH_MAX.x,
+                    LOAD_BENCH_MAX.y);
+  asset_pack_t *pack = asset_pack_open(pack_path);
+  if (pack == NULL) {
+    fprintf(stderr, "Could not open the pack %s\n", pack_path);
+    return 1;
+  }
+
+  double file_time = 0, pack_time = 0;
+  for (size_t round = 0; round < rounds; round++) {
+    file_time += load_from_files(pack);
+    pack_time += load_from_pack(pack_path);
+  }
+  printf("assets: %zu\n", asset_pack_size(pack));
+  printf("files: %.3f ms\n", file_time / rounds * MS_PER_SECOND);
+  printf("pack: %.3f ms\n", pack_time / rounds * MS_PER_SECOND);
+  printf("speedup: %.1fx\n", file_time / pack_time);
+
+  asset_pack_close(pack);
+  return 0;
+}
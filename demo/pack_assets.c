@@ -0,0 +1,169 @@
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asset_pack.h"
+
+/**
+ * Builds an asset pack (see include/asset_pack.h) from PNG and WAV files,
+ * decoding each image to PACK_PIXEL_FORMAT and converting each sound to the
+ * format the game opens the mixer with.
+ *
+ * Usage (from the repository root): bin/pack_assets out.pack file...
+ * Each asset is stored under the path it is given by, so the paths should be
+ * the ones the game loads, e.g. assets/wall.png.
+ */
+
+/**
+ * An asset read into memory, waiting to be written to the pack.
+ */
+typedef struct packed_asset {
+  pack_entry_t entry;
+  void *data;
+} packed_asset_t;
+
+/** Whether a path ends with the given extension */
+bool has_extension(const char *path, const char *extension) {
+  size_t path_length = strlen(path), extension_length = strlen(extension);
+  return path_length >= extension_length &&
+         strcmp(path + path_length - extension_length, extension) == 0;
+}
+
+/** Decodes an image into rows of PACK_PIXEL_FORMAT pixels */
+bool pack_image(const char *path, packed_asset_t *asset) {
+  SDL_Surface *image = IMG_Load(path);
+  if (image == NULL) {
+    return false;
+  }
+  SDL_Surface *converted = SDL_ConvertSurfaceFormat(image, PACK_PIXEL_FORMAT, 0);
+  SDL_FreeSurface(image);
+  if (converted == NULL) {
+    return false;
+  }
+
+  // Store the rows without the padding SDL may have added to them
+  uint32_t pitch = converted->w * 4;
+  asset->entry.type = PACK_IMAGE;
+  asset->entry.image.format = PACK_PIXEL_FORMAT;
+  asset->entry.image.width = converted->w;
+  asset->entry.image.height = converted->h;
+  asset->entry.image.pitch = pitch;
+  asset->entry.size = (uint64_t)pitch * converted->h;
+  asset->data = malloc(asset->entry.size);
+  assert(asset->data);
+  for (int y = 0; y < converted->h; y++) {
+    memcpy((uint8_t *)asset->data + y * pitch,
+           (uint8_t *)converted->pixels + y * converted->pitch, pitch);
+  }
+  SDL_FreeSurface(converted);
+  return true;
+}
+
+/** Decodes a sound and converts it to the mixer's format */
+bool pack_sound(const char *path, packed_asset_t *asset) {
+  SDL_AudioSpec spec;
+  Uint8 *samples;
+  Uint32 length;
+  if (SDL_LoadWAV(path, &spec, &samples, &length) == NULL) {
+    return false;
+  }
+  SDL_AudioStream *stream =
+      SDL_NewAudioStream(spec.format, spec.channels, spec.freq,
+                         PACK_AUDIO_FORMAT, PACK_AUDIO_CHANNELS,
+                         PACK_AUDIO_FREQUENCY);
+  if (stream == NULL || SDL_AudioStreamPut(stream, samples, length) != 0 ||
+      SDL_AudioStreamFlush(stream) != 0) {
+    SDL_FreeWAV(samples);
+    return false;
+  }
+  SDL_FreeWAV(samples);
+
+  asset->entry.type = PACK_SOUND;
+  asset->entry.sound.format = PACK_AUDIO_FORMAT;
+  asset->entry.sound.frequency = PACK_AUDIO_FREQUENCY;
+  asset->entry.sound.channels = PACK_AUDIO_CHANNELS;
+  asset->entry.size = SDL_AudioStreamAvailable(stream);
+  asset->data = malloc(asset->entry.size);
+  assert(asset->data);
+  SDL_AudioStreamGet(stream, asset->data, asset->entry.size);
+  SDL_FreeAudioStream(stream);
+  return true;
+}
+
+int compare_assets(const void *a, const void *b) {
+  return strcmp(((const packed_asset_t *)a)->entry.path,
+                ((const packed_asset_t *)b)->entry.path);
+}
+
+/** Rounds an offset up to a multiple of PACK_ALIGNMENT */
+uint64_t align_offset(uint64_t offset) {
+  return (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "Usage: %s out.pack file...\n", argv[0]);
+    return 1;
+  }
+  size_t num_assets = argc - 2;
+  packed_asset_t *assets = calloc(num_assets, sizeof(packed_asset_t));
+  assert(assets);
+
+  for (size_t i = 0; i < num_assets; i++) {
+    const char *path = argv[i + 2];
+    if (strlen(path) >= PACK_PATH_LENGTH) {
+      fprintf(stderr, "Path too long: %s\n", path);
+      return 1;
+    }
+    strcpy(assets[i].entry.path, path);
+    bool packed = false;
+    if (has_extension(path, ".png")) {
+      packed = pack_image(path, &assets[i]);
+    } else if (has_extension(path, ".wav")) {
+      packed = pack_sound(path, &assets[i]);
+    }
+    if (!packed) {
+      fprintf(stderr, "Could not pack %s: %s\n", path, SDL_GetError());
+      return 1;
+    }
+  }
+  qsort(assets, num_assets, sizeof(packed_asset_t), compare_assets);
+
+  FILE *file = fopen(argv[1], "wb");
+  if (file == NULL) {
+    fprintf(stderr, "Could not write %s\n", argv[1]);
+    return 1;
+  }
+  pack_header_t header = {.version = PACK_VERSION, .num_entries = num_assets};
+  memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+
+  // Lay out the data after the index, then write the index and the data
+  uint64_t index_end = sizeof(header) + num_assets * sizeof(pack_entry_t);
+  uint64_t offset = index_end;
+  for (size_t i = 0; i < num_assets; i++) {
+    assets[i].entry.offset = align_offset(offset);
+    offset = assets[i].entry.offset + assets[i].entry.size;
+  }
+  fwrite(&header, sizeof(header), 1, file);
+  for (size_t i = 0; i < num_assets; i++) {
+    fwrite(&assets[i].entry, sizeof(pack_entry_t), 1, file);
+  }
+  static const uint8_t padding[PACK_ALIGNMENT] = {0};
+  offset = index_end;
+  for (size_t i = 0; i < num_assets; i++) {
+    fwrite(padding, 1, assets[i].entry.offset - offset, file);
+    fwrite(assets[i].data, 1, assets[i].entry.size, file);
+    offset = assets[i].entry.offset + assets[i].entry.size;
+    free(assets[i].data);
+  }
+  fclose(file);
+
+  printf("Packed %zu assets into %s (%llu bytes)\n", num_assets, argv[1],
+         (unsigned long long)offset);
+  free(assets);
+  return 0;
+}
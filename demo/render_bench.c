@@ -0,0 +1,155 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "asset.h"
+#include "asset_cache.h"
+#include "body.h"
+#include "scene.h"
+#include "sdl_wrapper.h"
+
+/**
+ * Renders a fixed, deterministic scene offscreen and reports how long each
+ * frame took to draw, along with a checksum of every frame drawn.
+ * The checksum only changes when what the render path draws changes.
+ *
+ * Usage (from the repository root): bin/render_bench [frames] [frame.bmp]
+ * where frame.bmp, if given, is where the last frame is saved.
+ */
+
+const vector_t BENCH_MIN = {0, 0};
+const vector_t BENCH_MAX = {1000, 500};
+const int BENCH_WIDTH = 1000;
+const int BENCH_HEIGHT = 500;
+const size_t DEFAULT_FRAMES = 300;
+const unsigned BENCH_SEED = 3;
+const double BENCH_DT = 1.0 / 60;
+const double MS_PER_SECOND = 1000;
+
+const size_t NUM_SHAPES = 400;
+const size_t STAR_POINTS = 6;
+const double STAR_OUTER_RADIUS = 12;
+const double STAR_INNER_RADIUS = 5;
+const double SHAPE_MASS = 1;
+const double MAX_SPEED = 200;
+// Every SPRITE_INTERVAL-th shape is drawn as a sprite instead of a polygon
+const size_t SPRITE_INTERVAL = 4;
+const char *BENCH_SPRITE_PATH = "assets/body.png";
+
+/** Returns a random double in [min, max) */
+double rand_range(double min, double max) {
+  return min + (max - min) * rand() / ((double)RAND_MAX + 1);
+}
+
+/**
+ * Makes a star, a concave shape, so that polygons are triangulated by
+ * ear clipping rather than as fans.
+ */
+list_t *make_star(vector_t center) {
+  list_t *points = list_init(2 * STAR_POINTS, free);
+  for (size_t i = 0; i < 2 * STAR_POINTS; i++) {
+    double angle = M_PI * i / STAR_POINTS;
+    double radius = i % 2 == 0 ? STAR_OUTER_RADIUS : STAR_INNER_RADIUS;
+    vector_t *point = malloc(sizeof(*point));
+    assert(point);
+    *point = (vector_t){center.x + radius * cos(angle),
+                        center.y + radius * sin(angle)};
+    list_add(points, point);
+  }
+  return points;
+}
+
+/** Reverses a body's velocity along any edge of the scene it has crossed */
+void bounce(body_t *body) {
+  vector_t centroid = body_get_centroid(body);
+  vector_t velocity = body_get_velocity(body);
+  if ((centroid.x < BENCH_MIN.x && velocity.x < 0) ||
+      (centroid.x > BENCH_MAX.x && velocity.x > 0)) {
+    velocity.x = -velocity.x;
+  }
+  if ((centroid.y < BENCH_MIN.y && velocity.y < 0) ||
+      (centroid.y > BENCH_MAX.y && velocity.y > 0)) {
+    velocity.y = -velocity.y;
+  }
+  body_set_velocity(body, velocity);
+}
+
+int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[]) {
+  size_t num_frames = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_FRAMES;
+  const char *dump_path = argc > 2 ? argv[2] : NULL;
+  assert(num_frames > 0);
+
+  sdl_init_headless(BENCH_MIN, BENCH_MAX, BENCH_WIDTH, BENCH_HEIGHT);
+  asset_cache_init();
+  srand(BENCH_SEED);
+
+  scene_t *scene = scene_init();
+  list_t *sprites = list_init(NUM_SHAPES / SPRITE_INTERVAL,
+                              (free_func_t)asset_destroy);
+  for (size_t i = 0; i < NUM_SHAPES; i++) {
+    vector_t center = {rand_range(BENCH_MIN.x, BENCH_MAX.x),
+                       rand_range(BENCH_MIN.y, BENCH_MAX.y)};
+    rgb_color_t color = {rand_range(0, 1), rand_range(0, 1), rand_range(0, 1)};
+    body_t *body = body_init(make_star(center), SHAPE_MASS, color);
+    body_set_velocity(body, (vector_t){rand_range(-MAX_SPEED, MAX_SPEED),
+                                       rand_range(-MAX_SPEED, MAX_SPEED)});
+    scene_add_body(scene, body);
+    if (i % SPRITE_INTERVAL == 0) {
+      list_add(sprites, asset_make_image_with_body(BENCH_SPRITE_PATH, body, 0));
+    }
+  }
+
+  double *frame_times = malloc(num_frames * sizeof(double));
+  assert(frame_times);
+  uint32_t checksum = 0;
+  for (size_t frame = 0; frame < num_frames; frame++) {
+    scene_tick(scene, BENCH_DT);
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+      bounce(scene_get_body(scene, i));
+    }
+
+    sdl_clear();
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+      if (i % SPRITE_INTERVAL != 0) {
+        body_t *body = scene_get_body(scene, i);
+        sdl_draw_polygon(body_get_polygon(body), *body_get_color(body), 0);
+      }
+    }
+    for (size_t i = 0; i < list_size(sprites); i++) {
+      asset_render(list_get(sprites, i), 0);
+    }
+    // Fold every frame into the checksum, so any differing frame shows up
+    checksum = checksum * 31 + sdl_frame_checksum();
+    if (dump_path != NULL && frame == num_frames - 1) {
+      if (!sdl_save_frame(dump_path)) {
+        fprintf(stderr, "Could not save %s\n", dump_path);
+      }
+    }
+    sdl_show(0);
+    frame_times[frame] = sdl_get_frame_time() * MS_PER_SECOND;
+  }
+
+  double total = 0;
+  for (size_t i = 0; i < num_frames; i++) {
+    total += frame_times[i];
+  }
+  qsort(frame_times, num_frames, sizeof(double), compare_doubles);
+  printf("frames: %zu\n", num_frames);
+  printf("mean: %.3f ms\n", total / num_frames);
+  printf("p50: %.3f ms\n", frame_times[num_frames / 2]);
+  printf("p95: %.3f ms\n", frame_times[num_frames * 95 / 100]);
+  printf("max: %.3f ms\n", frame_times[num_frames - 1]);
+  printf("checksum: %08x\n", checksum);
+
+  free(frame_times);
+  list_free(sprites);
+  scene_free(scene);
+  asset_cache_destroy();
+  return 0;
+}
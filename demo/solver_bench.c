@@ -0,0 +1,150 @@
+#include <SDL2/SDL.h>
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "forces.h"
+#include "scene.h"
+
+/**
+ * Drops columns of stacked boxes onto the ground and lets them settle under
+ * gravity, then reports how long the contact solver took per contact point
+ * per iteration and how far the top boxes drifted once they had settled.
+ * The time is that of the whole scene_tick(), which also finds the contact
+ * manifolds and ticks the bodies, so it overstates the cost of one iteration
+ * most when there are few iterations.
+ *
+ * Usage (from the repository root):
+ * bin/solver_bench [iterations] [height] [columns] [ticks]
+ */
+
+const size_t DEFAULT_ITERATIONS = 2;
+const size_t DEFAULT_HEIGHT = 3;
+const size_t DEFAULT_COLUMNS = 1;
+const size_t DEFAULT_TICKS = 600;
+const double SOLVER_BENCH_DT = 1.0 / 60;
+const double NS_PER_SECOND = 1e9;
+
+const vector_t SOLVER_BENCH_GRAVITY = {0, -1000};
+const double BOX_SIZE = 50;
+const double BOX_MASS = 1;
+// Boxes start this far apart, so they fall a little onto each other
+const double BOX_GAP = 2;
+// Each box is shifted sideways by this much from the one below it
+const double BOX_OFFSET = 3;
+// Columns are spaced this far apart, so neighbouring columns never touch
+const double COLUMN_SPACING = 100;
+const double GROUND_HEIGHT = 100;
+const double BOX_FRICTION = 0.5;
+const double BOX_ELASTICITY = 0;
+const rgb_color_t BOX_COLOR = {0, 0, 0};
+
+/** Returns the seconds since an earlier performance counter value */
+double seconds_since(uint64_t start) {
+  return (double)(SDL_GetPerformanceCounter() - start) /
+         SDL_GetPerformanceFrequency();
+}
+
+/** Makes an axis-aligned rectangle with the given center and size */
+list_t *make_box(vector_t center, double width, double height) {
+  vector_t corners[] = {{center.x - width / 2, center.y - height / 2},
+                        {center.x + width / 2, center.y - height / 2},
+                        {center.x + width / 2, center.y + height / 2},
+                        {center.x - width / 2, center.y + height / 2}};
+  size_t num_corners = sizeof(corners) / sizeof(corners[0]);
+  list_t *points = list_init(num_corners, free);
+  for (size_t i = 0; i < num_corners; i++) {
+    vector_t *point = malloc(sizeof(*point));
+    assert(point);
+    *point = corners[i];
+    list_add(points, point);
+  }
+  return points;
+}
+
+int main(int argc, char *argv[]) {
+  size_t iterations =
+      argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_ITERATIONS;
+  size_t height = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_HEIGHT;
+  size_t columns = argc > 3 ? strtoul(argv[3], NULL, 10) : DEFAULT_COLUMNS;
+  size_t ticks = argc > 4 ? strtoul(argv[4], NULL, 10) : DEFAULT_TICKS;
+  assert(iterations > 0 && height > 0 && columns > 0 && ticks > 1);
+
+  scene_t *scene = scene_init();
+  force_fields_add_uniform(scene_get_force_fields(scene),
+                           SOLVER_BENCH_GRAVITY);
+  contact_solver_t *solver = create_contact_solver(scene, iterations);
+
+  double width = columns * COLUMN_SPACING;
+  body_t *ground = body_init(
+      make_box((vector_t){width / 2, -GROUND_HEIGHT / 2}, width, GROUND_HEIGHT),
+      INFINITY, BOX_COLOR);
+  scene_add_body(scene, ground);
+
+  body_t **tops = malloc(columns * sizeof(body_t *));
+  assert(tops);
+  for (size_t column = 0; column < columns; column++) {
+    body_t *below = ground;
+    for (size_t level = 0; level < height; level++) {
+      vector_t center = {(column + 0.5) * COLUMN_SPACING + level * BOX_OFFSET,
+                         (level + 0.5) * BOX_SIZE + (level + 1) * BOX_GAP};
+      body_t *box =
+          body_init(make_box(center, BOX_SIZE, BOX_SIZE), BOX_MASS, BOX_COLOR);
+      scene_add_body(scene, box);
+      contact_solver_add_pair(solver, below, box, BOX_ELASTICITY,
+                              BOX_FRICTION);
+      below = box;
+    }
+    tops[column] = below;
+  }
+
+  // The first half of the ticks lets the stacks settle; the second half is
+  // timed, and any movement of the top boxes during it is drift
+  size_t settle_ticks = ticks / 2;
+  for (size_t tick = 0; tick < settle_ticks; tick++) {
+    scene_tick(scene, SOLVER_BENCH_DT);
+  }
+  vector_t *settled = malloc(columns * sizeof(vector_t));
+  assert(settled);
+  for (size_t column = 0; column < columns; column++) {
+    settled[column] = body_get_centroid(tops[column]);
+  }
+
+  double solve_time = 0;
+  size_t contact_iterations = 0;
+  double max_drift = 0, max_speed = 0;
+  for (size_t tick = settle_ticks; tick < ticks; tick++) {
+    uint64_t start = SDL_GetPerformanceCounter();
+    scene_tick(scene, SOLVER_BENCH_DT);
+    solve_time += seconds_since(start);
+    contact_iterations += contact_solver_num_contacts(solver) * iterations;
+
+    for (size_t column = 0; column < columns; column++) {
+      vector_t moved =
+          vec_subtract(body_get_centroid(tops[column]), settled[column]);
+      max_drift = fmax(max_drift, vec_get_length(moved));
+      max_speed =
+          fmax(max_speed, vec_get_length(body_get_velocity(tops[column])));
+    }
+  }
+
+  size_t timed_ticks = ticks - settle_ticks;
+  printf("boxes: %zu (%zu columns of %zu)\n", columns * height, columns,
+         height);
+  printf("iterations: %zu\n", iterations);
+  printf("contacts: %zu\n", contact_solver_num_contacts(solver));
+  printf("tick: %.0f ns\n", solve_time / timed_ticks * NS_PER_SECOND);
+  if (contact_iterations > 0) {
+    printf("per contact: %.1f ns\n",
+           solve_time / (contact_iterations / iterations) * NS_PER_SECOND);
+    printf("per contact per iteration: %.1f ns\n",
+           solve_time / contact_iterations * NS_PER_SECOND);
+  }
+  printf("top drift: %.3f (max speed %.3f)\n", max_drift, max_speed);
+
+  free(settled);
+  free(tops);
+  scene_free(scene);
+  return 0;
+}
@@ -0,0 +1,164 @@
+#ifndef __ALLOC_H__
+#define __ALLOC_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Accounting for the memory the library allocates, by subsystem.
+ *
+ * When compiled with -DTRACK_ALLOC (run 'make clean' then
+ * 'make TRACK_ALLOC=true all'), every malloc(), calloc(), realloc() and free()
+ * in a file that includes this header goes through a tracking allocator,
+ * which counts allocations and bytes per frame, live bytes and the most bytes
+ * ever live, for the subsystem the file is tagged with. The storage of the
+ * arrays from vec.h is counted under ALLOC_CONTAINERS wherever they are
+ * defined. Otherwise the functions below still exist, but every count
+ * stays 0.
+ *
+ * Each library file tags itself by defining ALLOC_TAG and then including
+ * this header after all of its other headers:
+ * ```
+ * #include "scene.h"
+ * #include "vec.h"
+ *
+ * #define ALLOC_TAG ALLOC_PHYSICS
+ * #include "alloc.h"
+ * ```
+ * Memory must be freed by a file that tracks allocations if and only if it
+ * was allocated by one, which holds as long as the library frees what it
+ * allocates and the caller frees what it allocates.
+ */
+
+typedef enum {
+  ALLOC_OTHER,
+  ALLOC_CONTAINERS,
+  ALLOC_PHYSICS,
+  ALLOC_COLLISION,
+  ALLOC_RENDER,
+  ALLOC_ASSETS,
+  ALLOC_AUDIO,
+  ALLOC_PROFILING,
+  NUM_ALLOC_TAGS
+} alloc_tag_t;
+
+/**
+ * Allocation statistics for one subsystem, or all of them.
+ */
+typedef struct {
+  /** Allocations (including reallocations) during the last frame */
+  size_t frame_allocs;
+  /** Bytes requested by those allocations */
+  size_t frame_bytes;
+  /** Bytes allocated and not yet freed */
+  size_t live_bytes;
+  /** The most bytes that have been live at once */
+  size_t peak_bytes;
+  /** Allocations since the program started */
+  size_t total_allocs;
+} alloc_stats_t;
+
+/**
+ * Allocates memory on behalf of a subsystem, like malloc().
+ * Files that include this header call it through malloc().
+ *
+ * @param size the number of bytes to allocate
+ * @param tag the subsystem allocating the memory
+ * @return the memory, or NULL if it couldn't be allocated
+ */
+void *alloc_malloc(size_t size, alloc_tag_t tag);
+
+/**
+ * Allocates zeroed memory on behalf of a subsystem, like calloc().
+ *
+ * @param count the number of elements to allocate
+ * @param size the size of each element
+ * @param tag the subsystem allocating the memory
+ * @return the memory, or NULL if it couldn't be allocated
+ */
+void *alloc_calloc(size_t count, size_t size, alloc_tag_t tag);
+
+/**
+ * Resizes memory from alloc_malloc(), like realloc().
+ * The memory is counted against the given subsystem afterwards.
+ *
+ * @param ptr the memory to resize, or NULL to allocate new memory
+ * @param size the new size, in bytes
+ * @param tag the subsystem resizing the memory
+ * @return the resized memory, or NULL if it couldn't be resized,
+ *   in which case ptr is left alone
+ */
+void *alloc_realloc(void *ptr, size_t size, alloc_tag_t tag);
+
+/**
+ * Frees memory from alloc_malloc(), alloc_calloc() or alloc_realloc(),
+ * like free(). Has the same type as free(), so it can be used as a freer.
+ *
+ * @param ptr the memory to free, or NULL
+ */
+void alloc_free(void *ptr);
+
+/**
+ * Gets the name of a subsystem, for reports.
+ *
+ * @param tag the subsystem
+ * @return the subsystem's name
+ */
+const char *alloc_tag_name(alloc_tag_t tag);
+
+/**
+ * Gets the allocation statistics of a subsystem.
+ *
+ * @param tag the subsystem
+ * @return the subsystem's statistics
+ */
+alloc_stats_t alloc_get_stats(alloc_tag_t tag);
+
+/**
+ * Gets the allocation statistics of every subsystem together.
+ * The peak is the sum of each subsystem's peak, so it may never have
+ * actually been live at once.
+ *
+ * @return the statistics, summed over every subsystem
+ */
+alloc_stats_t alloc_get_total_stats(void);
+
+/**
+ * Sets how many allocations a frame may make. alloc_end_frame() asserts that
+ * no frame makes more, so a change that allocates on a path that should
+ * allocate nothing, once the game is running, is caught right away.
+ *
+ * @param max_allocs the most allocations per frame, e.g. 0 after loading,
+ *   or SIZE_MAX for no budget, which is the default
+ */
+void alloc_set_frame_budget(size_t max_allocs);
+
+/**
+ * Ends the current frame's statistics and starts the next frame's.
+ * Called by sdl_show(). Asserts that the frame kept to its budget,
+ * after printing the subsystems' statistics if it didn't.
+ */
+void alloc_end_frame(void);
+
+/**
+ * Prints the statistics of every subsystem.
+ *
+ * @param out the stream to print to
+ */
+void alloc_report(FILE *out);
+
+#ifdef TRACK_ALLOC
+#ifndef ALLOC_TAG
+#define ALLOC_TAG ALLOC_OTHER
+#endif
+#define malloc(size) alloc_malloc(size, ALLOC_TAG)
+#define calloc(count, size) alloc_calloc(count, size, ALLOC_TAG)
+#define realloc(ptr, size) alloc_realloc(ptr, size, ALLOC_TAG)
+// Not a function-like macro, so free can still be passed as a freer
+#define free alloc_free
+#endif
+
+#endif // #ifndef __ALLOC_H__
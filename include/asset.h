@@ -7,7 +7,16 @@
 #include <sdl_wrapper.h>
 #include <stddef.h>
 
-typedef enum { ASSET_IMAGE, ASSET_FONT, ASSET_BUTTON } asset_type_t;
+/**
+ * A frame recorded for drawing later (see render_snapshot.h)
+ */
+typedef struct render_snapshot render_snapshot_t;
+
+/**
+ * The type of an asset, or of an asset cache entry. Sounds are only ever
+ * cache entries, never assets.
+ */
+typedef enum { ASSET_IMAGE, ASSET_FONT, ASSET_BUTTON, ASSET_SOUND } asset_type_t;
 
 typedef struct asset asset_t;
 
@@ -19,6 +28,14 @@ typedef struct asset asset_t;
  */
 asset_type_t asset_get_type(asset_t *asset);
 
+/**
+ * Gets the body an image asset is drawn on top of.
+ *
+ * @param asset a pointer to the asset
+ * @return the asset's body, or NULL if it isn't an image with a body
+ */
+body_t *asset_get_body(asset_t *asset);
+
 /**
  * Allocates memory for an image asset with the given parameters.
  *
@@ -40,6 +57,17 @@ asset_t *asset_make_image(const char *filepath, SDL_Rect bounding_box);
  */
 asset_t *asset_make_image_with_body(const char *filepath, body_t *body, double vertical_offset);
 
+/**
+ * Changes the image an image asset draws, without allocating a new asset.
+ * If the image is cached, this neither allocates nor loads anything.
+ *
+ * Asserts that the asset is an image.
+ *
+ * @param asset the image asset
+ * @param filepath the filepath to the new image file
+ */
+void asset_set_image(asset_t *asset, const char *filepath);
+
 /**
  * Allocates memory for a text asset with the given parameters.
  *
@@ -52,6 +80,21 @@ asset_t *asset_make_image_with_body(const char *filepath, body_t *body, double v
  */
 asset_t *asset_make_text(const char *filepath, SDL_Rect bounding_box, const char *text, rgb_color_t color);
 
+/**
+ * Allocates memory for a text asset whose text changes often, like a score
+ * or a timer. The text is drawn glyph by glyph from an atlas of the font
+ * rather than rasterized whenever it changes, so `text` may point to a buffer
+ * that the caller rewrites between frames.
+ *
+ * @param filepath the filepath to the .ttf file
+ * @param bounding_box the bounding box containing the location of the text
+ * @param text the text to render, which must outlive the asset
+ * @param color the color of the text
+ * @return a pointer to the newly allocated text asset
+ */
+asset_t *asset_make_dynamic_text(const char *filepath, SDL_Rect bounding_box,
+                                 const char *text, rgb_color_t color);
+
 /**
  * A button handler function pointer type.
  *
@@ -96,6 +139,19 @@ bool asset_on_button_click(asset_t *button, state_t *state, double x, double y);
  */
 void asset_render(asset_t *asset, double vertical_offset);
 
+/**
+ * Records the asset into a snapshot instead of drawing it, so the frame can be
+ * drawn later by render_snapshot_draw(), possibly on another thread.
+ * Bodies are read now, and text is copied, so the snapshot doesn't refer to
+ * the asset.
+ *
+ * @param asset the asset to record
+ * @param snapshot the snapshot to add the asset to
+ * @param vertical_offset the vertical offset to apply during rendering
+ */
+void asset_snapshot(asset_t *asset, render_snapshot_t *snapshot,
+                    double vertical_offset);
+
 /**
  * Frees the memory allocated for the asset.
  *
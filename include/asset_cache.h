@@ -2,11 +2,43 @@
 #define __ASSET_CACHE_H__
 
 #include "asset.h"
+#include "sdl_wrapper.h"
+#include "sound_stream.h"
 #include <stddef.h>
 
 /**
- * Initializes the empty, list-based global asset cache. The caller must then
- * destroy the cache with `asset_cache_destroy` when done.
+ * A handle to an image in the asset cache. Handles are just indices, so
+ * getting the sprite for one never searches the cache. The handle {0} refers
+ * to no image.
+ *
+ * Each handle the cache returns holds a reference to its entry, which the
+ * caller releases when done with it. Entries with no references may be
+ * evicted, least recently used first, to keep the cache within its memory
+ * budget. A handle stays valid after its asset is evicted: the asset is
+ * loaded again the next time the handle is used.
+ */
+typedef struct image_handle {
+  size_t id;
+} image_handle_t;
+
+/**
+ * A handle to a font in the asset cache (see image_handle_t).
+ */
+typedef struct font_handle {
+  size_t id;
+} font_handle_t;
+
+/**
+ * A handle to a sound in the asset cache (see image_handle_t).
+ */
+typedef struct sound_handle {
+  size_t id;
+} sound_handle_t;
+
+/**
+ * Initializes the empty, hash map based global asset cache, and starts the
+ * background asset loader. The caller must then destroy the cache with
+ * `asset_cache_destroy` when done.
  */
 void asset_cache_init();
 
@@ -15,28 +47,203 @@ void asset_cache_init();
  */
 void asset_cache_destroy();
 
+/**
+ * Sets how many bytes the cache's textures and sounds may use, approximately,
+ * before unreferenced ones are evicted. Evicts right away if the cache is
+ * already over the new budget. The default is 64 MiB.
+ *
+ * Referenced assets are never evicted, so the cache can stay over its budget
+ * while they are in use. Atlas sprites and fonts don't count towards it.
+ *
+ * @param bytes the budget, in bytes
+ */
+void asset_cache_set_budget(size_t bytes);
+
+/**
+ * Gets how many bytes the cache's loaded textures and sounds use.
+ *
+ * @return the approximate bytes in use
+ */
+size_t asset_cache_get_usage();
+
+/**
+ * Opens an asset pack (see asset_pack.h). From then on, images and sounds in
+ * the pack are created from its pre-decoded data instead of being loaded
+ * from their files; everything else is still loaded from its file.
+ * Should be called once, right after `asset_cache_init`. The pack is closed
+ * by `asset_cache_destroy`.
+ *
+ * @param filepath the path to the pack
+ * @return whether the pack was opened; if not, all assets come from files
+ */
+bool asset_cache_open_pack(const char *filepath);
+
+/**
+ * Opens a long sound for streaming instead of loading it (see sound_stream.h).
+ * The stream reads the sound's pre-decoded samples from the pack if it is
+ * there, and its file otherwise. The stream isn't cached; the caller closes
+ * it with sound_stream_close, before destroying the cache.
+ *
+ * @param filepath the filepath to the sound
+ * @return the stream, or NULL if the sound couldn't be opened
+ */
+sound_stream_t *asset_cache_open_stream(const char *filepath);
+
+/**
+ * Gets a handle to the image at the given filepath. If the image isn't cached
+ * yet, it is loaded the first time asset_cache_image is called for the
+ * handle, so that its texture is created on the thread that draws.
+ * Looking up a path takes constant time on average.
+ *
+ * The cache keeps its own copy of the path, so the caller's string only has
+ * to live until this returns.
+ *
+ * @param filepath the filepath to the image
+ * @return a handle to the image, to release with asset_cache_release_image
+ */
+image_handle_t asset_cache_get_image(const char *filepath);
+
+/**
+ * Gets a handle to the image at the given filepath like
+ * asset_cache_get_image, but if the image isn't cached yet, decodes it in the
+ * background instead of waiting for it (see asset_loader.h). Until the image
+ * arrives, its sprite has a NULL texture and assets using it draw nothing.
+ *
+ * Later calls to asset_cache_get_image for the path return the same entry
+ * without loading the image again.
+ *
+ * @param filepath the filepath to the image
+ * @return a handle to the image, to release with asset_cache_release_image
+ */
+image_handle_t asset_cache_preload_image(const char *filepath);
+
+/**
+ * Gets a handle to the font at the given filepath, loading the font if it
+ * isn't cached yet (see asset_cache_get_image).
+ *
+ * @param filepath the filepath to the font
+ * @return a handle to the font, to release with asset_cache_release_font
+ */
+font_handle_t asset_cache_get_font(const char *filepath);
+
+/**
+ * Gets a handle to the sound at the given filepath, loading the sound if it
+ * isn't cached yet (see asset_cache_get_image).
+ *
+ * @param filepath the filepath to the sound
+ * @return a handle to the sound, to release with asset_cache_release_sound
+ */
+sound_handle_t asset_cache_get_sound(const char *filepath);
+
+/**
+ * Gets a handle to the sound at the given filepath, decoding it in the
+ * background if it isn't cached yet (see asset_cache_preload_image).
+ * Until it arrives, asset_cache_sound returns NULL for the handle.
+ *
+ * @param filepath the filepath to the sound
+ * @return a handle to the sound, to release with asset_cache_release_sound
+ */
+sound_handle_t asset_cache_preload_sound(const char *filepath);
+
+/**
+ * Takes another reference to an image, which must be released separately
+ * with asset_cache_release_image.
+ *
+ * @param handle a handle from asset_cache_get_image
+ */
+void asset_cache_retain_image(image_handle_t handle);
+
+/**
+ * Releases a handle from asset_cache_get_image or asset_cache_preload_image.
+ * The handle must not be used afterwards. An image with no references left is
+ * only evicted when the cache next loads something, so releasing one never
+ * destroys a texture.
+ *
+ * @param handle the handle to release
+ */
+void asset_cache_release_image(image_handle_t handle);
+
+/**
+ * Releases a handle from asset_cache_get_font.
+ *
+ * @param handle the handle to release
+ */
+void asset_cache_release_font(font_handle_t handle);
+
+/**
+ * Releases a handle from asset_cache_get_sound or asset_cache_preload_sound.
+ *
+ * @param handle the handle to release
+ */
+void asset_cache_release_sound(sound_handle_t handle);
+
+/**
+ * Gets the sprite that an image handle refers to, loading the image if it
+ * isn't loaded yet or was evicted. Since that creates a texture, and loading
+ * may evict others, this must only be called on the thread that draws.
+ * The sprite stays the same for the life of the cache, but
+ * its texture may change whenever an image is loaded or evicted.
+ *
+ * @param handle a handle from asset_cache_get_image
+ * @return the image's sprite
+ */
+sprite_t *asset_cache_image(image_handle_t handle);
+
+/**
+ * Gets the font that a font handle refers to.
+ *
+ * @param handle a handle from asset_cache_get_font
+ * @return the font
+ */
+TTF_Font *asset_cache_font(font_handle_t handle);
+
+/**
+ * Gets the sound that a sound handle refers to, loading it again if it was
+ * evicted.
+ *
+ * @param handle a handle from asset_cache_get_sound
+ * @return the sound, or NULL if it couldn't be loaded or is still loading
+ */
+Mix_Chunk *asset_cache_sound(sound_handle_t handle);
+
 /**
  * Gets the pointer to the object that is associated with the given filepath.
  * If the object exists, asserts that its type matches the given type.
  *
  * If the object doesn't exist, adds a new entry to the asset cache and returns
- * the pointer to the newly created object.
+ * the pointer to the newly created object. Asserts that `ty` isn't
+ * ASSET_BUTTON; buttons are registered with asset_cache_register_button.
  *
  * Example:
  * ```
  * char *img_path = "assets/image.png";
- * SDL_Texture *obj = asset_cache_obj_get_or_create(ASSET_IMAGE, img_path);
+ * sprite_t *obj = asset_cache_obj_get_or_create(ASSET_IMAGE, img_path);
  *
  * char *font_path = "assets/font.ttf";
  * TTF_Font *obj = asset_cache_obj_get_or_create(ASSET_FONT, font_path);
  * ```
  *
+ * The object is never evicted, since no handle to it is ever released.
+ *
  * @param ty the type of the asset
  * @param filepath the filepath to the asset
  * @return the object that corresponds to the filepath, as a void*
  */
 void *asset_cache_obj_get_or_create(asset_type_t ty, const char *filepath);
 
+/**
+ * Loads several images at once, packing them into shared atlas textures.
+ * Later calls to `asset_cache_obj_get_or_create` for these images return
+ * sprites that refer to a region of an atlas, so drawing them one after
+ * another doesn't switch textures. Images already in the cache are skipped.
+ *
+ * Should be called once at startup with the images that are drawn every frame.
+ *
+ * @param filepaths the filepaths to the images
+ * @param num_images the number of images
+ */
+void asset_cache_load_atlas(const char **filepaths, size_t num_images);
+
 /**
  * Registers the button to the asset cache, effectively activating its button
  * handler. When this function is called, the asset_cache takes ownership of the
@@ -0,0 +1,82 @@
+#ifndef __ASSET_LOADER_H__
+#define __ASSET_LOADER_H__
+
+#include "asset_pack.h"
+#include <SDL2/SDL_mixer.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Called on the main thread once an asset has loaded.
+ *
+ * @param result the loaded SDL_Texture or Mix_Chunk, which now belongs to the
+ *   callback, or NULL if the file couldn't be loaded
+ * @param aux the auxiliary value passed when the load was requested
+ */
+typedef void (*load_callback_t)(void *result, void *aux);
+
+/**
+ * Starts the worker threads that decode images and sounds in the background.
+ * Under emscripten, which has no threads here, loads are instead run one at a
+ * time by asset_loader_poll(). The caller must stop the loader with
+ * `asset_loader_free` when done. The loader's functions are all called from
+ * the main thread; only the decoding happens elsewhere.
+ */
+void asset_loader_init(void);
+
+/**
+ * Stops the worker threads, waiting for any decode in progress. Loads that
+ * haven't been delivered are discarded without calling their callbacks.
+ */
+void asset_loader_free(void);
+
+/**
+ * Sets a pack of pre-decoded assets (see asset_pack.h). Loads of assets in
+ * the pack need no decoding, so they skip the workers and are delivered by
+ * the next asset_loader_poll().
+ *
+ * @param pack the pack, or NULL for none; must stay open until the loader is
+ *   freed
+ */
+void asset_loader_use_pack(asset_pack_t *pack);
+
+/**
+ * Requests that an image be decoded in the background. Its texture is created
+ * on the main thread by asset_loader_poll(), which then calls the callback.
+ *
+ * @param filepath the path to the image; copied, so it needn't outlive the call
+ * @param callback called with the SDL_Texture once it is created
+ * @param aux passed to the callback
+ */
+void asset_loader_load_image(const char *filepath, load_callback_t callback,
+                             void *aux);
+
+/**
+ * Requests that a sound be decoded in the background.
+ * The audio device must already be open.
+ *
+ * @param filepath the path to the sound; copied, so it needn't outlive the call
+ * @param callback called with the Mix_Chunk by asset_loader_poll()
+ * @param aux passed to the callback
+ */
+void asset_loader_load_sound(const char *filepath, load_callback_t callback,
+                             void *aux);
+
+/**
+ * Delivers the loads that have finished: creates the textures of decoded
+ * images and calls the callbacks. Must be called from the thread that draws,
+ * once per frame.
+ *
+ * @return the number of loads delivered
+ */
+size_t asset_loader_poll(void);
+
+/**
+ * Gets how much of what has been requested so far has been delivered.
+ *
+ * @return the fraction of requested loads delivered, from 0 to 1;
+ *   1 if nothing is pending
+ */
+double asset_loader_progress(void);
+
+#endif // #ifndef __ASSET_LOADER_H__
@@ -0,0 +1,147 @@
+#ifndef __ASSET_PACK_H__
+#define __ASSET_PACK_H__
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * An asset pack holds images and sounds that have already been decoded, so
+ * loading them needs no PNG or WAV decoding. bin/pack_assets builds a pack
+ * (see demo/pack_assets.c), and the game maps it into memory and creates
+ * textures and sounds straight from the mapped bytes.
+ *
+ * A pack starts with a pack_header_t, followed by num_entries pack_entry_t
+ * sorted by path, followed by the data of each entry at the offset its entry
+ * gives. Integers are stored in the byte order of the machine that packed
+ * them, and each entry's data is aligned to PACK_ALIGNMENT bytes.
+ */
+#define PACK_MAGIC "CS3P"
+#define PACK_VERSION 1
+#define PACK_PATH_LENGTH 104
+#define PACK_ALIGNMENT 64
+
+/**
+ * The pixel format of packed images, which renderers accept without
+ * converting it.
+ */
+#define PACK_PIXEL_FORMAT SDL_PIXELFORMAT_ARGB8888
+
+/**
+ * The format of packed sounds, which must match the one the mixer is opened
+ * with for them to be used without decoding.
+ */
+#define PACK_AUDIO_FREQUENCY 44100
+#define PACK_AUDIO_FORMAT MIX_DEFAULT_FORMAT
+#define PACK_AUDIO_CHANNELS 2
+
+typedef enum { PACK_IMAGE, PACK_SOUND } pack_entry_type_t;
+
+typedef struct pack_header {
+  char magic[4];
+  uint32_t version;
+  uint32_t num_entries;
+  uint32_t reserved;
+} pack_header_t;
+
+typedef struct pack_entry {
+  // The path the asset was packed from, e.g. "assets/wall.png"
+  char path[PACK_PATH_LENGTH];
+  uint32_t type;
+  union {
+    // Rows of PACK_PIXEL_FORMAT pixels, pitch bytes apart
+    struct {
+      uint32_t format;
+      uint32_t width;
+      uint32_t height;
+      uint32_t pitch;
+    } image;
+    // Interleaved samples, as the mixer plays them
+    struct {
+      uint32_t format;
+      uint32_t frequency;
+      uint32_t channels;
+      uint32_t reserved;
+    } sound;
+  };
+  uint64_t offset;
+  uint64_t size;
+} pack_entry_t;
+
+typedef struct asset_pack asset_pack_t;
+
+/**
+ * Maps an asset pack into memory.
+ *
+ * @param filepath the path to the pack
+ * @return the pack, or NULL if it doesn't exist or isn't a valid pack
+ */
+asset_pack_t *asset_pack_open(const char *filepath);
+
+/**
+ * Unmaps an asset pack. Any sound from asset_pack_sound() must be freed
+ * first, since its samples are the pack's memory.
+ *
+ * @param pack the pack to close
+ */
+void asset_pack_close(asset_pack_t *pack);
+
+/**
+ * Gets the number of assets in a pack.
+ *
+ * @param pack the pack
+ * @return the number of entries
+ */
+size_t asset_pack_size(asset_pack_t *pack);
+
+/**
+ * Gets an entry of a pack by its position, in order of path.
+ *
+ * @param pack the pack
+ * @param index the position of the entry
+ * @return the entry
+ */
+const pack_entry_t *asset_pack_get(asset_pack_t *pack, size_t index);
+
+/**
+ * Finds the entry for a path, by binary search.
+ *
+ * @param pack the pack
+ * @param filepath the path the asset was packed from
+ * @return the entry, or NULL if the pack doesn't have one for the path
+ */
+const pack_entry_t *asset_pack_find(asset_pack_t *pack, const char *filepath);
+
+/**
+ * Gets the data of an entry, which is the pack's read-only memory.
+ *
+ * @param pack the pack
+ * @param entry an entry of the pack
+ * @return the entry's size bytes of data
+ */
+const void *asset_pack_data(asset_pack_t *pack, const pack_entry_t *entry);
+
+/**
+ * Gets a surface for a packed image whose pixels are the pack's memory,
+ * which is read-only. The caller frees the surface (but not its pixels)
+ * with SDL_FreeSurface, before closing the pack.
+ *
+ * @param pack the pack
+ * @param filepath the path the image was packed from
+ * @return the surface, or NULL if the image isn't in the pack
+ */
+SDL_Surface *asset_pack_image(asset_pack_t *pack, const char *filepath);
+
+/**
+ * Gets a sound whose samples are the pack's memory.
+ * The caller frees it with Mix_FreeChunk, before closing the pack.
+ *
+ * @param pack the pack
+ * @param filepath the path the sound was packed from
+ * @return the sound, or NULL if it isn't in the pack or was packed in a
+ *   different format from the one the mixer is using
+ */
+Mix_Chunk *asset_pack_sound(asset_pack_t *pack, const char *filepath);
+
+#endif // #ifndef __ASSET_PACK_H__
@@ -0,0 +1,100 @@
+#ifndef __ASSET_POOL_H__
+#define __ASSET_POOL_H__
+
+#include "asset.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A pool of assets that are referred to by generational handles.
+ * Each asset lives in a slot, and its handle is the slot's index plus the
+ * slot's generation, which changes whenever the slot's asset is removed.
+ * Adding, removing and looking up an asset take constant time, removing one
+ * never moves the others, and a handle to a removed asset is detected as
+ * stale instead of finding whatever asset has taken its slot.
+ */
+typedef struct asset_pool asset_pool_t;
+
+typedef struct asset_handle {
+  uint32_t index;
+  uint32_t generation;
+} asset_handle_t;
+
+/**
+ * A handle that never refers to an asset.
+ */
+extern const asset_handle_t ASSET_HANDLE_NONE;
+
+/**
+ * Allocates memory for an empty pool.
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @param initial_capacity the number of slots to allocate at first
+ * @return a pointer to the newly allocated pool
+ */
+asset_pool_t *asset_pool_init(size_t initial_capacity);
+
+/**
+ * Releases the memory allocated for a pool, destroying the assets in it.
+ *
+ * @param pool a pointer to a pool returned from asset_pool_init()
+ */
+void asset_pool_free(asset_pool_t *pool);
+
+/**
+ * Adds an asset to a pool, which takes ownership of it.
+ * Reuses the slot of a removed asset if there is one.
+ *
+ * @param pool a pointer to a pool returned from asset_pool_init()
+ * @param asset the asset to add
+ * @return a handle to the asset
+ */
+asset_handle_t asset_pool_add(asset_pool_t *pool, asset_t *asset);
+
+/**
+ * Gets the asset a handle refers to.
+ *
+ * @param pool a pointer to a pool returned from asset_pool_init()
+ * @param handle a handle returned from asset_pool_add()
+ * @return the asset, or NULL if the handle is stale
+ */
+asset_t *asset_pool_get(asset_pool_t *pool, asset_handle_t handle);
+
+/**
+ * Removes an asset from a pool and destroys it. Its handle, and any copy of
+ * it, becomes stale.
+ *
+ * @param pool a pointer to a pool returned from asset_pool_init()
+ * @param handle a handle returned from asset_pool_add()
+ * @return whether an asset was removed; false if the handle was stale
+ */
+bool asset_pool_remove(asset_pool_t *pool, asset_handle_t handle);
+
+/**
+ * Gets the number of assets in a pool.
+ *
+ * @param pool a pointer to a pool returned from asset_pool_init()
+ * @return the number of assets
+ */
+size_t asset_pool_size(asset_pool_t *pool);
+
+/**
+ * Gets the number of slots in a pool, to iterate over its assets with
+ * asset_pool_get_slot().
+ *
+ * @param pool a pointer to a pool returned from asset_pool_init()
+ * @return the number of slots, used or not
+ */
+size_t asset_pool_slots(asset_pool_t *pool);
+
+/**
+ * Gets the asset in a slot of a pool.
+ *
+ * @param pool a pointer to a pool returned from asset_pool_init()
+ * @param index the index of the slot, less than asset_pool_slots(pool)
+ * @return the asset in the slot, or NULL if the slot is unused
+ */
+asset_t *asset_pool_get_slot(asset_pool_t *pool, size_t index);
+
+#endif // #ifndef __ASSET_POOL_H__
@@ -45,12 +45,13 @@ void body_free(body_t *body);
 
 /**
  * Gets the current shape of a body.
- * Returns a newly allocated vector list, which must be list_free()d.
+ * Returns the body's own vertices, which must not be freed and change as the
+ * body moves.
  *
  * @param body a pointer to a body returned from body_init()
  * @return the polygon describing the body's current position
  */
-list_t *body_get_shape(body_t *body);
+vertex_list_t *body_get_shape(body_t *body);
 
 /**
  * Gets the current center of mass of a body.
@@ -127,6 +128,17 @@ void body_set_color(body_t *body, rgb_color_t *col);
  */
 void body_set_centroid(body_t *body, vector_t x);
 
+/**
+ * Gets the axis-aligned bounding box of a body's shape.
+ * The box is cached by the body and kept up to date as it moves and rotates,
+ * so this is cheap enough to call for every body every frame.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param min where to store the bottom left corner of the box
+ * @param max where to store the top right corner of the box
+ */
+void body_get_bounds(body_t *body, vector_t *min, vector_t *max);
+
 /**
  * Changes a body's velocity (the time-derivative of its position).
  *
@@ -20,8 +20,38 @@ typedef struct {
    * If collided is false, this value is undefined.
    */
   vector_t axis;
+  /**
+   * If the shapes are colliding, how far they overlap along the axis.
+   * If collided is false, this value is undefined.
+   */
+  double depth;
 } collision_info_t;
 
+/** The most points of contact two convex polygons can touch at */
+#define MAX_CONTACT_POINTS 2
+
+/**
+ * The points at which two colliding bodies touch.
+ * With the collision normal, this is everything a contact solver
+ * needs to push the bodies apart.
+ */
+typedef struct {
+  /** Whether the two bodies are colliding */
+  bool collided;
+  /**
+   * A unit vector pointing from the first body towards the second,
+   * perpendicular to the touching surfaces.
+   * If collided is false, this value is undefined.
+   */
+  vector_t normal;
+  /** The number of valid entries in points and depths */
+  size_t num_contacts;
+  /** The contact points, in scene coordinates */
+  vector_t points[MAX_CONTACT_POINTS];
+  /** How far each contact point has penetrated, along the normal */
+  double depths[MAX_CONTACT_POINTS];
+} contact_manifold_t;
+
 /**
  * Computes the status of the collision between two bodies.
  *
@@ -32,4 +62,17 @@ typedef struct {
  */
 collision_info_t find_collision(body_t *body1, body_t *body2);
 
+/**
+ * Computes the contact manifold between two bodies:
+ * the collision normal and the (at most two) points where they touch.
+ * Points are found by clipping the edge of one body that faces the other
+ * against the side planes of the other body's facing edge.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return the contact manifold;
+ *   num_contacts is 0 if the bodies aren't colliding
+ */
+contact_manifold_t find_contact_manifold(body_t *body1, body_t *body2);
+
 #endif // #ifndef __COLLISION_H__
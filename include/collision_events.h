@@ -0,0 +1,118 @@
+#ifndef __COLLISION_EVENTS_H__
+#define __COLLISION_EVENTS_H__
+
+#include "body.h"
+#include "vector.h"
+#include <stddef.h>
+
+/**
+ * A function called when a collision occurs.
+ * @param body1 the first body passed to create_collision()
+ * @param body2 the second body passed to create_collision()
+ * @param axis a unit vector pointing from body1 towards body2
+ *   that defines the direction the two bodies are colliding in
+ * @param aux the auxiliary value passed to create_collision()
+ * @param force_const the force constant passed to create_collision()
+ */
+typedef void (*collision_handler_t)(body_t *body1, body_t *body2, vector_t axis,
+                                    void *aux, double force_const);
+
+typedef enum { COLLISION_BEGIN, COLLISION_END } collision_event_type_t;
+
+/**
+ * A change in whether two bodies are touching, found during detection.
+ */
+typedef struct {
+  collision_event_type_t type;
+  body_t *body1;
+  body_t *body2;
+  /** The collision axis, from body1 towards body2 (undefined for an end) */
+  vector_t axis;
+  /** How far the bodies overlap along the axis (0 for an end) */
+  double depth;
+  /** The id of the handler, from collision_events_handler_id() */
+  size_t handler;
+  void *aux;
+  double force_const;
+} collision_event_t;
+
+/**
+ * A queue of collision events, stored in a ring buffer.
+ * Collision detection only pushes events, and the handlers run later when the
+ * queue is dispatched, so every pair is tested against the same world and
+ * handlers can't change the result of another pair's test.
+ * Each scene owns one (see scene_get_collision_events()), which scene_tick()
+ * dispatches once all of its force creators have run.
+ */
+typedef struct collision_events collision_events_t;
+
+/**
+ * Allocates memory for an empty queue.
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @param capacity the number of events to make room for up front;
+ *   the queue grows if a tick produces more
+ * @return a pointer to the newly allocated queue
+ */
+collision_events_t *collision_events_init(size_t capacity);
+
+/**
+ * Releases the memory allocated for a queue.
+ * Events that were never dispatched are dropped.
+ *
+ * @param events a pointer to a queue returned from collision_events_init()
+ */
+void collision_events_free(collision_events_t *events);
+
+/**
+ * Gets the id of a handler, registering it the first time it is seen.
+ * Ids are small integers, so events don't store function pointers.
+ *
+ * @param events a pointer to a queue returned from collision_events_init()
+ * @param handler the function to call for the handler's begin events
+ * @return the handler's id
+ */
+size_t collision_events_handler_id(collision_events_t *events,
+                                   collision_handler_t handler);
+
+/**
+ * Sets a function to call when two bodies that collided with a handler
+ * separate. End events for handlers without one are dropped.
+ *
+ * @param events a pointer to a queue returned from collision_events_init()
+ * @param handler_id an id returned from collision_events_handler_id()
+ * @param end_handler the function to call, or NULL for none;
+ *   its axis is undefined
+ */
+void collision_events_set_end_handler(collision_events_t *events,
+                                      size_t handler_id,
+                                      collision_handler_t end_handler);
+
+/**
+ * Adds an event to the back of a queue, growing it if it is full.
+ *
+ * @param events a pointer to a queue returned from collision_events_init()
+ * @param event the event to add
+ */
+void collision_events_push(collision_events_t *events,
+                           collision_event_t event);
+
+/**
+ * Gets the number of events waiting to be dispatched.
+ *
+ * @param events a pointer to a queue returned from collision_events_init()
+ * @return the number of queued events
+ */
+size_t collision_events_pending(collision_events_t *events);
+
+/**
+ * Calls the handler of every queued event, in the order they were pushed,
+ * and empties the queue. Events pushed by a handler are dispatched too.
+ * A handler may remove bodies, so handlers should check body_is_removed()
+ * if a later event in the same tick could involve a removed body.
+ *
+ * @param events a pointer to a queue returned from collision_events_init()
+ */
+void collision_events_dispatch(collision_events_t *events);
+
+#endif // #ifndef __COLLISION_EVENTS_H__
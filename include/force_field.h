@@ -0,0 +1,106 @@
+#ifndef __FORCE_FIELD_H__
+#define __FORCE_FIELD_H__
+
+#include "body.h"
+#include "list.h"
+#include "vector.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A set of force fields that act on every body inside their region.
+ * Each scene owns one (see scene_get_force_fields()), which is applied to all
+ * of the scene's bodies in a single pass at the start of scene_tick(),
+ * so adding a field costs no per-body force creators.
+ * Bodies with mass INFINITY are never affected.
+ */
+typedef struct force_field_set force_field_set_t;
+
+/**
+ * Allocates memory for an empty set of force fields.
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @return a pointer to the newly allocated set
+ */
+force_field_set_t *force_fields_init(void);
+
+/**
+ * Releases the memory allocated for a set of force fields.
+ *
+ * @param fields a pointer to a set returned from force_fields_init()
+ */
+void force_fields_free(force_field_set_t *fields);
+
+/**
+ * Gets the number of fields in a set, including disabled ones.
+ *
+ * @param fields a pointer to a set returned from force_fields_init()
+ * @return the number of fields added to the set
+ */
+size_t force_fields_size(force_field_set_t *fields);
+
+/**
+ * Adds a field that accelerates every body uniformly, e.g. gravity.
+ * The force on each body is its mass times the acceleration.
+ *
+ * @param fields a pointer to a set returned from force_fields_init()
+ * @param acceleration the acceleration of every body
+ * @return the id of the new field
+ */
+size_t force_fields_add_uniform(force_field_set_t *fields,
+                                vector_t acceleration);
+
+/**
+ * Adds an axis-aligned region of wind.
+ * Bodies whose centroid lies in the region are dragged towards the wind's
+ * velocity with force drag * (wind - velocity), like create_drag()
+ * in a moving medium. A zero wind makes a plain drag region.
+ *
+ * @param fields a pointer to a set returned from force_fields_init()
+ * @param min the bottom left corner of the region
+ * @param max the top right corner of the region
+ * @param wind the velocity of the wind
+ * @param drag the proportionality constant between force and relative velocity
+ * @return the id of the new field
+ */
+size_t force_fields_add_wind(force_field_set_t *fields, vector_t min,
+                             vector_t max, vector_t wind, double drag);
+
+/**
+ * Adds a radial field that pulls bodies towards (or pushes them away from)
+ * a point. The acceleration falls off linearly from strength at the center
+ * to 0 at the given radius, outside of which bodies are unaffected.
+ *
+ * @param fields a pointer to a set returned from force_fields_init()
+ * @param center the center of the field
+ * @param radius the distance from the center at which the field ends
+ * @param strength the acceleration at the center;
+ *   positive attracts bodies and negative repels them
+ * @return the id of the new field
+ */
+size_t force_fields_add_radial(force_field_set_t *fields, vector_t center,
+                               double radius, double strength);
+
+/**
+ * Turns a field on or off without removing it from the set.
+ * Fields are enabled when they are added.
+ *
+ * @param fields a pointer to a set returned from force_fields_init()
+ * @param id the id returned when the field was added
+ * @param enabled whether the field should act on bodies
+ */
+void force_fields_set_enabled(force_field_set_t *fields, size_t id,
+                              bool enabled);
+
+/**
+ * Adds the force of every enabled field to the bodies it acts on.
+ * Called by scene_tick(); only needed directly for bodies outside a scene.
+ *
+ * @param fields a pointer to a set returned from force_fields_init()
+ * @param bodies an array of body_t pointers
+ * @param num_bodies the number of bodies
+ */
+void force_fields_apply(force_field_set_t *fields, body_t **bodies,
+                        size_t num_bodies);
+
+#endif // #ifndef __FORCE_FIELD_H__
@@ -2,20 +2,9 @@
 #define __FORCES_H__
 
 #include "collision.h"
+#include "collision_events.h"
 #include "scene.h"
 
-/**
- * A function called when a collision occurs.
- * @param body1 the first body passed to create_collision()
- * @param body2 the second body passed to create_collision()
- * @param axis a unit vector pointing from body1 towards body2
- *   that defines the direction the two bodies are colliding in
- * @param aux the auxiliary value passed to create_collision()
- * @param force_const the force constant passed to create_collision()
- */
-typedef void (*collision_handler_t)(body_t *body1, body_t *body2, vector_t axis,
-                                    void *aux, double force_const);
-
 /**
  * Adds a force creator to a scene that applies gravity between two bodies.
  * The force creator will be called each tick
@@ -57,6 +46,8 @@ list_t *get_bodies_from_aux(void *aux);
  * The force creator will be called each tick
  * to compute the Hooke's-Law spring force between the bodies.
  * See https://en.wikipedia.org/wiki/Hooke%27s_law.
+ * For many springs or stiff springs, use a spring network instead
+ * (see spring_network.h).
  *
  * @param scene the scene containing the bodies
  * @param k the Hooke's constant for the spring
@@ -85,6 +76,9 @@ void create_drag(scene_t *scene, double gamma, body_t *body);
  * allowing different things to happen on a collision.
  * The handler is passed the bodies, the collision axis, and an auxiliary value.
  * It should only be called once while the bodies are still colliding.
+ * The force creator only queues the collision (see collision_events.h);
+ * the handler runs when the scene dispatches its events, after every
+ * force creator has run.
  *
  * @param scene the scene containing the bodies
  * @param body1 the first body
@@ -110,8 +104,9 @@ void create_collision(scene_t *scene, body_t *body1, body_t *body2,
 void create_destructive_collision(scene_t *scene, body_t *body1, body_t *body2);
 
 /**
- * The collision handler for for physics collisions. Applies impulses to
- * bodies according to the elasticity in `aux`.
+ * The collision handler for physics collisions.
+ * Stops both bodies the first time they collide; use a contact solver
+ * (see create_contact_solver()) to resolve contacts with impulses.
  */
 void physics_collision_handler(body_t *body1, body_t *body2, vector_t axis,
                                void *aux, double force_const);
@@ -136,4 +131,62 @@ void physics_collision_handler(body_t *body1, body_t *body2, vector_t axis,
 void create_physics_collision(scene_t *scene, body_t *body1, body_t *body2,
                               double elasticity);
 
+/**
+ * A solver that keeps pairs of bodies from passing through each other,
+ * using sequential impulses over the pairs' contact manifolds.
+ * Impulses accumulated at each contact point are carried over to the next
+ * tick (warm starting), so resting contacts settle within a few iterations.
+ */
+typedef struct contact_solver contact_solver_t;
+
+/**
+ * Adds a contact solver to a scene as a constraint solver,
+ * so it runs every time scene_tick() is called, after the bodies are ticked.
+ * Each tick it finds the contact manifold of every registered pair,
+ * applies the impulses carried over from the last tick,
+ * runs the given number of sequential-impulse iterations over the contacts
+ * and then pushes apart any bodies that are still overlapping.
+ * The scene owns the solver and frees it in scene_free().
+ *
+ * @param scene the scene containing the bodies
+ * @param iterations the number of velocity iterations per tick;
+ *   2-4 is usually enough thanks to warm starting
+ * @return the new solver, to register pairs of bodies with
+ */
+contact_solver_t *create_contact_solver(scene_t *scene, size_t iterations);
+
+/**
+ * Registers a pair of bodies whose contacts the solver should resolve.
+ * Either body may have mass INFINITY, which is useful for walls.
+ * The pair is dropped once either of its bodies is removed.
+ *
+ * @param solver a solver returned from create_contact_solver()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param elasticity the "coefficient of restitution" of the contact;
+ *   0 is perfectly inelastic and 1 is perfectly elastic
+ * @param friction the coefficient of friction between the bodies
+ */
+void contact_solver_add_pair(contact_solver_t *solver, body_t *body1,
+                             body_t *body2, double elasticity,
+                             double friction);
+
+/**
+ * Changes the number of velocity iterations the solver runs per tick.
+ *
+ * @param solver a solver returned from create_contact_solver()
+ * @param iterations the number of iterations, which must be positive
+ */
+void contact_solver_set_iterations(contact_solver_t *solver,
+                                   size_t iterations);
+
+/**
+ * Gets the number of contact points the solver resolved during the last tick,
+ * e.g. to measure the solver's cost per contact.
+ *
+ * @param solver a solver returned from create_contact_solver()
+ * @return the number of contact points in the last tick
+ */
+size_t contact_solver_num_contacts(contact_solver_t *solver);
+
 #endif // #ifndef __FORCES_H__
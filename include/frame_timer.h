@@ -0,0 +1,114 @@
+#ifndef __FRAME_TIMER_H__
+#define __FRAME_TIMER_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Measures wall-clock time between frames with SDL's high-resolution
+ * monotonic counter, and keeps statistics on the most recent frames:
+ * a histogram of frame times for percentiles, how many vsync intervals
+ * were missed and how many frames went over a time budget.
+ */
+typedef struct frame_timer frame_timer_t;
+
+/**
+ * Allocates memory for a frame timer.
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @param refresh_rate the display's refresh rate in Hz, or 0 if unknown,
+ *   in which case no vsyncs are counted as missed
+ * @return a pointer to the newly allocated timer
+ */
+frame_timer_t *frame_timer_init(double refresh_rate);
+
+/**
+ * Releases the memory allocated for a frame timer.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ */
+void frame_timer_free(frame_timer_t *timer);
+
+/**
+ * Changes the refresh rate vsyncs are counted against.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ * @param refresh_rate the display's refresh rate in Hz, or 0 if unknown
+ */
+void frame_timer_set_refresh_rate(frame_timer_t *timer, double refresh_rate);
+
+/**
+ * Marks the start of a new frame and records how long the last one took.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ * @return the seconds since the last call, or 0 the first time
+ */
+double frame_timer_tick(frame_timer_t *timer);
+
+/**
+ * Gets the duration of the last frame, as returned by frame_timer_tick().
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ * @return the duration of the last frame, in seconds
+ */
+double frame_timer_dt(frame_timer_t *timer);
+
+/**
+ * Gets a percentile of the recent frame times.
+ * Times are bucketed, so this is accurate to a quarter of a millisecond.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ * @param percentile the percentile, between 0 and 100, e.g. 99 for p99
+ * @return the frame time, in seconds, that the given percentage of recent
+ *   frames took no longer than, or 0 if no frames have been recorded
+ */
+double frame_timer_percentile(frame_timer_t *timer, double percentile);
+
+/**
+ * Gets the number of vsync intervals missed since the timer was created.
+ * A frame that takes three refresh intervals misses two vsyncs.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ * @return the number of missed vsyncs
+ */
+size_t frame_timer_missed_vsyncs(frame_timer_t *timer);
+
+/**
+ * Sets how long a frame may take. There is no budget until one is set.
+ * Frame times include any wait for vsync, so a budget of exactly one refresh
+ * interval would count ordinary vsynced frames over budget because of jitter.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ * @param budget the budget per frame, in seconds, or 0 for no budget
+ */
+void frame_timer_set_budget(frame_timer_t *timer, double budget);
+
+/**
+ * Gets how much of the current frame's budget is left,
+ * e.g. to decide whether there is time to do deferrable work.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ * @return the seconds left until the frame is over budget,
+ *   which is negative once it is over, or INFINITY if there is no budget
+ */
+double frame_timer_budget_left(frame_timer_t *timer);
+
+/**
+ * Gets the number of frames that took longer than the budget
+ * since the timer was created.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ * @return the number of frames over budget
+ */
+size_t frame_timer_over_budget(frame_timer_t *timer);
+
+/**
+ * Prints a one-line summary of the timer's statistics.
+ *
+ * @param timer a pointer to a timer returned from frame_timer_init()
+ * @param out the stream to print to
+ */
+void frame_timer_print(frame_timer_t *timer, FILE *out);
+
+#endif // #ifndef __FRAME_TIMER_H__
@@ -2,6 +2,7 @@
 #define __LIST_H__
 
 #include "vector.h"
+#include <stdbool.h>
 #include <stddef.h>
 
 /**
@@ -65,6 +66,20 @@ void *list_get(list_t *list, size_t index);
  */
 void *list_remove(list_t *list, size_t index);
 
+/**
+ * Removes the elements of a list for which a function returns true, keeping
+ * the order of the rest, in one pass over the list. Frees the removed
+ * elements with the list's freer, if it has one.
+ *
+ * @param list a pointer to a list returned from list_init()
+ * @param remove a function that takes an element and aux, and returns whether
+ *   to remove the element
+ * @param aux the value to pass to the function
+ * @return the number of elements removed
+ */
+size_t list_remove_if(list_t *list, bool (*remove)(void *, void *),
+                      void *aux);
+
 /**
  * Appends an element to the end of a list.
  * If the list is filled to capacity, resizes the list to fit more elements
@@ -3,12 +3,20 @@
 
 #include "color.h"
 #include "list.h"
+#include "vec.h"
 #include "vector.h"
 
 typedef struct polygon polygon_t;
 
+/**
+ * A polygon's vertices, stored inline (see vec.h). Polygons with up to 8
+ * vertices keep them inside the polygon itself.
+ */
+DEFINE_SMALL_VEC(vertex_list, vector_t, 8)
+
 /**
  * Initialize a polygon object given a list of vertices.
+ * The vertices are copied into the polygon, and the list is freed.
  *
  * @param points the list of vertices that make up the polygon
  * @param initial_position a vector representing the initial center position of
@@ -27,12 +35,12 @@ polygon_t *polygon_init(list_t *points, vector_t initial_velocity,
                         double blue);
 
 /**
- * Return the list of vectors representing the vertices of the polygon.
+ * Return the vertices of the polygon.
  *
  * @param polygon the list of vertices that make up the polygon
- * @return a list of vectors
+ * @return the vertices, owned by the polygon
  */
-list_t *polygon_get_points(polygon_t *polygon);
+vertex_list_t *polygon_get_points(polygon_t *polygon);
 
 /**
  * Translate and rotate the polygon then update velocity based on gravity.
@@ -84,6 +92,21 @@ void polygon_translate(polygon_t *polygon, vector_t translation);
  */
 void polygon_rotate(polygon_t *polygon, double angle, vector_t point);
 
+/**
+ * Gets a triangulation of the polygon, as indices into its list of points.
+ * Every three consecutive indices make up one triangle.
+ * Convex polygons are split into a fan and others are split by ear clipping;
+ * either winding order is accepted.
+ * The triangulation is computed the first time it is requested and cached,
+ * since translating and rotating a polygon don't change it.
+ *
+ * @param polygon the list of vertices that make up the polygon
+ * @param num_indices where to store the number of indices,
+ *   which is 3 * (number of points - 2) unless the polygon is degenerate
+ * @return the indices, owned by the polygon
+ */
+const int *polygon_get_triangles(polygon_t *polygon, size_t *num_indices);
+
 /**
  * Return the polygon's color.
  *
@@ -0,0 +1,78 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <stdbool.h>
+
+/**
+ * A lightweight instrumenting profiler.
+ * Code marks zones with PROFILE_BEGIN() and PROFILE_END(), which record a
+ * timestamp into a ring buffer belonging to the calling thread, so threads
+ * never contend while recording. The most recent events of every thread can
+ * be written out in the Chrome trace format, which chrome://tracing and
+ * Perfetto (https://ui.perfetto.dev) open.
+ *
+ * The macros only do anything when compiled with -DPROFILE
+ * (run 'make PROFILE=true all' after 'make clean'); otherwise they compile to
+ * nothing, so instrumentation can stay in the code for free.
+ *
+ * Example:
+ * ```
+ * void scene_tick(scene_t *scene, double dt) {
+ *   PROFILE_BEGIN("scene_tick");
+ *   ...
+ *   PROFILE_END("scene_tick");
+ * }
+ * ...
+ * PROFILE_WRITE("trace.json");
+ * PROFILE_SHUTDOWN();
+ * ```
+ */
+
+#ifdef PROFILE
+#define PROFILE_BEGIN(name) profiler_begin(name)
+#define PROFILE_END(name) profiler_end(name)
+#define PROFILE_WRITE(path) profiler_write_trace(path)
+#define PROFILE_SHUTDOWN() profiler_free()
+#else
+#define PROFILE_BEGIN(name) ((void)0)
+#define PROFILE_END(name) ((void)0)
+#define PROFILE_WRITE(path) ((void)0)
+#define PROFILE_SHUTDOWN() ((void)0)
+#endif
+
+/**
+ * Records the start of a zone on the calling thread.
+ * Use PROFILE_BEGIN() instead, so the call is compiled out when disabled.
+ *
+ * @param name the zone's name, which must outlive the profiler,
+ *   e.g. a string literal
+ */
+void profiler_begin(const char *name);
+
+/**
+ * Records the end of the zone most recently begun on the calling thread.
+ * Use PROFILE_END() instead, so the call is compiled out when disabled.
+ *
+ * @param name the zone's name, as passed to profiler_begin()
+ */
+void profiler_end(const char *name);
+
+/**
+ * Writes the events still in every thread's ring buffer to a file,
+ * as a Chrome trace. Zones whose beginning was already overwritten are left
+ * out. Other threads shouldn't record events while the trace is written.
+ * Use PROFILE_WRITE() instead, so the call is compiled out when disabled.
+ *
+ * @param path the file to write
+ * @return whether the file was written
+ */
+bool profiler_write_trace(const char *path);
+
+/**
+ * Frees every thread's ring buffer, discarding their events.
+ * Every other thread that recorded events must have exited.
+ * Use PROFILE_SHUTDOWN() instead, so the call is compiled out when disabled.
+ */
+void profiler_free(void);
+
+#endif // #ifndef __PROFILER_H__
@@ -0,0 +1,170 @@
+#ifndef __RENDER_SNAPSHOT_H__
+#define __RENDER_SNAPSHOT_H__
+
+#include "asset_cache.h"
+#include "sdl_wrapper.h"
+#include "static_layer.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Everything needed to draw one frame, recorded by the simulation so that the
+ * frame can be drawn later (or on another thread) without reading any bodies.
+ * Items are drawn in the order they were added.
+ *
+ * A snapshot only holds plain data: images and fonts are recorded as asset
+ * cache handles, and text is copied. The thread that draws turns the handles
+ * into textures and fonts with render_snapshot_resolve(), so textures are
+ * only ever created and destroyed on that thread.
+ */
+typedef struct render_snapshot render_snapshot_t;
+
+/**
+ * Allocates memory for an empty snapshot.
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @return a pointer to the newly allocated snapshot
+ */
+render_snapshot_t *render_snapshot_init(void);
+
+/**
+ * Releases the memory allocated for a snapshot,
+ * and the references it holds to its images.
+ *
+ * @param snapshot a pointer to a snapshot returned from render_snapshot_init()
+ */
+void render_snapshot_free(render_snapshot_t *snapshot);
+
+/**
+ * Removes every item from a snapshot, keeping its memory for reuse,
+ * and releases the references it held to their images.
+ *
+ * @param snapshot a pointer to a snapshot returned from render_snapshot_init()
+ * @param vertical_offset the vertical offset of the camera for the new frame
+ */
+void render_snapshot_clear(render_snapshot_t *snapshot, double vertical_offset);
+
+/**
+ * Gets the number of items in a snapshot.
+ *
+ * @param snapshot a pointer to a snapshot returned from render_snapshot_init()
+ * @return the number of items added since the snapshot was last cleared
+ */
+size_t render_snapshot_size(render_snapshot_t *snapshot);
+
+/**
+ * Adds an image drawn at a rectangle of the window to a snapshot.
+ * The snapshot holds its own reference to the image until it is cleared,
+ * so the image can't be evicted while the snapshot is waiting to be drawn.
+ *
+ * @param snapshot a pointer to a snapshot returned from render_snapshot_init()
+ * @param image a handle to the image
+ * @param dest where to draw the image, in pixels
+ */
+void render_snapshot_add_image(render_snapshot_t *snapshot,
+                               image_handle_t image, SDL_Rect dest);
+
+/**
+ * Adds text to a snapshot, copying the string.
+ *
+ * @param snapshot a pointer to a snapshot returned from render_snapshot_init()
+ * @param font a handle to the font to draw the text in
+ * @param text the text
+ * @param position the position of the top left corner of the text, in pixels
+ * @param color the color of the text
+ * @param font_size the font size (see sdl_render_font())
+ * @param dynamic whether the text changes often, and should be drawn from a
+ *   glyph atlas (see sdl_render_glyphs()) rather than rasterized whole
+ */
+void render_snapshot_add_text(render_snapshot_t *snapshot, font_handle_t font,
+                              const char *text, vector_t position,
+                              SDL_Color color, int8_t font_size, bool dynamic);
+
+/**
+ * Adds a static layer to a snapshot, drawn at the snapshot's camera offset.
+ * The layer's textures belong to the thread that draws, so the layer must
+ * not be changed once snapshots of it may be drawn on another thread.
+ *
+ * @param snapshot a pointer to a snapshot returned from render_snapshot_init()
+ * @param layer the layer, which must outlive the snapshot's use
+ */
+void render_snapshot_add_layer(render_snapshot_t *snapshot,
+                               static_layer_t *layer);
+
+/**
+ * Looks up the textures and fonts of a snapshot's items in the asset cache,
+ * loading any images that aren't loaded, and rebuilds the textures of its
+ * static layers if they are out of date. Must be called on the thread that
+ * initialized SDL, before drawing the snapshot, and while no other thread
+ * uses the asset cache or the bodies behind the static layers.
+ *
+ * @param snapshot a pointer to a snapshot returned from render_snapshot_init()
+ */
+void render_snapshot_resolve(render_snapshot_t *snapshot);
+
+/**
+ * Draws every item of a snapshot to the window, in order.
+ * Must be called on the thread that initialized SDL, after
+ * render_snapshot_resolve(). Reads nothing but the snapshot and the textures
+ * it was resolved to, so other threads may keep running meanwhile.
+ *
+ * @param snapshot a pointer to a snapshot returned from render_snapshot_init()
+ */
+void render_snapshot_draw(render_snapshot_t *snapshot);
+
+/**
+ * Three snapshots shared between a simulation thread, which writes them,
+ * and a render thread, which draws them. Neither thread ever waits:
+ * the simulation always has a snapshot to write to, and the render thread
+ * always draws the most recently published one.
+ */
+typedef struct snapshot_buffer snapshot_buffer_t;
+
+/**
+ * Allocates memory for a triple buffer of empty snapshots.
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @return a pointer to the newly allocated buffer
+ */
+snapshot_buffer_t *snapshot_buffer_init(void);
+
+/**
+ * Releases the memory allocated for a triple buffer and its snapshots.
+ * Neither thread may be using the buffer.
+ *
+ * @param buffer a pointer to a buffer returned from snapshot_buffer_init()
+ */
+void snapshot_buffer_free(snapshot_buffer_t *buffer);
+
+/**
+ * Gets the snapshot the simulation thread should write the next frame to.
+ * Only the simulation thread may call this.
+ *
+ * @param buffer a pointer to a buffer returned from snapshot_buffer_init()
+ * @return the snapshot to write to
+ */
+render_snapshot_t *snapshot_buffer_back(snapshot_buffer_t *buffer);
+
+/**
+ * Publishes the snapshot returned by snapshot_buffer_back() to the render
+ * thread, replacing any published snapshot it hasn't picked up yet.
+ * Only the simulation thread may call this.
+ *
+ * @param buffer a pointer to a buffer returned from snapshot_buffer_init()
+ */
+void snapshot_buffer_publish(snapshot_buffer_t *buffer);
+
+/**
+ * Gets the most recently published snapshot.
+ * If nothing was published since the last call, returns the same snapshot.
+ * Only the render thread may call this.
+ *
+ * @param buffer a pointer to a buffer returned from snapshot_buffer_init()
+ * @param fresh where to store whether the snapshot is newly published;
+ *   may be NULL
+ * @return the snapshot to draw
+ */
+render_snapshot_t *snapshot_buffer_acquire(snapshot_buffer_t *buffer,
+                                           bool *fresh);
+
+#endif // #ifndef __RENDER_SNAPSHOT_H__
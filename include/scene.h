@@ -2,15 +2,37 @@
 #define __SCENE_H__
 
 #include "body.h"
+#include "collision_events.h"
+#include "force_field.h"
 #include "list.h"
+#include <stdint.h>
 
 /**
  * A collection of bodies and force creators.
  * The scene automatically resizes to store
  * arbitrarily many bodies and force creators.
+ *
+ * The bodies are kept in a dense array for iteration, whose order changes
+ * as bodies are removed: removing a body moves the last body into its place.
+ * To refer to a body across ticks, keep the handle scene_add_body() returns.
  */
 typedef struct scene scene_t;
 
+/**
+ * A stable reference to a body in a scene. A handle keeps referring to its
+ * body as other bodies are added and removed, and becomes stale once its
+ * body is freed, even if another body takes its place.
+ */
+typedef struct body_handle {
+  uint32_t index;
+  uint32_t generation;
+} body_handle_t;
+
+/**
+ * A handle that never refers to a body.
+ */
+extern const body_handle_t BODY_HANDLE_NONE;
+
 
 /**
  * A function which adds some forces or impulses to bodies,
@@ -19,6 +41,14 @@ typedef struct scene scene_t;
  */
 typedef void (*force_creator_t)(void *aux);
 
+/**
+ * A function which corrects the positions and velocities of bodies
+ * after they have been ticked, e.g. to enforce distance constraints.
+ * Takes in an auxiliary value that can store parameters or state,
+ * and the time elapsed over the tick.
+ */
+typedef void (*constraint_solver_t)(void *aux, double dt);
+
 /**
  * Allocates memory for an empty scene.
  * Makes a reasonable guess of the number of bodies to allocate space for.
@@ -47,6 +77,7 @@ size_t scene_bodies(scene_t *scene);
 /**
  * Gets the body at a given index in a scene.
  * Asserts that the index is valid.
+ * A body's index can change whenever a body is removed in scene_tick().
  *
  * @param scene a pointer to a scene returned from scene_init()
  * @param index the index of the body in the scene (starting at 0)
@@ -55,12 +86,33 @@ size_t scene_bodies(scene_t *scene);
 body_t *scene_get_body(scene_t *scene, size_t index);
 
 /**
- * Adds a body to a scene.
+ * Gets the handle to the body at a given index in a scene.
+ * Asserts that the index is valid.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param index the index of the body in the scene (starting at 0)
+ * @return a handle to the body at the given index
+ */
+body_handle_t scene_get_handle(scene_t *scene, size_t index);
+
+/**
+ * Gets the body a handle refers to, in constant time.
+ * A body marked for removal is still returned until scene_tick() frees it.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param handle a handle returned from scene_add_body()
+ * @return the body, or NULL if the handle is stale
+ */
+body_t *scene_resolve_body(scene_t *scene, body_handle_t handle);
+
+/**
+ * Adds a body to a scene, in constant time.
  *
  * @param scene a pointer to a scene returned from scene_init()
  * @param body a pointer to the body to add to the scene
+ * @return a handle to the body
  */
-void scene_add_body(scene_t *scene, body_t *body);
+body_handle_t scene_add_body(scene_t *scene, body_t *body);
 
 /**
  * @deprecated Use body_remove() instead
@@ -96,12 +148,56 @@ void scene_add_force_creator(scene_t *scene, force_creator_t forcer, void *aux);
 void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
                                     void *aux, list_t *bodies);
 
+/**
+ * Adds a constraint solver to a scene,
+ * to be invoked every time scene_tick() is called.
+ * Constraint solvers run after every body has been ticked and before bodies
+ * marked for removal are freed, so a solver can still see (and should skip)
+ * any body for which body_is_removed() is true.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param solver a constraint solver function
+ * @param aux an auxiliary value to pass to solver when it is called
+ * @param freer if non-NULL, a function to call on aux in scene_free()
+ */
+void scene_add_constraint_solver(scene_t *scene, constraint_solver_t solver,
+                                 void *aux, free_func_t freer);
+
+/**
+ * Gets the force fields acting on a scene's bodies.
+ * Fields added to the set are applied to every body in the scene
+ * at the start of each scene_tick(). The scene owns the set.
+ *
+ * Example:
+ * ```
+ * force_field_set_t *fields = scene_get_force_fields(scene);
+ * force_fields_add_uniform(fields, (vector_t){0, -1000});
+ * force_fields_add_wind(fields, floor_min, floor_max, (vector_t){300, 0}, 2);
+ * ```
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the scene's set of force fields
+ */
+force_field_set_t *scene_get_force_fields(scene_t *scene);
+
+/**
+ * Gets the queue that collision detection reports events to.
+ * The queue is dispatched in scene_tick() once every force creator has run,
+ * so collision handlers run before the bodies are ticked. The scene owns it.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the scene's collision event queue
+ */
+collision_events_t *scene_get_collision_events(scene_t *scene);
+
 /**
  * Executes a tick of a given scene over a small time interval.
- * This requires executing all the force creators
- * and then ticking each body (see body_tick()).
+ * This requires applying the force fields, executing all the force creators,
+ * dispatching the collision events they queued, ticking each body
+ * (see body_tick()) and then running the constraint solvers.
  * If any bodies are marked for removal, they should be removed from the scene
- * and freed, along with any force creators acting on them.
+ * and freed, along with any force creators acting on them. Removing a body
+ * takes constant time, apart from finding its force creators.
  *
  * @param scene a pointer to a scene returned from scene_init()
  * @param dt the time elapsed since the last tick, in seconds
@@ -2,6 +2,7 @@
 #define __SDL_WRAPPER_H__
 
 #include "color.h"
+#include "frame_timer.h"
 #include "list.h"
 #include "polygon.h"
 #include "scene.h"
@@ -30,6 +31,15 @@ typedef enum {
  */
 typedef enum { KEY_PRESSED, KEY_RELEASED } key_event_type_t;
 
+/**
+ * A drawable image: a region of a texture.
+ * Images packed into an atlas share one texture and differ in their region.
+ */
+typedef struct sprite {
+  SDL_Texture *texture;
+  SDL_Rect src;
+} sprite_t;
+
 /**
  * A keypress handler.
  * When a key is pressed or released, the handler is passed its char value.
@@ -52,6 +62,53 @@ typedef void (*key_handler_t)(char key, key_event_type_t type, double held_time,
  */
 void sdl_init(vector_t min, vector_t max);
 
+/**
+ * Initializes SDL to draw into an offscreen surface instead of a window,
+ * using SDL's software renderer and a dummy audio driver, so that rendering
+ * can be benchmarked and checked on machines without a display.
+ * Used instead of sdl_init(); frames are read back with sdl_frame_checksum()
+ * and sdl_save_frame().
+ *
+ * @param min the x and y coordinates of the bottom left of the scene
+ * @param max the x and y coordinates of the top right of the scene
+ * @param width the width of the surface, in pixels
+ * @param height the height of the surface, in pixels
+ */
+void sdl_init_headless(vector_t min, vector_t max, int width, int height);
+
+/**
+ * Frees everything sdl_init() or sdl_init_headless() set up, including the
+ * frame timer and the text cache, then shuts down SDL and its libraries.
+ * Any sounds, music, fonts and textures should be freed first.
+ */
+void sdl_quit(void);
+
+/**
+ * Computes a 32-bit FNV-1a hash of the pixels drawn so far this frame.
+ * Identical frames always hash the same, so a changed checksum flags a change
+ * in what the render path draws. Only available after sdl_init_headless().
+ *
+ * @return the checksum of the frame
+ */
+uint32_t sdl_frame_checksum(void);
+
+/**
+ * Saves the pixels drawn so far this frame as a BMP image.
+ * Only available after sdl_init_headless().
+ *
+ * @param path the file to write
+ * @return whether the file was written
+ */
+bool sdl_save_frame(const char *path);
+
+/**
+ * Gets how long the last frame took to draw, from sdl_clear() until
+ * sdl_show() returned (including any wait for vsync).
+ *
+ * @return the duration of the last frame, in seconds
+ */
+double sdl_get_frame_time(void);
+
 /**
  * Processes all SDL events and returns whether the window has been closed.
  * This function must be called in order to handle inputs.
@@ -81,8 +138,85 @@ Mix_Chunk *sdl_load_sound(const char *file);
  */
 void sdl_play_sound(Mix_Chunk *sound);
 
+/**
+ * A set of sounds, looked up by id, that share a fixed pool of mixer
+ * channels (voices). Playing a sound only requests it; the requests made in
+ * a frame are started together by sdl_sound_bank_update(), so any number of
+ * requests for one sound in a frame start it at most once, and the number of
+ * voices playing never exceeds the pool.
+ *
+ * When a sound already has its maximum number of instances playing, its
+ * oldest instance is restarted. When every voice is busy, the oldest voice
+ * playing the lowest priority sound is taken over, unless that priority is
+ * higher than the requested sound's, in which case the request is dropped.
+ */
+typedef struct sound_bank sound_bank_t;
+
+/**
+ * Makes a sound bank whose voices are the mixer channels
+ * [first_channel, first_channel + num_voices), allocating more channels if
+ * the mixer has fewer. Those channels shouldn't be played on directly.
+ *
+ * @param num_sounds the number of sounds; ids are 0 to num_sounds - 1
+ * @param first_channel the first channel of the bank's voices
+ * @param num_voices how many sounds the bank can play at once
+ * @return the bank
+ */
+sound_bank_t *sdl_sound_bank_init(size_t num_sounds, int first_channel,
+                                  size_t num_voices);
+
+/**
+ * Halts the bank's voices and frees the bank. The bank doesn't own its
+ * sounds, so they aren't freed.
+ *
+ * @param bank the bank to free
+ */
+void sdl_sound_bank_free(sound_bank_t *bank);
+
+/**
+ * Sets the sound for an id, and how it is played.
+ *
+ * @param bank the bank
+ * @param id the id of the sound
+ * @param sound the sound, or NULL if it isn't loaded yet
+ * @param max_instances how many voices may play the sound at once; at least 1
+ * @param priority how important the sound is; higher takes voices from lower
+ */
+void sdl_sound_bank_define(sound_bank_t *bank, size_t id, Mix_Chunk *sound,
+                           size_t max_instances, int priority);
+
+/**
+ * Sets the sound for an id that has already been defined, e.g. once it has
+ * loaded, keeping how it is played.
+ *
+ * @param bank the bank
+ * @param id the id of the sound
+ * @param sound the sound, or NULL if it isn't loaded yet
+ */
+void sdl_sound_bank_set(sound_bank_t *bank, size_t id, Mix_Chunk *sound);
+
+/**
+ * Requests that a sound be played at the next sdl_sound_bank_update().
+ * Requesting a sound that was already requested this frame does nothing.
+ *
+ * @param bank the bank
+ * @param id the id of the sound
+ */
+void sdl_sound_bank_play(sound_bank_t *bank, size_t id);
+
+/**
+ * Starts the sounds requested since the last update, highest priority first.
+ * Should be called once per frame. Sounds that aren't loaded are skipped.
+ *
+ * @param bank the bank
+ */
+void sdl_sound_bank_update(sound_bank_t *bank);
+
 /**
  * Draws a polygon from the given list of vertices and a color.
+ * The polygon's cached triangulation (see polygon_get_triangles()) is queued
+ * with the sprite batch, so consecutive polygons are drawn together with a
+ * single SDL_RenderGeometry() call.
  *
  * @param poly a struct representing the polygon
  * @param color the color used to fill in the polygon
@@ -93,6 +227,7 @@ void sdl_draw_polygon(polygon_t *poly, rgb_color_t color, double vector_offset);
 /**
  * Displays the rendered frame on the SDL window.
  * Must be called after drawing the polygons in order to show them.
+ * Also ends the frame's allocation statistics (see alloc_end_frame()).
  *
  * @param vector_offset the vertical offset for the scene
  */
@@ -140,11 +275,22 @@ void sdl_on_key(key_handler_t handler);
 /**
  * Gets the amount of time that has passed since the last time
  * this function was called, in seconds.
+ * This is wall-clock time, so it includes any time spent waiting for vsync.
+ * Each call is recorded as a frame by sdl_get_frame_timer().
  *
- * @return the number of seconds that have elapsed
+ * @return the number of seconds that have elapsed, or 0 the first time
  */
 double time_since_last_tick(void);
 
+/**
+ * Gets the timer behind time_since_last_tick(), for frame time statistics
+ * and the frame budget. It is created by sdl_init(), with the display's
+ * refresh rate, or by sdl_init_headless(), and freed by sdl_quit().
+ *
+ * @return the timer, owned by the wrapper
+ */
+frame_timer_t *sdl_get_frame_timer(void);
+
 /**
  * Loads a font from the given file path with the specified size.
  *
@@ -162,8 +308,42 @@ TTF_Font *sdl_load_font(const char *font_path, int8_t font_size);
  */
 SDL_Texture *sdl_load_image(const char *image_path);
 
+/**
+ * Uploads an image that has already been decoded, such as one decoded on
+ * another thread, as a texture.
+ *
+ * @param surface the decoded image, which the caller still owns
+ * @return the new texture, or NULL if it couldn't be created
+ */
+SDL_Texture *sdl_create_texture(SDL_Surface *surface);
+
+/**
+ * Packs several decoded images into as few atlas textures as possible,
+ * so that drawing them one after another needs no texture switches.
+ * Images are placed on shelves, tallest first, in atlas pages of up to
+ * 4096x4096 pixels, or the renderer's largest texture if that is smaller.
+ * An image too big for a page gets a page of its own. If a page's texture
+ * can't be created, each of its images gets its own texture instead, and an
+ * image the renderer can't hold at all gets a NULL texture.
+ *
+ * @param images the images to pack, which the caller still owns; NULL for an
+ *   image that failed to load
+ * @param num_images the number of images
+ * @param sprites where to store the region of each image, in the same order
+ *   as images; a NULL image gets a NULL texture
+ * @param pages where to store the created textures, which the caller must
+ *   destroy; must have space for num_images textures
+ * @return the number of textures stored in pages
+ */
+size_t sdl_load_atlas(SDL_Surface **images, size_t num_images,
+                      sprite_t *sprites, SDL_Texture **pages);
+
 /**
  * Renders text on the SDL window at the specified position.
+ * The rendered string is cached by (font, text, color), so drawing the same
+ * text every frame only rasterizes it once; the least recently used strings
+ * are evicted when the cache fills up. Use sdl_render_glyphs() for text that
+ * changes from frame to frame.
  *
  * @param font the TTF font to use for rendering
  * @param text the text to render
@@ -173,9 +353,32 @@ SDL_Texture *sdl_load_image(const char *image_path);
  */
 void sdl_render_font(TTF_Font *font, const char *text, vector_t position, SDL_Color color, int8_t font_size);
 
+/**
+ * Renders text one glyph at a time from a per-font atlas of the printable
+ * ASCII characters, which is built the first time the font is drawn.
+ * Suited to strings that change often, like scores and timers, since nothing
+ * is rasterized per string. Kerning is not applied, and other characters
+ * are skipped. If the renderer can't create the atlas texture, the text is
+ * drawn with sdl_render_font() instead.
+ *
+ * @param font the TTF font to use for rendering
+ * @param text the text to render
+ * @param position the position of the top left corner of the text
+ * @param color the color of the text
+ */
+void sdl_render_glyphs(TTF_Font *font, const char *text, vector_t position,
+                       SDL_Color color);
+
+/**
+ * Releases every cached text texture and glyph atlas.
+ * Must be called before closing a font that has been rendered.
+ */
+void sdl_clear_text_cache(void);
+
 /**
  * Renders an image on the SDL window at the specified position with the
- * specified size.
+ * specified size. The image is queued with the sprite batch
+ * (see sdl_batch_draw()).
  *
  * @param image_texture the SDL texture representing the image to render
  * @param corner_loc the location at which to render the image
@@ -183,6 +386,75 @@ void sdl_render_font(TTF_Font *font, const char *text, vector_t position, SDL_Co
  */
 void sdl_render_image(SDL_Texture *image_texture, vector_t corner_loc, vector_t image_size);
 
+/**
+ * Queues a textured quad to be drawn with the sprite batch.
+ * Quads are drawn in the order they are queued, but runs of quads that share
+ * a texture (e.g. sprites from the same atlas) are submitted to the renderer
+ * together with a single SDL_RenderGeometry() call.
+ * The batch is flushed automatically before anything else is drawn
+ * and by sdl_show().
+ *
+ * @param texture the texture to draw from
+ * @param src the part of the texture to draw, or NULL for the whole texture
+ * @param dest where to draw the quad on the screen, in pixels
+ */
+void sdl_batch_draw(SDL_Texture *texture, const SDL_Rect *src, SDL_Rect dest);
+
+/**
+ * Submits everything queued with sdl_batch_draw() and sdl_draw_polygon()
+ * to the renderer.
+ */
+void sdl_batch_flush(void);
+
+/**
+ * Gets the part of the scene the camera sees at a vertical offset.
+ *
+ * @param vertical_offset the vertical offset of the camera
+ * @param min where to store the bottom left corner of the view
+ * @param max where to store the top right corner of the view
+ */
+void sdl_get_view_bounds(double vertical_offset, vector_t *min,
+                         vector_t *max);
+
+/**
+ * Gets the number of pixels per unit of scene distance,
+ * which changes when the window is resized.
+ *
+ * @return the scale from scene coordinates to pixel coordinates
+ */
+double sdl_get_scene_scale(void);
+
+/**
+ * Creates a transparent texture the size of the window that can be drawn into
+ * with sdl_set_render_target(). The caller must destroy it.
+ *
+ * @return the new texture
+ */
+SDL_Texture *sdl_create_render_target(void);
+
+/**
+ * Redirects drawing into a texture, or back to the window.
+ * Flushes the sprite batch first, and clears the texture to transparent.
+ *
+ * @param target a texture from sdl_create_render_target(),
+ *   or NULL to draw to the window again
+ */
+void sdl_set_render_target(SDL_Texture *target);
+
+/**
+ * Checks whether a box in scene coordinates is in view of the camera,
+ * which follows the vertical offset. Used to skip drawing what is off screen.
+ *
+ * @param min the bottom left corner of the box
+ * @param max the top right corner of the box
+ * @param vertical_offset the vertical offset of the camera
+ * @param margin how far outside the view, in scene units, still counts as
+ *   in view
+ * @return whether any of the box is within the margin of the view
+ */
+bool sdl_in_view(vector_t min, vector_t max, double vertical_offset,
+                 double margin);
+
 /**
  * Calculates the bounding box for a body and stores it in the given SDL_Rect.
  * The bounding box is the smallest rectangle that completely encloses the body.
@@ -0,0 +1,80 @@
+#ifndef __SOUND_STREAM_H__
+#define __SOUND_STREAM_H__
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A sound that is played by reading and converting it a few kilobytes at a
+ * time, on the audio thread, instead of decoding it into memory up front.
+ * Meant for long ambient sounds; short effects should stay resident Mix_Chunks
+ * (see asset_cache.h). Music played with Mix_PlayMusic is already streamed by
+ * the mixer.
+ *
+ * A stream plays on a mixer channel like a Mix_Chunk does, so channel volume
+ * and Mix_HaltChannel work on it as usual. Only one playback of a stream can
+ * be going on at a time.
+ */
+typedef struct sound_stream sound_stream_t;
+
+/**
+ * Opens a WAV file for streaming. Only its header is read here.
+ * Must be called after the mixer is opened, since the samples are converted
+ * to the mixer's format as they are played.
+ *
+ * @param filepath the path to an 8, 16 or 32 bit PCM, or 32 bit float, WAV
+ * @return the stream, or NULL if the file can't be opened or read
+ */
+sound_stream_t *sound_stream_open(const char *filepath);
+
+/**
+ * Opens a stream over samples that are already in memory, such as a sound in
+ * a mapped asset pack. The samples must outlive the stream.
+ *
+ * @param samples the interleaved samples
+ * @param size the size of the samples, in bytes
+ * @param format the SDL audio format of the samples
+ * @param frequency the samples per second, per channel
+ * @param channels the number of interleaved channels
+ * @return the stream, or NULL if the samples can't be converted
+ */
+sound_stream_t *sound_stream_open_raw(const void *samples, size_t size,
+                                      SDL_AudioFormat format, int frequency,
+                                      int channels);
+
+/**
+ * Frees a stream, halting it first if it is playing.
+ *
+ * @param stream the stream to close
+ */
+void sound_stream_close(sound_stream_t *stream);
+
+/**
+ * Plays a stream from the start, like Mix_PlayChannel. Halts the stream
+ * first if it is already playing.
+ *
+ * @param stream the stream to play
+ * @param channel the channel to play on, or -1 for the first free one
+ * @param loops how many extra times to play the sound, or -1 to loop forever
+ * @return the channel it is playing on, or -1 if it couldn't be played
+ */
+int sound_stream_play(sound_stream_t *stream, int channel, int loops);
+
+/**
+ * Halts a stream if it is playing.
+ *
+ * @param stream the stream to halt
+ */
+void sound_stream_stop(sound_stream_t *stream);
+
+/**
+ * Gets whether a stream is playing.
+ *
+ * @param stream the stream
+ * @return whether it is playing on a channel
+ */
+bool sound_stream_playing(sound_stream_t *stream);
+
+#endif // #ifndef __SOUND_STREAM_H__
@@ -0,0 +1,97 @@
+#ifndef __SPRING_NETWORK_H__
+#define __SPRING_NETWORK_H__
+
+#include "body.h"
+#include "scene.h"
+#include <stddef.h>
+
+/**
+ * How a spring network moves its bodies.
+ * SPRING_EXPLICIT applies Hooke's-law impulses, like create_spring(),
+ * and needs a small dt when the springs are stiff.
+ * SPRING_XPBD projects the ticked positions onto the springs' rest lengths
+ * (extended position-based dynamics), which stays stable at any stiffness.
+ */
+typedef enum { SPRING_EXPLICIT, SPRING_XPBD } spring_mode_t;
+
+/**
+ * A set of springs between bodies, evaluated together in a single pass.
+ * Springs are stored as parallel arrays rather than one force creator each,
+ * so ropes and bridges made of many links stay cheap to simulate.
+ */
+typedef struct spring_network spring_network_t;
+
+/**
+ * Allocates memory for an empty spring network.
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @param mode how the network moves its bodies
+ * @param initial_capacity the number of springs to allocate space for
+ * @return a pointer to the newly allocated network
+ */
+spring_network_t *spring_network_init(spring_mode_t mode,
+                                      size_t initial_capacity);
+
+/**
+ * Releases the memory allocated for a spring network.
+ * Does not free the bodies the springs are attached to.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ */
+void spring_network_free(spring_network_t *network);
+
+/**
+ * Adds a spring between two bodies to a network.
+ * Either body may have mass INFINITY, which anchors that end of the spring.
+ * The spring is dropped once either of its bodies is removed.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param k the Hooke's constant for the spring (INFINITY makes a rigid link)
+ * @param rest_length the distance between the centroids at which the spring
+ *   applies no force
+ */
+void spring_network_add(spring_network_t *network, body_t *body1,
+                        body_t *body2, double k, double rest_length);
+
+/**
+ * Gets the number of springs in a network.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @return the number of springs in the network
+ */
+size_t spring_network_size(spring_network_t *network);
+
+/**
+ * Sets how many solver iterations an SPRING_XPBD network runs every tick.
+ * More iterations make long chains of springs stretch less.
+ * Has no effect on SPRING_EXPLICIT networks.
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @param iterations the number of iterations, which must be positive
+ */
+void spring_network_set_iterations(spring_network_t *network,
+                                   size_t iterations);
+
+/**
+ * Runs the network over a tick of the given length.
+ * Should be called after the bodies have been ticked;
+ * create_spring_network() does this automatically every scene_tick().
+ *
+ * @param network a pointer to a network returned from spring_network_init()
+ * @param dt the number of seconds elapsed over the tick
+ */
+void spring_network_step(spring_network_t *network, double dt);
+
+/**
+ * Adds a spring network to a scene as a constraint solver,
+ * so it is stepped every time scene_tick() is called.
+ * The scene takes ownership of the network and frees it in scene_free().
+ *
+ * @param scene the scene containing the bodies
+ * @param network a pointer to a network returned from spring_network_init()
+ */
+void create_spring_network(scene_t *scene, spring_network_t *network);
+
+#endif // #ifndef __SPRING_NETWORK_H__
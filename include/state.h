@@ -10,6 +10,11 @@
  */
 typedef struct state state_t;
 
+/**
+ * A frame recorded for drawing later (see render_snapshot.h)
+ */
+typedef struct render_snapshot render_snapshot_t;
+
 /**
  * Initializes sdl as well as the variables needed
  * Creates and stores all necessary variables for the demo in a created state
@@ -28,6 +33,19 @@ state_t *emscripten_init();
  */
 bool emscripten_main(state_t *state);
 
+/**
+ * Advances the demo by one tick without drawing anything, recording what the
+ * tick would draw into a snapshot instead. emscripten_main() calls this and
+ * then draws the snapshot; with RENDER_THREAD, the simulation thread calls it
+ * and the main thread draws the snapshots.
+ *
+ * @param state pointer to a state object with info about demo
+ * @param dt the number of seconds since the last tick
+ * @param snapshot the snapshot to record the frame into
+ */
+void emscripten_update(state_t *state, double dt,
+                       render_snapshot_t *snapshot);
+
 /**
  * Frees anything allocated in the demo
  * Should free everything in state as well as state itself.
@@ -0,0 +1,72 @@
+#ifndef __STATIC_LAYER_H__
+#define __STATIC_LAYER_H__
+
+#include "asset.h"
+#include <stddef.h>
+
+/**
+ * A cache of the parts of the world that never move, like walls and platforms.
+ * The images of its assets are drawn once into textures the size of the
+ * window, stacked from the bottom of the world to the top, and each frame
+ * only the one or two textures under the camera are drawn.
+ * The textures are redrawn when an asset is added or the window is resized.
+ */
+typedef struct static_layer static_layer_t;
+
+/**
+ * Allocates memory for an empty static layer.
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @return a pointer to the newly allocated layer
+ */
+static_layer_t *static_layer_init(void);
+
+/**
+ * Releases the memory allocated for a static layer,
+ * including its cached textures and the assets added to it.
+ *
+ * @param layer a pointer to a layer returned from static_layer_init()
+ */
+void static_layer_free(static_layer_t *layer);
+
+/**
+ * Adds an image asset to a static layer, which takes ownership of it.
+ * The asset's body must not move, rotate or be removed while in the layer.
+ *
+ * Asserts that the asset is an image with a body.
+ *
+ * @param layer a pointer to a layer returned from static_layer_init()
+ * @param asset an image asset made by asset_make_image_with_body()
+ */
+void static_layer_add(static_layer_t *layer, asset_t *asset);
+
+/**
+ * Gets the number of textures the layer is cached in.
+ * Zero until the layer is first prepared.
+ *
+ * @param layer a pointer to a layer returned from static_layer_init()
+ * @return the number of cached textures
+ */
+size_t static_layer_num_chunks(static_layer_t *layer);
+
+/**
+ * Redraws the textures of a static layer if they are out of date, because
+ * an asset was added or the window was resized since they were drawn.
+ * Reads the assets' bodies and images, so it must be called on the thread
+ * that draws while nothing else uses them.
+ *
+ * @param layer a pointer to a layer returned from static_layer_init()
+ */
+void static_layer_prepare(static_layer_t *layer);
+
+/**
+ * Draws the part of a static layer that is under the camera, from the
+ * textures drawn by the last static_layer_prepare(). Reads nothing else,
+ * so other threads may use the assets meanwhile.
+ *
+ * @param layer a pointer to a layer returned from static_layer_init()
+ * @param vertical_offset the vertical offset of the camera
+ */
+void static_layer_render(static_layer_t *layer, double vertical_offset);
+
+#endif // #ifndef __STATIC_LAYER_H__
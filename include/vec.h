@@ -0,0 +1,317 @@
+#ifndef __VEC_H__
+#define __VEC_H__
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Typed growable arrays that store their elements inline, unlike list_t,
+ * which stores a pointer to each element.
+ *
+ * DEFINE_VEC(name, type) defines the array type name_t, along with:
+ *
+ *   void name_init(name_t *vec)
+ *     Makes an empty array, which allocates nothing until it grows.
+ *   void name_free(name_t *vec)
+ *     Frees the array's storage, leaving it empty. Doesn't free anything the
+ *     elements point to.
+ *   size_t name_size(name_t *vec)
+ *   type *name_data(name_t *vec)
+ *     Gets the elements, which stay where they are until the array grows.
+ *   type *name_get(name_t *vec, size_t index)
+ *     Gets an element, asserting that the index is valid.
+ *   void name_reserve(name_t *vec, size_t capacity)
+ *     Makes room for capacity elements.
+ *   void name_push(name_t *vec, type value)
+ *     Appends an element, growing the array if it is full.
+ *   type name_swap_remove(name_t *vec, size_t index)
+ *     Removes and returns an element in constant time by moving the last
+ *     element into its place, so the order isn't kept.
+ *   size_t name_remove_if(name_t *vec, bool (*remove)(type *, void *),
+ *                         void *aux)
+ *     Removes the elements for which remove(element, aux) is true, keeping
+ *     the order of the rest, and returns how many were removed.
+ *   void name_clear(name_t *vec)
+ *     Empties the array, keeping its storage.
+ *
+ * DEFINE_SMALL_VEC(name, type, n) defines the same, but the array holds its
+ * first n elements itself, so arrays that stay that small never allocate.
+ * Both kinds of array can be copied by value, but then only one copy may be
+ * used or freed afterwards.
+ *
+ * Example:
+ * ```
+ * DEFINE_SMALL_VEC(point_list, vector_t, 8)
+ *
+ * point_list_t points;
+ * point_list_init(&points);
+ * point_list_push(&points, (vector_t){1, 2});
+ * vector_t *first = point_list_get(&points, 0);
+ * point_list_free(&points);
+ * ```
+ */
+
+#define VEC_GROWTH_FACTOR 2
+
+/**
+ * Arrays get and release their storage through VEC_REALLOC and VEC_FREE.
+ * These are expanded wherever an array is defined, which for arrays defined
+ * in headers is before alloc.h has redirected realloc() and free(), so builds
+ * that track allocations call functions in alloc.c instead, which count the
+ * storage of every array under ALLOC_CONTAINERS.
+ */
+#ifdef TRACK_ALLOC
+void *vec_realloc(void *ptr, size_t size);
+void vec_free(void *ptr);
+#define VEC_REALLOC(ptr, size) vec_realloc(ptr, size)
+#define VEC_FREE(ptr) vec_free(ptr)
+#else
+#define VEC_REALLOC(ptr, size) realloc(ptr, size)
+#define VEC_FREE(ptr) free(ptr)
+#endif
+
+#define DEFINE_VEC(name, type)                                                 \
+  typedef struct name {                                                        \
+    type *heap;                                                                \
+    size_t size;                                                               \
+    size_t capacity;                                                           \
+  } name##_t;                                                                  \
+                                                                               \
+  static inline void name##_init(name##_t *vec) {                              \
+    vec->heap = NULL;                                                          \
+    vec->size = 0;                                                             \
+    vec->capacity = 0;                                                         \
+  }                                                                            \
+                                                                               \
+  static inline type *name##_data(name##_t *vec) { return vec->heap; }        \
+                                                                               \
+  VEC_DEFINE_FUNCTIONS(name, type, 0)
+
+#define DEFINE_SMALL_VEC(name, type, n)                                        \
+  typedef struct name {                                                        \
+    /* NULL while the elements fit in local */                                 \
+    type *heap;                                                                \
+    size_t size;                                                               \
+    size_t capacity;                                                           \
+    type local[n];                                                             \
+  } name##_t;                                                                  \
+                                                                               \
+  static inline void name##_init(name##_t *vec) {                              \
+    vec->heap = NULL;                                                          \
+    vec->size = 0;                                                             \
+    vec->capacity = (n);                                                       \
+  }                                                                            \
+                                                                               \
+  static inline type *name##_data(name##_t *vec) {                             \
+    return vec->heap != NULL ? vec->heap : vec->local;                         \
+  }                                                                            \
+                                                                               \
+  VEC_DEFINE_FUNCTIONS(name, type, n)
+
+/**
+ * The functions both kinds of array share, given name##_data() and how many
+ * elements the array holds itself.
+ */
+#define VEC_DEFINE_FUNCTIONS(name, type, local_capacity)                       \
+  static inline void name##_free(name##_t *vec) {                              \
+    VEC_FREE(vec->heap);                                                       \
+    vec->heap = NULL;                                                          \
+    vec->size = 0;                                                             \
+    vec->capacity = (local_capacity);                                          \
+  }                                                                            \
+                                                                               \
+  static inline size_t name##_size(name##_t *vec) { return vec->size; }       \
+                                                                               \
+  static inline type *name##_get(name##_t *vec, size_t index) {                \
+    assert(index < vec->size);                                                 \
+    return &name##_data(vec)[index];                                           \
+  }                                                                            \
+                                                                               \
+  static inline void name##_reserve(name##_t *vec, size_t capacity) {          \
+    if (capacity <= vec->capacity) {                                           \
+      return;                                                                  \
+    }                                                                          \
+    type *heap = VEC_REALLOC(vec->heap, capacity * sizeof(type));              \
+    assert(heap);                                                              \
+    /* Moving out of local storage, which realloc doesn't know about */        \
+    if ((local_capacity) > 0 && vec->heap == NULL && vec->size > 0) {          \
+      memcpy(heap, name##_data(vec), vec->size * sizeof(type));                \
+    }                                                                          \
+    vec->heap = heap;                                                          \
+    vec->capacity = capacity;                                                  \
+  }                                                                            \
+                                                                               \
+  static inline void name##_push(name##_t *vec, type value) {                  \
+    if (vec->size == vec->capacity) {                                          \
+      name##_reserve(vec, vec->capacity > 0                                    \
+                              ? vec->capacity * VEC_GROWTH_FACTOR              \
+                              : 1);                                            \
+    }                                                                          \
+    name##_data(vec)[vec->size++] = value;                                     \
+  }                                                                            \
+                                                                               \
+  static inline type name##_swap_remove(name##_t *vec, size_t index) {         \
+    assert(index < vec->size);                                                 \
+    type *data = name##_data(vec);                                             \
+    type removed = data[index];                                                \
+    data[index] = data[--vec->size];                                           \
+    return removed;                                                            \
+  }                                                                            \
+                                                                               \
+  static inline size_t name##_remove_if(                                       \
+      name##_t *vec, bool (*remove)(type *, void *), void *aux) {              \
+    type *data = name##_data(vec);                                             \
+    size_t kept = 0;                                                           \
+    for (size_t i = 0; i < vec->size; i++) {                                   \
+      if (!remove(&data[i], aux)) {                                            \
+        data[kept++] = data[i];                                                \
+      }                                                                        \
+    }                                                                          \
+    size_t removed = vec->size - kept;                                         \
+    vec->size = kept;                                                          \
+    return removed;                                                            \
+  }                                                                            \
+                                                                               \
+  static inline void name##_clear(name##_t *vec) { vec->size = 0; }
+
+/**
+ * A handle to a value in a slot map: the index of its slot, and the slot's
+ * generation when the value was inserted.
+ */
+typedef struct slot_handle {
+  uint32_t index;
+  uint32_t generation;
+} slot_handle_t;
+
+// Ends a slot map's list of unused slots
+#define SLOT_MAP_NO_SLOT UINT32_MAX
+
+/**
+ * Generational slot maps, which store values in slots that are reused once
+ * their value is erased. A handle to a value stays valid until the value is
+ * erased, and is then detected as stale instead of finding whatever value
+ * has taken its slot. Inserting, erasing and finding a value take constant
+ * time, and erasing one never moves the others.
+ *
+ * DEFINE_SLOT_MAP(name, type) defines the map type name_t, along with:
+ *
+ *   void name_init(name_t *map)
+ *     Makes an empty map, which allocates nothing until a value is inserted.
+ *   void name_free(name_t *map)
+ *     Frees the map's storage. Doesn't free anything the values point to.
+ *   void name_reserve(name_t *map, size_t capacity)
+ *     Makes room for capacity slots.
+ *   slot_handle_t name_insert(name_t *map, type value)
+ *     Stores a value, reusing the slot of an erased value if there is one.
+ *   type *name_find(name_t *map, slot_handle_t handle)
+ *     Gets the value a handle refers to, or NULL if the handle is stale.
+ *   bool name_erase(name_t *map, slot_handle_t handle)
+ *     Erases the value a handle refers to, making the handle stale, and
+ *     returns whether there was one.
+ *   size_t name_size(name_t *map)
+ *     Gets the number of values.
+ *   size_t name_slots(name_t *map)
+ *     Gets the number of slots, used or not.
+ *   type *name_get_slot(name_t *map, size_t index)
+ *     Gets the value in a slot, or NULL if the slot is unused.
+ *   slot_handle_t name_handle(name_t *map, size_t index)
+ *     Gets a handle to the value in a slot, asserting that the slot is used.
+ */
+#define DEFINE_SLOT_MAP(name, type)                                            \
+  typedef struct name##_slot {                                                 \
+    type value;                                                                \
+    /* Odd while the slot is used, so no handle has generation 0 */            \
+    uint32_t generation;                                                       \
+    /* The next unused slot, if this one is unused */                          \
+    uint32_t next_free;                                                        \
+  } name##_slot_t;                                                             \
+                                                                               \
+  DEFINE_VEC(name##_slot_list, name##_slot_t)                                  \
+                                                                               \
+  typedef struct name {                                                        \
+    name##_slot_list_t slots;                                                  \
+    size_t size;                                                               \
+    /* The first unused slot, or SLOT_MAP_NO_SLOT if every slot is used */     \
+    uint32_t first_free;                                                       \
+  } name##_t;                                                                  \
+                                                                               \
+  static inline void name##_init(name##_t *map) {                              \
+    name##_slot_list_init(&map->slots);                                        \
+    map->size = 0;                                                             \
+    map->first_free = SLOT_MAP_NO_SLOT;                                        \
+  }                                                                            \
+                                                                               \
+  static inline void name##_free(name##_t *map) {                              \
+    name##_slot_list_free(&map->slots);                                        \
+    map->size = 0;                                                             \
+    map->first_free = SLOT_MAP_NO_SLOT;                                        \
+  }                                                                            \
+                                                                               \
+  static inline void name##_reserve(name##_t *map, size_t capacity) {          \
+    name##_slot_list_reserve(&map->slots, capacity);                           \
+  }                                                                            \
+                                                                               \
+  static inline slot_handle_t name##_insert(name##_t *map, type value) {       \
+    uint32_t index = map->first_free;                                          \
+    name##_slot_t *slot;                                                       \
+    if (index != SLOT_MAP_NO_SLOT) {                                           \
+      slot = name##_slot_list_get(&map->slots, index);                         \
+      map->first_free = slot->next_free;                                       \
+    } else {                                                                   \
+      index = name##_slot_list_size(&map->slots);                              \
+      assert(index != SLOT_MAP_NO_SLOT);                                       \
+      name##_slot_list_push(&map->slots,                                       \
+                            (name##_slot_t){.next_free = SLOT_MAP_NO_SLOT});   \
+      slot = name##_slot_list_get(&map->slots, index);                         \
+    }                                                                          \
+    slot->value = value;                                                       \
+    slot->generation++;                                                        \
+    map->size++;                                                               \
+    return (slot_handle_t){index, slot->generation};                           \
+  }                                                                            \
+                                                                               \
+  static inline type *name##_find(name##_t *map, slot_handle_t handle) {       \
+    if (handle.index >= name##_slot_list_size(&map->slots)) {                  \
+      return NULL;                                                             \
+    }                                                                          \
+    name##_slot_t *slot = name##_slot_list_get(&map->slots, handle.index);     \
+    /* Unused slots have even generations, which no handle has */              \
+    if (slot->generation != handle.generation || handle.generation % 2 == 0) { \
+      return NULL;                                                             \
+    }                                                                          \
+    return &slot->value;                                                       \
+  }                                                                            \
+                                                                               \
+  static inline bool name##_erase(name##_t *map, slot_handle_t handle) {       \
+    if (name##_find(map, handle) == NULL) {                                    \
+      return false;                                                            \
+    }                                                                          \
+    name##_slot_t *slot = name##_slot_list_get(&map->slots, handle.index);     \
+    slot->generation++;                                                        \
+    slot->next_free = map->first_free;                                         \
+    map->first_free = handle.index;                                            \
+    map->size--;                                                               \
+    return true;                                                               \
+  }                                                                            \
+                                                                               \
+  static inline size_t name##_size(name##_t *map) { return map->size; }       \
+                                                                               \
+  static inline size_t name##_slots(name##_t *map) {                           \
+    return name##_slot_list_size(&map->slots);                                 \
+  }                                                                            \
+                                                                               \
+  static inline type *name##_get_slot(name##_t *map, size_t index) {           \
+    name##_slot_t *slot = name##_slot_list_get(&map->slots, index);            \
+    return slot->generation % 2 == 1 ? &slot->value : NULL;                    \
+  }                                                                            \
+                                                                               \
+  static inline slot_handle_t name##_handle(name##_t *map, size_t index) {     \
+    name##_slot_t *slot = name##_slot_list_get(&map->slots, index);            \
+    assert(slot->generation % 2 == 1);                                         \
+    return (slot_handle_t){index, slot->generation};                           \
+  }
+
+#endif // #ifndef __VEC_H__
@@ -0,0 +1,189 @@
+#include "alloc.h"
+
+#include <assert.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+// This file implements the allocator, so it calls the real functions
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
+// Indexed by alloc_tag_t
+const char *ALLOC_TAG_NAMES[] = {"other",     "containers", "physics",
+                                 "collision", "render",     "assets",
+                                 "audio",     "profiling"};
+
+/**
+ * Stored just before each block, so freeing it knows what to count it against.
+ * The padding keeps the block as aligned as malloc() would.
+ */
+typedef struct {
+  size_t size;
+  alloc_tag_t tag;
+  alignas(max_align_t) char block[];
+} alloc_header_t;
+
+/**
+ * Counters for one subsystem. Atomic, since loader and simulation threads
+ * allocate too.
+ */
+typedef struct {
+  atomic_size_t frame_allocs;
+  atomic_size_t frame_bytes;
+  atomic_size_t live_bytes;
+  atomic_size_t peak_bytes;
+  atomic_size_t total_allocs;
+  // The last completed frame's counts
+  atomic_size_t last_frame_allocs;
+  atomic_size_t last_frame_bytes;
+} alloc_counters_t;
+
+alloc_counters_t alloc_counters[NUM_ALLOC_TAGS];
+size_t alloc_frame_budget = SIZE_MAX;
+
+static alloc_header_t *alloc_get_header(void *ptr) {
+  return (alloc_header_t *)((char *)ptr - offsetof(alloc_header_t, block));
+}
+
+/**
+ * Counts a new block against a subsystem.
+ */
+static void alloc_count(alloc_tag_t tag, size_t size) {
+  assert(tag < NUM_ALLOC_TAGS);
+  alloc_counters_t *counters = &alloc_counters[tag];
+  atomic_fetch_add(&counters->frame_allocs, 1);
+  atomic_fetch_add(&counters->frame_bytes, size);
+  atomic_fetch_add(&counters->total_allocs, 1);
+  size_t live = atomic_fetch_add(&counters->live_bytes, size) + size;
+  size_t peak = atomic_load(&counters->peak_bytes);
+  while (live > peak &&
+         !atomic_compare_exchange_weak(&counters->peak_bytes, &peak, live)) {
+  }
+}
+
+/**
+ * Stops counting a block that is being freed or resized.
+ */
+static void alloc_uncount(alloc_tag_t tag, size_t size) {
+  atomic_fetch_sub(&alloc_counters[tag].live_bytes, size);
+}
+
+void *alloc_malloc(size_t size, alloc_tag_t tag) {
+  alloc_header_t *header = malloc(sizeof(alloc_header_t) + size);
+  if (header == NULL) {
+    return NULL;
+  }
+  header->size = size;
+  header->tag = tag;
+  alloc_count(tag, size);
+  return header->block;
+}
+
+void *alloc_calloc(size_t count, size_t size, alloc_tag_t tag) {
+  if (size != 0 && count > SIZE_MAX / size) {
+    return NULL;
+  }
+  void *block = alloc_malloc(count * size, tag);
+  if (block != NULL) {
+    memset(block, 0, count * size);
+  }
+  return block;
+}
+
+void *alloc_realloc(void *ptr, size_t size, alloc_tag_t tag) {
+  if (ptr == NULL) {
+    return alloc_malloc(size, tag);
+  }
+  alloc_header_t *old = alloc_get_header(ptr);
+  size_t old_size = old->size;
+  alloc_tag_t old_tag = old->tag;
+  alloc_header_t *header = realloc(old, sizeof(alloc_header_t) + size);
+  if (header == NULL) {
+    return NULL;
+  }
+  alloc_uncount(old_tag, old_size);
+  header->size = size;
+  header->tag = tag;
+  alloc_count(tag, size);
+  return header->block;
+}
+
+void alloc_free(void *ptr) {
+  if (ptr == NULL) {
+    return;
+  }
+  alloc_header_t *header = alloc_get_header(ptr);
+  alloc_uncount(header->tag, header->size);
+  free(header);
+}
+
+void *vec_realloc(void *ptr, size_t size) {
+  return alloc_realloc(ptr, size, ALLOC_CONTAINERS);
+}
+
+void vec_free(void *ptr) { alloc_free(ptr); }
+
+const char *alloc_tag_name(alloc_tag_t tag) {
+  assert(tag < NUM_ALLOC_TAGS);
+  return ALLOC_TAG_NAMES[tag];
+}
+
+alloc_stats_t alloc_get_stats(alloc_tag_t tag) {
+  assert(tag < NUM_ALLOC_TAGS);
+  alloc_counters_t *counters = &alloc_counters[tag];
+  return (alloc_stats_t){
+      .frame_allocs = atomic_load(&counters->last_frame_allocs),
+      .frame_bytes = atomic_load(&counters->last_frame_bytes),
+      .live_bytes = atomic_load(&counters->live_bytes),
+      .peak_bytes = atomic_load(&counters->peak_bytes),
+      .total_allocs = atomic_load(&counters->total_allocs)};
+}
+
+alloc_stats_t alloc_get_total_stats(void) {
+  alloc_stats_t total = {0};
+  for (alloc_tag_t tag = 0; tag < NUM_ALLOC_TAGS; tag++) {
+    alloc_stats_t stats = alloc_get_stats(tag);
+    total.frame_allocs += stats.frame_allocs;
+    total.frame_bytes += stats.frame_bytes;
+    total.live_bytes += stats.live_bytes;
+    total.peak_bytes += stats.peak_bytes;
+    total.total_allocs += stats.total_allocs;
+  }
+  return total;
+}
+
+void alloc_set_frame_budget(size_t max_allocs) {
+  alloc_frame_budget = max_allocs;
+}
+
+void alloc_end_frame(void) {
+  for (alloc_tag_t tag = 0; tag < NUM_ALLOC_TAGS; tag++) {
+    alloc_counters_t *counters = &alloc_counters[tag];
+    atomic_store(&counters->last_frame_allocs,
+                 atomic_exchange(&counters->frame_allocs, 0));
+    atomic_store(&counters->last_frame_bytes,
+                 atomic_exchange(&counters->frame_bytes, 0));
+  }
+
+  size_t frame_allocs = alloc_get_total_stats().frame_allocs;
+  if (frame_allocs > alloc_frame_budget) {
+    fprintf(stderr, "Frame made %zu allocations, over its budget of %zu\n",
+            frame_allocs, alloc_frame_budget);
+    alloc_report(stderr);
+  }
+  assert(frame_allocs <= alloc_frame_budget);
+}
+
+void alloc_report(FILE *out) {
+  fprintf(out, "%-12s %12s %12s %12s %12s %12s\n", "subsystem", "frame allocs",
+          "frame bytes", "live bytes", "peak bytes", "total allocs");
+  for (alloc_tag_t tag = 0; tag < NUM_ALLOC_TAGS; tag++) {
+    alloc_stats_t stats = alloc_get_stats(tag);
+    fprintf(out, "%-12s %12zu %12zu %12zu %12zu %12zu\n", alloc_tag_name(tag),
+            stats.frame_allocs, stats.frame_bytes, stats.live_bytes,
+            stats.peak_bytes, stats.total_allocs);
+  }
+}
@@ -5,8 +5,12 @@
 #include "asset.h"
 #include "asset_cache.h"
 #include "color.h"
+#include "render_snapshot.h"
 #include "sdl_wrapper.h"
 
+#define ALLOC_TAG ALLOC_RENDER
+#include "alloc.h"
+
 typedef struct asset {
   asset_type_t type;
   SDL_Rect bounding_box;
@@ -14,14 +18,16 @@ typedef struct asset {
 
 typedef struct text_asset {
   asset_t base;
-  TTF_Font *font;
+  font_handle_t font;
   const char *text;
   rgb_color_t color;
+  // Whether the text changes often and is drawn from a glyph atlas
+  bool dynamic;
 } text_asset_t;
 
 typedef struct image_asset {
   asset_t base;
-  SDL_Texture *texture;
+  image_handle_t image;
   body_t *body;
 } image_asset_t;
 
@@ -34,6 +40,8 @@ typedef struct button_asset {
 } button_asset_t;
 
 const size_t FONT_SIZE_1 = 18;
+// How far off screen, in scene units, a body's image is still drawn
+const double CULL_MARGIN = 50;
 
 /**
  * Allocates memory for an asset with the given parameters.
@@ -70,12 +78,17 @@ static asset_t *asset_init(asset_type_t ty, SDL_Rect bounding_box) {
 
 asset_type_t asset_get_type(asset_t *asset) { return asset->type; }
 
+body_t *asset_get_body(asset_t *asset) {
+  if (asset->type != ASSET_IMAGE) {
+    return NULL;
+  }
+  return ((image_asset_t *)asset)->body;
+}
+
 asset_t *asset_make_image(const char *filepath, SDL_Rect bounding_box) {
   image_asset_t *asset = (image_asset_t *)asset_init(ASSET_IMAGE, bounding_box);
 
-  SDL_Texture *texture_init =
-      (SDL_Texture *)asset_cache_obj_get_or_create(ASSET_IMAGE, filepath);
-  asset->texture = texture_init;
+  asset->image = asset_cache_get_image(filepath);
   asset->body = NULL;
 
   return (asset_t *)asset;
@@ -92,25 +105,40 @@ asset_t *asset_make_image_with_body(const char *filepath, body_t *body, double v
   // Initialize the image asset with the bounding box
   image_asset_t *asset = (image_asset_t *)asset_init(ASSET_IMAGE, bounding_box);
 
-  asset->texture =
-      (SDL_Texture *)asset_cache_obj_get_or_create(ASSET_IMAGE, filepath);
+  asset->image = asset_cache_get_image(filepath);
   asset->body = body;
 
   return (asset_t *)asset;
 }
 
+void asset_set_image(asset_t *asset, const char *filepath) {
+  assert(asset->type == ASSET_IMAGE);
+  image_asset_t *image = (image_asset_t *)asset;
+  // Take the new handle first, so an image set again isn't evicted between
+  image_handle_t new_image = asset_cache_get_image(filepath);
+  asset_cache_release_image(image->image);
+  image->image = new_image;
+}
+
 asset_t *asset_make_text(const char *filepath, SDL_Rect bounding_box,
                          const char *text, rgb_color_t color) {
   text_asset_t *asset = (text_asset_t *)asset_init(ASSET_FONT, bounding_box);
-  TTF_Font *font_init =
-      (TTF_Font *)asset_cache_obj_get_or_create(ASSET_FONT, filepath);
-  asset->font = font_init;
+  asset->font = asset_cache_get_font(filepath);
   asset->text = text;
   asset->color = color;
+  asset->dynamic = false;
 
   return (asset_t *)asset;
 }
 
+asset_t *asset_make_dynamic_text(const char *filepath, SDL_Rect bounding_box,
+                                 const char *text, rgb_color_t color) {
+  text_asset_t *asset =
+      (text_asset_t *)asset_make_text(filepath, bounding_box, text, color);
+  asset->dynamic = true;
+  return (asset_t *)asset;
+}
+
 asset_t *asset_make_button(SDL_Rect bounding_box, asset_t *image_asset,
                            asset_t *text_asset, button_handler_t handler) {
   if (image_asset != NULL) {
@@ -148,6 +176,33 @@ bool asset_on_button_click(asset_t *asset, state_t *state, double x, double y) {
   return is_clicked;
 }
 
+/**
+ * Moves an image's bounding box onto its body, if it has one.
+ *
+ * @return false if the body is out of view and the image shouldn't be drawn
+ */
+static bool image_asset_update_box(image_asset_t *image,
+                                   double vertical_offset) {
+  if (image->body != NULL) {
+    // Skip bodies the camera can't see, before converting their bounds
+    vector_t min, max;
+    body_get_bounds(image->body, &min, &max);
+    if (!sdl_in_view(min, max, vertical_offset, CULL_MARGIN)) {
+      return false;
+    }
+    get_body_bounding_box(image->body, &image->base.bounding_box, vertical_offset);
+  }
+  return true;
+}
+
+/**
+ * Converts a text asset's color to the color SDL draws it in.
+ */
+static SDL_Color text_asset_sdl_color(text_asset_t *text_asset) {
+  rgb_color_t rgb = text_asset->color;
+  return (SDL_Color){rgb.r * 255, rgb.g * 255, rgb.b * 255, 255};
+}
+
 void asset_render(asset_t *asset, double vertical_offset) {
   SDL_Rect box = asset->bounding_box;
   vector_t loc = {box.x, box.y};
@@ -155,29 +210,25 @@ void asset_render(asset_t *asset, double vertical_offset) {
   switch (asset->type) {
   case ASSET_IMAGE: {
     image_asset_t *image = (image_asset_t *)asset;
-    SDL_Texture *texture = image->texture;
-
-    if (image->body != NULL) {
-      get_body_bounding_box(image->body, &image->base.bounding_box, vertical_offset);
+    if (image_asset_update_box(image, vertical_offset)) {
+      sprite_t *sprite = asset_cache_image(image->image);
+      if (sprite->texture != NULL) {
+        sdl_batch_draw(sprite->texture, &sprite->src, image->base.bounding_box);
+      }
     }
-
-    SDL_Rect box = image->base.bounding_box;
-    vector_t loc = {box.x, box.y};
-    vector_t size = {box.w, box.h};
-    sdl_render_image(texture, loc, size);
     break;
   }
 
   case ASSET_FONT: {
     text_asset_t *text_asset = (text_asset_t *)asset;
-    TTF_Font *font = text_asset->font;
+    TTF_Font *font = asset_cache_font(text_asset->font);
     const char *text = text_asset->text;
-    SDL_Color *color = malloc(sizeof(SDL_Color));
-    assert(color);
-    color->r = text_asset->color.r;
-    color->g = text_asset->color.g;
-    color->b = text_asset->color.b;
-    sdl_render_font(font, text, loc, *color, FONT_SIZE_1);
+    SDL_Color color = text_asset_sdl_color(text_asset);
+    if (text_asset->dynamic) {
+      sdl_render_glyphs(font, text, loc, color);
+    } else {
+      sdl_render_font(font, text, loc, color, FONT_SIZE_1);
+    }
     break;
   }
 
@@ -190,7 +241,55 @@ void asset_render(asset_t *asset, double vertical_offset) {
     button->is_rendered = true;
     break;
   }
+
+  case ASSET_SOUND:
+    assert(false && "Sounds are cache entries, not assets");
   }
 }
 
-void asset_destroy(asset_t *asset) { free(asset); }
+void asset_snapshot(asset_t *asset, render_snapshot_t *snapshot,
+                    double vertical_offset) {
+  switch (asset->type) {
+  case ASSET_IMAGE: {
+    image_asset_t *image = (image_asset_t *)asset;
+    if (image_asset_update_box(image, vertical_offset)) {
+      render_snapshot_add_image(snapshot, image->image,
+                                image->base.bounding_box);
+    }
+    break;
+  }
+
+  case ASSET_FONT: {
+    text_asset_t *text_asset = (text_asset_t *)asset;
+    vector_t loc = {asset->bounding_box.x, asset->bounding_box.y};
+    render_snapshot_add_text(snapshot, text_asset->font, text_asset->text, loc,
+                             text_asset_sdl_color(text_asset), FONT_SIZE_1,
+                             text_asset->dynamic);
+    break;
+  }
+
+  case ASSET_BUTTON: {
+    button_asset_t *button = (button_asset_t *)asset;
+    asset_snapshot((asset_t *)button->image_asset, snapshot, vertical_offset);
+    if (button->text_asset != NULL) {
+      asset_snapshot((asset_t *)button->text_asset, snapshot,
+                     vertical_offset);
+    }
+    button->is_rendered = true;
+    break;
+  }
+
+  case ASSET_SOUND:
+    assert(false && "Sounds are cache entries, not assets");
+  }
+}
+
+void asset_destroy(asset_t *asset) {
+  // Let the cache evict what only this asset was using
+  if (asset->type == ASSET_IMAGE) {
+    asset_cache_release_image(((image_asset_t *)asset)->image);
+  } else if (asset->type == ASSET_FONT) {
+    asset_cache_release_font(((text_asset_t *)asset)->font);
+  }
+  free(asset);
+}
@@ -1,123 +1,589 @@
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 #include <assert.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "asset.h"
 #include "asset_cache.h"
+#include "asset_loader.h"
+#include "asset_pack.h"
 #include "color.h"
 #include "list.h"
 #include "sdl_wrapper.h"
 
-static list_t *ASSET_CACHE;
-
-const size_t FONT_SIZE = 18;
-const size_t INITIAL_CAPACITY = 5;
+#define ALLOC_TAG ALLOC_ASSETS
+#include "alloc.h"
 
 typedef struct entry {
   asset_type_t type;
+  // Interned copy of the path, owned by the cache
   const char *filepath;
+  uint32_t hash;
+  /**
+   * The sprite_t, TTF_Font or Mix_Chunk. An image keeps its sprite when it
+   * is evicted or not loaded yet, with a NULL texture; a sound is NULL while
+   * it is evicted or still loading.
+   */
   void *obj;
+  // Whether an image entry's texture belongs to it rather than to an atlas
+  bool owns_texture;
+  // Whether the asset is being loaded in the background
+  bool loading;
+  // Whether the asset was evicted or hasn't been loaded yet, and must be
+  // loaded when used
+  bool evicted;
+  // The number of handles to the entry that haven't been released
+  size_t refs;
+  // Approximately how much memory the asset uses; 0 if it can't be evicted
+  size_t bytes;
+  // Neighbouring handle ids in the least recently used list, or 0 for none
+  size_t lru_prev;
+  size_t lru_next;
 } entry_t;
 
-static void asset_cache_free_entry(entry_t *entry) {
-  if (entry == NULL) {
-    return;
+/**
+ * Every cached image, font and sound, indexed by handle id - 1.
+ * Entries are never removed before asset_cache_destroy(), so handles stay
+ * valid even when the array is reallocated or the asset is evicted.
+ */
+static entry_t *ENTRIES;
+static size_t NUM_ENTRIES;
+static size_t ENTRY_CAPACITY;
+/**
+ * Open-addressing hash table from path to entry. Each slot holds an index
+ * into ENTRIES plus one, or 0 if it is empty. Its size is a power of two,
+ * kept at least twice the number of entries.
+ */
+static size_t *SLOTS;
+static size_t NUM_SLOTS;
+/**
+ * The entries in order of use, most recent first, as handle ids.
+ */
+static size_t LRU_HEAD;
+static size_t LRU_TAIL;
+// The total bytes of the loaded entries, and how high it may grow
+static size_t USED_BYTES;
+static size_t BUDGET_BYTES;
+static list_t *BUTTONS;
+// Atlas textures shared by the sprites of several image entries
+static list_t *ATLAS_PAGES;
+// Pre-decoded assets loaded instead of their files, if a pack was opened
+static asset_pack_t *PACK;
+
+const size_t FONT_SIZE = 18;
+const size_t INITIAL_CAPACITY = 5;
+const size_t INITIAL_SLOTS = 64;
+const size_t DEFAULT_BUDGET_BYTES = 64 << 20;
+const uint32_t PATH_HASH_BASIS = 2166136261u;
+const uint32_t PATH_HASH_PRIME = 16777619u;
+
+/**
+ * Hashes a path with 32-bit FNV-1a.
+ */
+static uint32_t asset_cache_hash(const char *filepath) {
+  uint32_t hash = PATH_HASH_BASIS;
+  for (const char *c = filepath; *c != '\0'; c++) {
+    hash = (hash ^ (uint8_t)*c) * PATH_HASH_PRIME;
+  }
+  return hash;
+}
+
+/**
+ * Finds the slot that holds the entry for a path, or the empty slot where it
+ * would go.
+ */
+static size_t *asset_cache_find_slot(const char *filepath, uint32_t hash) {
+  size_t mask = NUM_SLOTS - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    size_t index = SLOTS[i];
+    if (index == 0) {
+      return &SLOTS[i];
+    }
+    entry_t *entry = &ENTRIES[index - 1];
+    if (entry->hash == hash && strcmp(entry->filepath, filepath) == 0) {
+      return &SLOTS[i];
+    }
   }
+}
 
-  if (entry->filepath != NULL) {
-    free((void *)entry->filepath);
+/**
+ * Doubles the size of the hash table and reinserts every entry.
+ */
+static void asset_cache_grow_slots() {
+  free(SLOTS);
+  NUM_SLOTS *= 2;
+  SLOTS = calloc(NUM_SLOTS, sizeof(size_t));
+  assert(SLOTS);
+  for (size_t i = 0; i < NUM_ENTRIES; i++) {
+    *asset_cache_find_slot(ENTRIES[i].filepath, ENTRIES[i].hash) = i + 1;
   }
+}
+
+/**
+ * Looks up the entry for a path.
+ *
+ * @return the entry's handle id, or 0 if the path isn't cached
+ */
+static size_t asset_cache_lookup(const char *filepath) {
+  assert(filepath != NULL);
+  return *asset_cache_find_slot(filepath, asset_cache_hash(filepath));
+}
+
+/**
+ * Makes an entry the most recently used.
+ */
+static void asset_cache_lru_push(size_t id) {
+  entry_t *entry = &ENTRIES[id - 1];
+  entry->lru_prev = 0;
+  entry->lru_next = LRU_HEAD;
+  if (LRU_HEAD != 0) {
+    ENTRIES[LRU_HEAD - 1].lru_prev = id;
+  } else {
+    LRU_TAIL = id;
+  }
+  LRU_HEAD = id;
+}
+
+static void asset_cache_lru_unlink(size_t id) {
+  entry_t *entry = &ENTRIES[id - 1];
+  if (entry->lru_prev != 0) {
+    ENTRIES[entry->lru_prev - 1].lru_next = entry->lru_next;
+  } else {
+    LRU_HEAD = entry->lru_next;
+  }
+  if (entry->lru_next != 0) {
+    ENTRIES[entry->lru_next - 1].lru_prev = entry->lru_prev;
+  } else {
+    LRU_TAIL = entry->lru_prev;
+  }
+}
+
+/**
+ * Adds an entry for an asset that isn't in the cache yet, interning its path.
+ *
+ * @return the new entry's handle id
+ */
+static size_t asset_cache_add_entry(asset_type_t ty, const char *filepath,
+                                    void *obj, bool owns_texture) {
+  if (NUM_ENTRIES == ENTRY_CAPACITY) {
+    ENTRY_CAPACITY *= 2;
+    ENTRIES = realloc(ENTRIES, ENTRY_CAPACITY * sizeof(entry_t));
+    assert(ENTRIES);
+  }
+  if (2 * (NUM_ENTRIES + 1) > NUM_SLOTS) {
+    asset_cache_grow_slots();
+  }
+
+  char *interned = malloc(strlen(filepath) + 1);
+  assert(interned);
+  strcpy(interned, filepath);
+
+  entry_t *entry = &ENTRIES[NUM_ENTRIES];
+  entry->type = ty;
+  entry->filepath = interned;
+  entry->hash = asset_cache_hash(interned);
+  entry->obj = obj;
+  entry->owns_texture = owns_texture;
+  entry->loading = false;
+  entry->evicted = false;
+  entry->refs = 0;
+  entry->bytes = 0;
+  size_t *slot = asset_cache_find_slot(interned, entry->hash);
+  *slot = ++NUM_ENTRIES;
+  asset_cache_lru_push(NUM_ENTRIES);
+  return NUM_ENTRIES;
+}
+
+/**
+ * Frees what an entry has loaded, leaving the entry itself (and an image's
+ * sprite) in place.
+ */
+static void asset_cache_unload(entry_t *entry) {
+  USED_BYTES -= entry->bytes;
+  entry->bytes = 0;
 
   switch (entry->type) {
-  case ASSET_IMAGE:
-    SDL_DestroyTexture((SDL_Texture *)entry->obj);
+  case ASSET_IMAGE: {
+    sprite_t *sprite = entry->obj;
+    if (entry->owns_texture && sprite->texture != NULL) {
+      SDL_DestroyTexture(sprite->texture);
+      sprite->texture = NULL;
+    }
     break;
+  }
 
   case ASSET_FONT:
-    TTF_CloseFont((TTF_Font *)entry->obj);
+    if (entry->obj != NULL) {
+      TTF_CloseFont((TTF_Font *)entry->obj);
+    }
+    entry->obj = NULL;
+    break;
+
+  case ASSET_SOUND:
+    if (entry->obj != NULL) {
+      Mix_FreeChunk((Mix_Chunk *)entry->obj);
+    }
+    entry->obj = NULL;
     break;
 
   case ASSET_BUTTON:
-    asset_destroy(entry->obj);
     break;
   }
-  free(entry);
+}
+
+/**
+ * Evicts unreferenced entries, least recently used first, until the loaded
+ * entries fit in the budget or nothing more can be evicted.
+ */
+static void asset_cache_enforce_budget() {
+  size_t id = LRU_TAIL;
+  while (USED_BYTES > BUDGET_BYTES && id != 0) {
+    entry_t *entry = &ENTRIES[id - 1];
+    size_t prev = entry->lru_prev;
+    if (entry->refs == 0 && !entry->loading && entry->bytes > 0) {
+      asset_cache_unload(entry);
+      entry->evicted = true;
+    }
+    id = prev;
+  }
+}
+
+/**
+ * Records how much memory an entry's newly loaded asset uses. If it is an
+ * image, evicts others if that goes over the budget; evicting destroys
+ * textures, so it only happens when an image is loaded, which is always on
+ * the thread that draws.
+ */
+static void asset_cache_account(entry_t *entry) {
+  entry->bytes = 0;
+  if (entry->type == ASSET_IMAGE) {
+    sprite_t *sprite = entry->obj;
+    if (entry->owns_texture && sprite->texture != NULL) {
+      Uint32 format;
+      SDL_QueryTexture(sprite->texture, &format, NULL, NULL, NULL);
+      entry->bytes = (size_t)sprite->src.w * sprite->src.h *
+                     SDL_BYTESPERPIXEL(format);
+    }
+  } else if (entry->type == ASSET_SOUND && entry->obj != NULL) {
+    entry->bytes = ((Mix_Chunk *)entry->obj)->alen;
+  }
+  USED_BYTES += entry->bytes;
+  if (entry->type == ASSET_IMAGE) {
+    asset_cache_enforce_budget();
+  }
 }
 
 void asset_cache_init() {
-  ASSET_CACHE =
-      list_init(INITIAL_CAPACITY, (free_func_t)asset_cache_free_entry);
-}
-
-void asset_cache_destroy() { list_free(ASSET_CACHE); }
-
-entry_t *asset_cache_get_entry(const char *filepath) {
-  if (filepath != NULL) {
-    for (size_t i = 0; i < list_size(ASSET_CACHE); i++) {
-      entry_t *entry = list_get(ASSET_CACHE, i);
-      const char *filecomp = entry->filepath;
-      if (filecomp != NULL) {
-        if (strcmp(filepath, filecomp) == 0) {
-          return entry;
-        }
-      }
+  ENTRY_CAPACITY = INITIAL_CAPACITY;
+  NUM_ENTRIES = 0;
+  ENTRIES = malloc(ENTRY_CAPACITY * sizeof(entry_t));
+  assert(ENTRIES);
+  NUM_SLOTS = INITIAL_SLOTS;
+  SLOTS = calloc(NUM_SLOTS, sizeof(size_t));
+  assert(SLOTS);
+  LRU_HEAD = 0;
+  LRU_TAIL = 0;
+  USED_BYTES = 0;
+  BUDGET_BYTES = DEFAULT_BUDGET_BYTES;
+  BUTTONS = list_init(INITIAL_CAPACITY, (free_func_t)asset_destroy);
+  ATLAS_PAGES = list_init(INITIAL_CAPACITY, (free_func_t)SDL_DestroyTexture);
+  PACK = NULL;
+  asset_loader_init();
+}
+
+void asset_cache_destroy() {
+  // Stop loading first, so nothing arrives for a freed entry
+  asset_loader_free();
+  sdl_clear_text_cache();
+  list_free(BUTTONS);
+  for (size_t i = 0; i < NUM_ENTRIES; i++) {
+    entry_t *entry = &ENTRIES[i];
+    asset_cache_unload(entry);
+    if (entry->type == ASSET_IMAGE) {
+      free(entry->obj);
     }
+    free((void *)entry->filepath);
+  }
+  free(ENTRIES);
+  free(SLOTS);
+  list_free(ATLAS_PAGES);
+  if (PACK != NULL) {
+    asset_pack_close(PACK);
   }
-  return NULL;
 }
 
-void *asset_cache_obj_get_or_create(asset_type_t ty, const char *filepath) {
-  entry_t *entry = asset_cache_get_entry(filepath);
+void asset_cache_set_budget(size_t bytes) {
+  BUDGET_BYTES = bytes;
+  asset_cache_enforce_budget();
+}
+
+size_t asset_cache_get_usage() { return USED_BYTES; }
+
+bool asset_cache_open_pack(const char *filepath) {
+  assert(PACK == NULL);
+  PACK = asset_pack_open(filepath);
+  asset_loader_use_pack(PACK);
+  return PACK != NULL;
+}
 
-  if (entry != NULL) {
-    assert(entry->type == ty);
-    return entry->obj;
+sound_stream_t *asset_cache_open_stream(const char *filepath) {
+  const pack_entry_t *entry =
+      PACK != NULL ? asset_pack_find(PACK, filepath) : NULL;
+  if (entry != NULL && entry->type == PACK_SOUND) {
+    return sound_stream_open_raw(asset_pack_data(PACK, entry), entry->size,
+                                 entry->sound.format, entry->sound.frequency,
+                                 entry->sound.channels);
   }
+  return sound_stream_open(filepath);
+}
 
-  void *object = NULL;
+/**
+ * Decodes an image, or wraps its pixels if it is in the pack.
+ * The caller frees the surface.
+ */
+static SDL_Surface *asset_cache_load_surface(const char *filepath) {
+  SDL_Surface *surface = PACK != NULL ? asset_pack_image(PACK, filepath) : NULL;
+  return surface != NULL ? surface : IMG_Load(filepath);
+}
 
-  switch (ty) {
-  case ASSET_IMAGE:
-    object = sdl_load_image(filepath);
-    break;
-  case ASSET_FONT: {
-    object = sdl_load_font(filepath, (int8_t)FONT_SIZE);
+/**
+ * Makes a sprite with no texture yet, for an image entry.
+ */
+static sprite_t *asset_cache_sprite_init() {
+  sprite_t *sprite = malloc(sizeof(sprite_t));
+  assert(sprite);
+  sprite->texture = NULL;
+  sprite->src = (SDL_Rect){0, 0, 0, 0};
+  return sprite;
+}
+
+/**
+ * Loads an entry's asset from the pack or its file, and waits for it.
+ */
+static void asset_cache_load(entry_t *entry) {
+  switch (entry->type) {
+  case ASSET_IMAGE: {
+    sprite_t *sprite = entry->obj;
+    SDL_Surface *surface = asset_cache_load_surface(entry->filepath);
+    if (surface != NULL) {
+      sprite->texture = sdl_create_texture(surface);
+      sprite->src = (SDL_Rect){0, 0, surface->w, surface->h};
+      SDL_FreeSurface(surface);
+    }
     break;
   }
-  case ASSET_BUTTON:
+
+  case ASSET_FONT:
+    entry->obj = sdl_load_font(entry->filepath, (int8_t)FONT_SIZE);
+    break;
+
+  case ASSET_SOUND:
+    entry->obj = PACK != NULL ? asset_pack_sound(PACK, entry->filepath) : NULL;
+    if (entry->obj == NULL) {
+      entry->obj = Mix_LoadWAV(entry->filepath);
+    }
     break;
+
+  case ASSET_BUTTON:
+    assert(false && "Buttons are registered, not loaded from a path");
+  }
+  entry->evicted = false;
+  asset_cache_account(entry);
+}
+
+void asset_cache_load_atlas(const char **filepaths, size_t num_images) {
+  const char **new_paths = malloc(num_images * sizeof(char *));
+  SDL_Surface **surfaces = malloc(num_images * sizeof(SDL_Surface *));
+  sprite_t *sprites = malloc(num_images * sizeof(sprite_t));
+  SDL_Texture **pages = malloc(num_images * sizeof(SDL_Texture *));
+  assert(new_paths);
+  assert(surfaces);
+  assert(sprites);
+  assert(pages);
+
+  size_t num_new = 0;
+  for (size_t i = 0; i < num_images; i++) {
+    if (asset_cache_lookup(filepaths[i]) == 0) {
+      surfaces[num_new] = asset_cache_load_surface(filepaths[i]);
+      new_paths[num_new++] = filepaths[i];
+    }
   }
-  entry_t *new_entry = malloc(sizeof(entry_t));
-  assert(new_entry);
 
-  new_entry->type = ty;
-  new_entry->filepath = filepath;
-  new_entry->obj = object;
-  list_add(ASSET_CACHE, new_entry);
+  size_t num_pages = sdl_load_atlas(surfaces, num_new, sprites, pages);
+  for (size_t i = 0; i < num_pages; i++) {
+    list_add(ATLAS_PAGES, pages[i]);
+  }
+  for (size_t i = 0; i < num_new; i++) {
+    // Atlas sprites are never evicted, since that wouldn't free their page
+    sprite_t *sprite = asset_cache_sprite_init();
+    *sprite = sprites[i];
+    asset_cache_add_entry(ASSET_IMAGE, new_paths[i], sprite, false);
+    if (surfaces[i] != NULL) {
+      SDL_FreeSurface(surfaces[i]);
+    }
+  }
 
-  return object;
+  free(new_paths);
+  free(surfaces);
+  free(sprites);
+  free(pages);
 }
 
-void asset_cache_register_button(asset_t *button) {
-  entry_t *new_button = malloc(sizeof(entry_t));
-  assert(new_button);
+/**
+ * Gets the entry that a handle refers to, asserting that it has the given
+ * type.
+ */
+static entry_t *asset_cache_get_entry(asset_type_t ty, size_t id) {
+  assert(0 < id && id <= NUM_ENTRIES && "Invalid asset handle");
+  entry_t *entry = &ENTRIES[id - 1];
+  assert(entry->type == ty);
+  return entry;
+}
+
+/**
+ * Gets the entry that a handle refers to for using its asset, making it the
+ * most recently used and loading it again if it was evicted.
+ */
+static entry_t *asset_cache_use(asset_type_t ty, size_t id) {
+  entry_t *entry = asset_cache_get_entry(ty, id);
+  if (LRU_HEAD != id) {
+    asset_cache_lru_unlink(id);
+    asset_cache_lru_push(id);
+  }
+  if (entry->evicted) {
+    asset_cache_load(entry);
+  }
+  return entry;
+}
+
+/**
+ * Delivers an asset loaded in the background to its entry.
+ */
+static void asset_cache_loaded(void *result, void *aux) {
+  entry_t *entry = &ENTRIES[(uintptr_t)aux - 1];
+  entry->loading = false;
+  if (entry->type == ASSET_IMAGE) {
+    sprite_t *sprite = entry->obj;
+    sprite->texture = result;
+    if (result != NULL) {
+      SDL_QueryTexture(result, NULL, NULL, &sprite->src.w, &sprite->src.h);
+    }
+  } else {
+    entry->obj = result;
+  }
+  asset_cache_account(entry);
+}
+
+/**
+ * Gets a referenced handle id for a path, adding an entry if there isn't
+ * one. The entry's asset is loaded right away, or in the background if
+ * `preload` is true. Asserts that the entry has the given type.
+ */
+static size_t asset_cache_acquire(asset_type_t ty, const char *filepath,
+                                  bool preload) {
+  size_t id = asset_cache_lookup(filepath);
+  if (id != 0) {
+    assert(ENTRIES[id - 1].type == ty);
+    ENTRIES[id - 1].refs++;
+    return id;
+  }
+
+  void *obj = ty == ASSET_IMAGE ? asset_cache_sprite_init() : NULL;
+  id = asset_cache_add_entry(ty, filepath, obj, true);
+  entry_t *entry = &ENTRIES[id - 1];
+  entry->refs = 1;
+  if (ty == ASSET_IMAGE && !preload) {
+    // Textures are only created by asset_cache_image(), on the thread that
+    // draws, so the image is loaded the first time it is used
+    entry->evicted = true;
+  } else if (!preload) {
+    asset_cache_load(entry);
+  } else if (ty == ASSET_IMAGE) {
+    entry->loading = true;
+    asset_loader_load_image(filepath, asset_cache_loaded, (void *)id);
+  } else {
+    assert(ty == ASSET_SOUND);
+    entry->loading = true;
+    asset_loader_load_sound(filepath, asset_cache_loaded, (void *)id);
+  }
+  return id;
+}
 
+/**
+ * Releases a handle id from asset_cache_acquire(). Nothing is evicted until
+ * the next asset is loaded, so releasing never destroys a texture.
+ */
+static void asset_cache_release(asset_type_t ty, size_t id) {
+  entry_t *entry = asset_cache_get_entry(ty, id);
+  assert(entry->refs > 0);
+  entry->refs--;
+}
+
+image_handle_t asset_cache_get_image(const char *filepath) {
+  return (image_handle_t){asset_cache_acquire(ASSET_IMAGE, filepath, false)};
+}
+
+image_handle_t asset_cache_preload_image(const char *filepath) {
+  return (image_handle_t){asset_cache_acquire(ASSET_IMAGE, filepath, true)};
+}
+
+font_handle_t asset_cache_get_font(const char *filepath) {
+  return (font_handle_t){asset_cache_acquire(ASSET_FONT, filepath, false)};
+}
+
+sound_handle_t asset_cache_get_sound(const char *filepath) {
+  return (sound_handle_t){asset_cache_acquire(ASSET_SOUND, filepath, false)};
+}
+
+sound_handle_t asset_cache_preload_sound(const char *filepath) {
+  return (sound_handle_t){asset_cache_acquire(ASSET_SOUND, filepath, true)};
+}
+
+void asset_cache_retain_image(image_handle_t handle) {
+  asset_cache_get_entry(ASSET_IMAGE, handle.id)->refs++;
+}
+
+void asset_cache_release_image(image_handle_t handle) {
+  asset_cache_release(ASSET_IMAGE, handle.id);
+}
+
+void asset_cache_release_font(font_handle_t handle) {
+  asset_cache_release(ASSET_FONT, handle.id);
+}
+
+void asset_cache_release_sound(sound_handle_t handle) {
+  asset_cache_release(ASSET_SOUND, handle.id);
+}
+
+sprite_t *asset_cache_image(image_handle_t handle) {
+  return asset_cache_use(ASSET_IMAGE, handle.id)->obj;
+}
+
+TTF_Font *asset_cache_font(font_handle_t handle) {
+  return asset_cache_use(ASSET_FONT, handle.id)->obj;
+}
+
+Mix_Chunk *asset_cache_sound(sound_handle_t handle) {
+  return asset_cache_use(ASSET_SOUND, handle.id)->obj;
+}
+
+void *asset_cache_obj_get_or_create(asset_type_t ty, const char *filepath) {
+  // The reference is never released, so the object is never evicted
+  size_t id = asset_cache_acquire(ty, filepath, false);
+  return asset_cache_use(ty, id)->obj;
+}
+
+void asset_cache_register_button(asset_t *button) {
   assert(asset_get_type(button) == ASSET_BUTTON);
-  new_button->type = asset_get_type(button);
-  new_button->filepath = NULL;
-  new_button->obj = button;
-  list_add(ASSET_CACHE, new_button);
+  list_add(BUTTONS, button);
 }
 
 bool asset_cache_handle_buttons(state_t *state, double x, double y) {
-  for (size_t i = 0; i < list_size(ASSET_CACHE); i++) {
-    entry_t *cur_asset = list_get(ASSET_CACHE, i);
-    if (cur_asset->type == ASSET_BUTTON) {
-      bool clicked = asset_on_button_click((asset_t *)cur_asset->obj, state, x, y);
-      if (clicked) {
-        return true;
-      }
+  for (size_t i = 0; i < list_size(BUTTONS); i++) {
+    if (asset_on_button_click(list_get(BUTTONS, i), state, x, y)) {
+      return true;
     }
   }
   return false;
-}
\ No newline at end of file
+}
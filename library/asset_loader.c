@@ -0,0 +1,233 @@
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "asset_loader.h"
+#include "list.h"
+#include "profiler.h"
+#include "sdl_wrapper.h"
+
+#define ALLOC_TAG ALLOC_ASSETS
+#include "alloc.h"
+
+typedef enum { LOAD_IMAGE, LOAD_SOUND } load_type_t;
+
+typedef struct load_job {
+  load_type_t type;
+  char *filepath;
+  load_callback_t callback;
+  void *aux;
+  // The decoded SDL_Surface or Mix_Chunk, once the job has run
+  void *result;
+} load_job_t;
+
+const size_t LOADER_MAX_WORKERS = 4;
+const size_t LOADER_QUEUE_CAPACITY = 16;
+
+/**
+ * Jobs waiting for a worker, and jobs decoded but not yet delivered.
+ * Both are guarded by loader_lock.
+ */
+static list_t *pending_jobs;
+static list_t *finished_jobs;
+// Finished jobs taken by asset_loader_poll(), swapped with finished_jobs
+static list_t *delivering_jobs;
+static SDL_mutex *loader_lock;
+// Signalled when a job is queued or the workers should stop
+static SDL_cond *loader_wakeup;
+static bool loader_stopping;
+static SDL_Thread **workers;
+static size_t num_workers;
+/**
+ * How many loads have been requested and delivered, for
+ * asset_loader_progress(). Only touched on the main thread.
+ */
+static size_t num_requested;
+static size_t num_delivered;
+static asset_pack_t *loader_pack;
+
+static void load_job_free(load_job_t *job) {
+  if (job->result != NULL) {
+    if (job->type == LOAD_IMAGE) {
+      SDL_FreeSurface(job->result);
+    } else {
+      Mix_FreeChunk(job->result);
+    }
+  }
+  free(job->filepath);
+  free(job);
+}
+
+/**
+ * Decodes a job's file. Safe to call from any thread.
+ */
+static void load_job_run(load_job_t *job) {
+  if (job->type == LOAD_IMAGE) {
+    job->result = IMG_Load(job->filepath);
+  } else {
+    job->result = Mix_LoadWAV(job->filepath);
+  }
+}
+
+/**
+ * A worker thread: runs queued jobs until the loader stops.
+ */
+static int loader_worker(void *aux) {
+  SDL_LockMutex(loader_lock);
+  while (true) {
+    while (list_size(pending_jobs) == 0 && !loader_stopping) {
+      SDL_CondWait(loader_wakeup, loader_lock);
+    }
+    if (loader_stopping) {
+      break;
+    }
+    load_job_t *job = list_remove(pending_jobs, 0);
+    SDL_UnlockMutex(loader_lock);
+
+    load_job_run(job);
+
+    SDL_LockMutex(loader_lock);
+    list_add(finished_jobs, job);
+  }
+  SDL_UnlockMutex(loader_lock);
+  return 0;
+}
+
+void asset_loader_init(void) {
+  pending_jobs = list_init(LOADER_QUEUE_CAPACITY, (free_func_t)load_job_free);
+  finished_jobs = list_init(LOADER_QUEUE_CAPACITY, (free_func_t)load_job_free);
+  delivering_jobs =
+      list_init(LOADER_QUEUE_CAPACITY, (free_func_t)load_job_free);
+  loader_lock = SDL_CreateMutex();
+  loader_wakeup = SDL_CreateCond();
+  assert(loader_lock != NULL && loader_wakeup != NULL);
+  loader_stopping = false;
+  num_requested = 0;
+  num_delivered = 0;
+  loader_pack = NULL;
+
+#ifdef __EMSCRIPTEN__
+  num_workers = 0;
+#else
+  // Leave a core for the main thread
+  int cpus = SDL_GetCPUCount();
+  num_workers = cpus > 2 ? (size_t)cpus - 1 : 1;
+  if (num_workers > LOADER_MAX_WORKERS) {
+    num_workers = LOADER_MAX_WORKERS;
+  }
+#endif
+  workers = malloc((num_workers + 1) * sizeof(SDL_Thread *));
+  assert(workers);
+  for (size_t i = 0; i < num_workers; i++) {
+    workers[i] = SDL_CreateThread(loader_worker, "asset loader", NULL);
+    assert(workers[i] != NULL);
+  }
+}
+
+void asset_loader_free(void) {
+  SDL_LockMutex(loader_lock);
+  loader_stopping = true;
+  SDL_CondBroadcast(loader_wakeup);
+  SDL_UnlockMutex(loader_lock);
+  for (size_t i = 0; i < num_workers; i++) {
+    SDL_WaitThread(workers[i], NULL);
+  }
+  free(workers);
+  list_free(pending_jobs);
+  list_free(finished_jobs);
+  list_free(delivering_jobs);
+  SDL_DestroyCond(loader_wakeup);
+  SDL_DestroyMutex(loader_lock);
+}
+
+void asset_loader_use_pack(asset_pack_t *pack) { loader_pack = pack; }
+
+/**
+ * Gets a job's result straight from the pack, if the pack has its file.
+ */
+static void load_job_run_packed(load_job_t *job) {
+  if (job->type == LOAD_IMAGE) {
+    job->result = asset_pack_image(loader_pack, job->filepath);
+  } else {
+    job->result = asset_pack_sound(loader_pack, job->filepath);
+  }
+}
+
+static void asset_loader_submit(load_type_t type, const char *filepath,
+                                load_callback_t callback, void *aux) {
+  load_job_t *job = malloc(sizeof(load_job_t));
+  assert(job);
+  job->type = type;
+  job->filepath = malloc(strlen(filepath) + 1);
+  assert(job->filepath);
+  strcpy(job->filepath, filepath);
+  job->callback = callback;
+  job->aux = aux;
+  job->result = NULL;
+  num_requested++;
+  if (loader_pack != NULL) {
+    load_job_run_packed(job);
+  }
+
+  SDL_LockMutex(loader_lock);
+  if (job->result != NULL) {
+    list_add(finished_jobs, job);
+  } else {
+    list_add(pending_jobs, job);
+    SDL_CondSignal(loader_wakeup);
+  }
+  SDL_UnlockMutex(loader_lock);
+}
+
+void asset_loader_load_image(const char *filepath, load_callback_t callback,
+                             void *aux) {
+  asset_loader_submit(LOAD_IMAGE, filepath, callback, aux);
+}
+
+void asset_loader_load_sound(const char *filepath, load_callback_t callback,
+                             void *aux) {
+  asset_loader_submit(LOAD_SOUND, filepath, callback, aux);
+}
+
+size_t asset_loader_poll(void) {
+  PROFILE_BEGIN("asset_loader_poll");
+  SDL_LockMutex(loader_lock);
+  if (num_workers == 0 && list_size(pending_jobs) > 0) {
+    // Without workers, decode one job per frame so frames keep coming
+    load_job_t *job = list_remove(pending_jobs, 0);
+    load_job_run(job);
+    list_add(finished_jobs, job);
+  }
+  // Take the finished jobs so callbacks run without holding the lock
+  list_t *finished = finished_jobs;
+  finished_jobs = delivering_jobs;
+  delivering_jobs = finished;
+  SDL_UnlockMutex(loader_lock);
+
+  size_t num_finished = list_size(finished);
+  for (size_t i = 0; i < num_finished; i++) {
+    load_job_t *job = list_get(finished, i);
+    void *result = job->result;
+    if (job->type == LOAD_IMAGE && result != NULL) {
+      result = sdl_create_texture(job->result);
+      SDL_FreeSurface(job->result);
+    }
+    job->result = NULL;
+    job->callback(result, job->aux);
+  }
+  num_delivered += num_finished;
+  while (list_size(finished) > 0) {
+    load_job_free(list_remove(finished, list_size(finished) - 1));
+  }
+  PROFILE_END("asset_loader_poll");
+  return num_finished;
+}
+
+double asset_loader_progress(void) {
+  if (num_requested == num_delivered) {
+    return 1;
+  }
+  return (double)num_delivered / num_requested;
+}
@@ -0,0 +1,174 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "asset_pack.h"
+
+#define ALLOC_TAG ALLOC_ASSETS
+#include "alloc.h"
+
+typedef struct asset_pack {
+  const uint8_t *data;
+  size_t size;
+  const pack_entry_t *entries;
+  size_t num_entries;
+} asset_pack_t;
+
+/**
+ * Checks that an entry's data describes exactly what its type says, so that
+ * SDL and the mixer never read past it.
+ */
+static bool asset_pack_validate_data(const pack_entry_t *entry) {
+  switch (entry->type) {
+  case PACK_IMAGE:
+    // SDL takes the dimensions as ints
+    return entry->image.format == PACK_PIXEL_FORMAT &&
+           entry->image.width <= INT_MAX / 4 &&
+           entry->image.height <= INT_MAX &&
+           entry->image.pitch <= INT_MAX &&
+           entry->image.pitch >= (uint64_t)entry->image.width * 4 &&
+           (uint64_t)entry->image.pitch * entry->image.height <= entry->size;
+
+  case PACK_SOUND: {
+    uint64_t frame_size = (uint64_t)SDL_AUDIO_BITSIZE(entry->sound.format) /
+                          8 * entry->sound.channels;
+    return frame_size > 0 && entry->size % frame_size == 0;
+  }
+
+  default:
+    return false;
+  }
+}
+
+/**
+ * Checks that a mapped file is a pack whose entries, and the pixels and
+ * samples they describe, all lie inside it.
+ */
+static bool asset_pack_validate(const uint8_t *data, size_t size) {
+  if (size < sizeof(pack_header_t)) {
+    return false;
+  }
+  const pack_header_t *header = (const pack_header_t *)data;
+  if (memcmp(header->magic, PACK_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != PACK_VERSION) {
+    return false;
+  }
+  size_t entries_end =
+      sizeof(pack_header_t) + header->num_entries * sizeof(pack_entry_t);
+  if (entries_end > size) {
+    return false;
+  }
+
+  const pack_entry_t *entries =
+      (const pack_entry_t *)(data + sizeof(pack_header_t));
+  for (size_t i = 0; i < header->num_entries; i++) {
+    const pack_entry_t *entry = &entries[i];
+    if (entry->offset < entries_end || entry->offset > size ||
+        entry->size > size - entry->offset ||
+        memchr(entry->path, '\0', PACK_PATH_LENGTH) == NULL ||
+        !asset_pack_validate_data(entry)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+asset_pack_t *asset_pack_open(const char *filepath) {
+  int fd = open(filepath, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    return NULL;
+  }
+  size_t size = info.st_size;
+  void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after the file is closed
+  close(fd);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+  if (!asset_pack_validate(data, size)) {
+    munmap(data, size);
+    return NULL;
+  }
+
+  asset_pack_t *pack = malloc(sizeof(asset_pack_t));
+  assert(pack);
+  pack->data = data;
+  pack->size = size;
+  pack->entries = (const pack_entry_t *)(pack->data + sizeof(pack_header_t));
+  pack->num_entries = ((const pack_header_t *)data)->num_entries;
+  return pack;
+}
+
+void asset_pack_close(asset_pack_t *pack) {
+  munmap((void *)pack->data, pack->size);
+  free(pack);
+}
+
+size_t asset_pack_size(asset_pack_t *pack) { return pack->num_entries; }
+
+const pack_entry_t *asset_pack_get(asset_pack_t *pack, size_t index) {
+  assert(index < pack->num_entries);
+  return &pack->entries[index];
+}
+
+const pack_entry_t *asset_pack_find(asset_pack_t *pack, const char *filepath) {
+  size_t low = 0, high = pack->num_entries;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    int comparison = strcmp(filepath, pack->entries[mid].path);
+    if (comparison == 0) {
+      return &pack->entries[mid];
+    }
+    if (comparison < 0) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  return NULL;
+}
+
+const void *asset_pack_data(asset_pack_t *pack, const pack_entry_t *entry) {
+  return pack->data + entry->offset;
+}
+
+SDL_Surface *asset_pack_image(asset_pack_t *pack, const char *filepath) {
+  const pack_entry_t *entry = asset_pack_find(pack, filepath);
+  if (entry == NULL || entry->type != PACK_IMAGE) {
+    return NULL;
+  }
+  // SDL only reads the pixels of a surface it is given them for
+  void *pixels = (void *)asset_pack_data(pack, entry);
+  return SDL_CreateRGBSurfaceWithFormatFrom(
+      pixels, entry->image.width, entry->image.height, 32, entry->image.pitch,
+      entry->image.format);
+}
+
+Mix_Chunk *asset_pack_sound(asset_pack_t *pack, const char *filepath) {
+  const pack_entry_t *entry = asset_pack_find(pack, filepath);
+  if (entry == NULL || entry->type != PACK_SOUND) {
+    return NULL;
+  }
+  int frequency, channels;
+  Uint16 format;
+  if (Mix_QuerySpec(&frequency, &format, &channels) == 0 ||
+      (uint32_t)frequency != entry->sound.frequency ||
+      format != entry->sound.format ||
+      (uint32_t)channels != entry->sound.channels) {
+    return NULL;
+  }
+  // The mixer plays the samples in place and never writes to them
+  return Mix_QuickLoad_RAW((Uint8 *)asset_pack_data(pack, entry),
+                           entry->size);
+}
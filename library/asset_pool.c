@@ -0,0 +1,72 @@
+#include "asset_pool.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "vec.h"
+
+#define ALLOC_TAG ALLOC_ASSETS
+#include "alloc.h"
+
+const asset_handle_t ASSET_HANDLE_NONE = {0, 0};
+
+DEFINE_SLOT_MAP(asset_slot_map, asset_t *)
+
+struct asset_pool {
+  asset_slot_map_t assets;
+};
+
+asset_pool_t *asset_pool_init(size_t initial_capacity) {
+  asset_pool_t *pool = malloc(sizeof(asset_pool_t));
+  assert(pool);
+  asset_slot_map_init(&pool->assets);
+  asset_slot_map_reserve(&pool->assets, initial_capacity);
+  return pool;
+}
+
+void asset_pool_free(asset_pool_t *pool) {
+  for (size_t i = 0; i < asset_slot_map_slots(&pool->assets); i++) {
+    asset_t **asset = asset_slot_map_get_slot(&pool->assets, i);
+    if (asset != NULL) {
+      asset_destroy(*asset);
+    }
+  }
+  asset_slot_map_free(&pool->assets);
+  free(pool);
+}
+
+asset_handle_t asset_pool_add(asset_pool_t *pool, asset_t *asset) {
+  assert(asset != NULL);
+  slot_handle_t handle = asset_slot_map_insert(&pool->assets, asset);
+  return (asset_handle_t){handle.index, handle.generation};
+}
+
+asset_t *asset_pool_get(asset_pool_t *pool, asset_handle_t handle) {
+  asset_t **asset = asset_slot_map_find(
+      &pool->assets, (slot_handle_t){handle.index, handle.generation});
+  return asset != NULL ? *asset : NULL;
+}
+
+bool asset_pool_remove(asset_pool_t *pool, asset_handle_t handle) {
+  asset_t *asset = asset_pool_get(pool, handle);
+  if (asset == NULL) {
+    return false;
+  }
+  asset_destroy(asset);
+  asset_slot_map_erase(&pool->assets,
+                       (slot_handle_t){handle.index, handle.generation});
+  return true;
+}
+
+size_t asset_pool_size(asset_pool_t *pool) {
+  return asset_slot_map_size(&pool->assets);
+}
+
+size_t asset_pool_slots(asset_pool_t *pool) {
+  return asset_slot_map_slots(&pool->assets);
+}
+
+asset_t *asset_pool_get_slot(asset_pool_t *pool, size_t index) {
+  asset_t **asset = asset_slot_map_get_slot(&pool->assets, index);
+  return asset != NULL ? *asset : NULL;
+}
@@ -1,15 +1,21 @@
 #include <assert.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include "body.h"
 
-const size_t INITIAL_SIZE = 10;
+#define ALLOC_TAG ALLOC_PHYSICS
+#include "alloc.h"
+
 const double INITIAL_ROT = 0;
 const double INITIAL_TIME = 0;
 
 struct body {
   polygon_t *poly;
+  // Axis-aligned bounding box of the shape, kept up to date as it moves
+  vector_t bounds_min;
+  vector_t bounds_max;
 
   double mass;
   double timer;
@@ -23,6 +29,23 @@ struct body {
 
 void body_set_centroid(body_t *body, vector_t x);
 
+/**
+ * Recomputes the bounding box of a body from the points of its polygon.
+ */
+static void body_compute_bounds(body_t *body) {
+  vertex_list_t *points = polygon_get_points(body->poly);
+  vector_t min = {INFINITY, INFINITY}, max = {-INFINITY, -INFINITY};
+  for (size_t i = 0; i < vertex_list_size(points); i++) {
+    vector_t *point = vertex_list_get(points, i);
+    min.x = fmin(min.x, point->x);
+    min.y = fmin(min.y, point->y);
+    max.x = fmax(max.x, point->x);
+    max.y = fmax(max.y, point->y);
+  }
+  body->bounds_min = min;
+  body->bounds_max = max;
+}
+
 body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color,
                             void *info, free_func_t info_freer) {
   assert(mass > 0);
@@ -31,7 +54,10 @@ body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color,
 
   body->poly =
       polygon_init(shape, VEC_ZERO, INITIAL_ROT, color.r, color.g, color.b);
+  body->bounds_min = VEC_ZERO;
+  body->bounds_max = VEC_ZERO;
   body_set_centroid(body, polygon_get_center(body->poly));
+  body_compute_bounds(body);
 
   body->mass = mass;
   body->force = VEC_ZERO;
@@ -57,18 +83,8 @@ void body_free(body_t *body) {
   free(body);
 }
 
-list_t *body_get_shape(body_t *body) {
-  body_get_rotation(body);
-  polygon_t *polygon = body->poly;
-  list_t *vec_list = list_init(INITIAL_SIZE, NULL);
-  list_t *temp = polygon_get_points(polygon);
-
-  for (size_t i = 0; i < list_size(temp); i++) {
-    vector_t *point = list_get(temp, i);
-    list_add(vec_list, point);
-  }
-
-  return vec_list;
+vertex_list_t *body_get_shape(body_t *body) {
+  return polygon_get_points(body->poly);
 }
 
 vector_t body_get_centroid(body_t *body) {
@@ -87,6 +103,13 @@ void body_set_centroid(body_t *body, vector_t x) {
   // Translate every point
   polygon_translate(polygon, translation);
   polygon_set_center(polygon, x);
+  body->bounds_min = vec_add(body->bounds_min, translation);
+  body->bounds_max = vec_add(body->bounds_max, translation);
+}
+
+void body_get_bounds(body_t *body, vector_t *min, vector_t *max) {
+  *min = body->bounds_min;
+  *max = body->bounds_max;
 }
 
 vector_t body_get_velocity(body_t *body) {
@@ -118,6 +141,7 @@ void body_set_rotation(body_t *body, double angle) {
   vector_t center = polygon_get_center(polygon);
   polygon_rotate(polygon, rotation_angle, center);
   polygon_set_rotation(polygon, angle);
+  body_compute_bounds(body);
 }
 
 polygon_t *body_get_polygon(body_t *body) { return body->poly; }
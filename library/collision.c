@@ -5,26 +5,8 @@
 #include <math.h>
 #include <stdlib.h>
 
-/**
- * Returns a list of vectors representing the edges of a shape.
- *
- * @param shape the list of vectors representing the vertices of a shape
- * @return a list of vectors representing the edges of the shape
- */
-static list_t *get_edges(list_t *shape) {
-  list_t *edges = list_init(list_size(shape), free);
-
-  for (size_t i = 0; i < list_size(shape); i++) {
-    vector_t *vec = malloc(sizeof(vector_t));
-    assert(vec);
-    *vec =
-        vec_subtract(*(vector_t *)list_get(shape, i % list_size(shape)),
-                     *(vector_t *)list_get(shape, (i + 1) % list_size(shape)));
-    list_add(edges, vec);
-  }
-
-  return edges;
-}
+#define ALLOC_TAG ALLOC_COLLISION
+#include "alloc.h"
 
 /**
  * Returns a vector containing the maximum and minimum length projections given
@@ -35,13 +17,14 @@ static list_t *get_edges(list_t *shape) {
  * @return a vector in the form (max, min) where `max` is the maximum projection
  * length and `min` is the minimum projection length.
  */
-static vector_t get_max_min_projections(list_t *shape, vector_t unit_axis) {
+static vector_t get_max_min_projections(vertex_list_t *shape,
+                                        vector_t unit_axis) {
   double max = -INFINITY;
   double min = INFINITY;
 
-  for (size_t i = 0; i < list_size(shape); i++) {
-    vector_t *vertex = (vector_t *)list_get(shape, i);
-    double projection = vec_dot(*vertex, unit_axis);
+  vector_t *vertices = vertex_list_data(shape);
+  for (size_t i = 0; i < vertex_list_size(shape); i++) {
+    double projection = vec_dot(vertices[i], unit_axis);
 
     if (projection > max) {
       max = projection;
@@ -64,16 +47,17 @@ static vector_t get_max_min_projections(list_t *shape, vector_t unit_axis) {
  * @param shape2 the second shape
  * @return whether the shapes are colliding
  */
-static collision_info_t compare_collision(list_t *shape1, list_t *shape2,
+static collision_info_t compare_collision(vertex_list_t *shape1,
+                                          vertex_list_t *shape2,
                                           double *min_overlap) {
   collision_info_t info;
   info.collided = true;
-  list_t *edges1 = get_edges(shape1);
-  list_t *edges2 = get_edges(shape2);
+  size_t n = vertex_list_size(shape1);
+  vector_t *vertices = vertex_list_data(shape1);
   vector_t min_axis = VEC_ZERO;
-  for (size_t i = 0; i < list_size(edges1); i++) {
-    vector_t *edge = (vector_t *)list_get(edges1, i);
-    vector_t axis = (vector_t){-edge->y, edge->x};
+  for (size_t i = 0; i < n; i++) {
+    vector_t edge = vec_subtract(vertices[i], vertices[(i + 1) % n]);
+    vector_t axis = (vector_t){-edge.y, edge.x};
     vector_t unit_axis = vec_multiply(1 / vec_get_length(axis), axis);
 
     vector_t projection1 = get_max_min_projections(shape1, unit_axis);
@@ -92,15 +76,13 @@ static collision_info_t compare_collision(list_t *shape1, list_t *shape2,
     }
   }
 
-  list_free(edges1);
-  list_free(edges2);
   info.axis = min_axis;
   return info;
 }
 
 collision_info_t find_collision(body_t *body1, body_t *body2) {
-  list_t *shape1 = body_get_shape(body1);
-  list_t *shape2 = body_get_shape(body2);
+  vertex_list_t *shape1 = body_get_shape(body1);
+  vertex_list_t *shape2 = body_get_shape(body2);
 
   double c1_overlap = __DBL_MAX__;
   double c2_overlap = __DBL_MAX__;
@@ -108,9 +90,6 @@ collision_info_t find_collision(body_t *body1, body_t *body2) {
   collision_info_t collision1 = compare_collision(shape1, shape2, &c1_overlap);
   collision_info_t collision2 = compare_collision(shape2, shape1, &c2_overlap);
 
-  list_free(shape1);
-  list_free(shape2);
-
   if (!collision1.collided) {
     return collision1;
   }
@@ -120,7 +99,150 @@ collision_info_t find_collision(body_t *body1, body_t *body2) {
   }
 
   if (c1_overlap < c2_overlap) {
+    collision1.depth = c1_overlap;
     return collision1;
   }
+  collision2.depth = c2_overlap;
   return collision2;
 }
+
+/**
+ * An edge of a polygon, from v1 to v2, along with the vertex of the polygon
+ * that is furthest in the direction the edge was chosen for.
+ */
+typedef struct {
+  vector_t max;
+  vector_t v1;
+  vector_t v2;
+} edge_t;
+
+/**
+ * Finds the edge of a shape that faces a direction: of the two edges at the
+ * vertex furthest along the direction, the one most perpendicular to it.
+ * Works for vertices in either winding order.
+ *
+ * @param shape the list of vectors representing the vertices of a shape
+ * @param dir the unit direction the edge should face
+ * @return the facing edge
+ */
+static edge_t get_facing_edge(vertex_list_t *shape, vector_t dir) {
+  size_t n = vertex_list_size(shape);
+  vector_t *vertices = vertex_list_data(shape);
+  size_t best = 0;
+  double best_projection = -INFINITY;
+  for (size_t i = 0; i < n; i++) {
+    double projection = vec_dot(vertices[i], dir);
+    if (projection > best_projection) {
+      best_projection = projection;
+      best = i;
+    }
+  }
+
+  vector_t v = vertices[best];
+  vector_t prev = vertices[(best + n - 1) % n];
+  vector_t next = vertices[(best + 1) % n];
+  vector_t to_prev = vec_unit(vec_subtract(v, prev));
+  vector_t to_next = vec_unit(vec_subtract(v, next));
+
+  if (fabs(vec_dot(to_prev, dir)) <= fabs(vec_dot(to_next, dir))) {
+    return (edge_t){v, prev, v};
+  }
+  return (edge_t){v, v, next};
+}
+
+/**
+ * Clips a segment to the half-plane of points p with dot(p, dir) >= offset.
+ *
+ * @param a the start of the segment
+ * @param b the end of the segment
+ * @param dir the unit normal of the clipping plane
+ * @param offset the plane's distance along dir
+ * @param out where to store the clipped points
+ * @return the number of points stored in out (0, 1 or 2)
+ */
+static size_t clip_segment(vector_t a, vector_t b, vector_t dir, double offset,
+                           vector_t out[MAX_CONTACT_POINTS]) {
+  size_t count = 0;
+  double dist_a = vec_dot(a, dir) - offset;
+  double dist_b = vec_dot(b, dir) - offset;
+
+  if (dist_a >= 0) {
+    out[count++] = a;
+  }
+  if (dist_b >= 0) {
+    out[count++] = b;
+  }
+  // The points are on opposite sides, so keep the intersection too
+  if (dist_a * dist_b < 0) {
+    double t = dist_a / (dist_a - dist_b);
+    out[count++] = vec_add(a, vec_multiply(t, vec_subtract(b, a)));
+  }
+  return count;
+}
+
+contact_manifold_t find_contact_manifold(body_t *body1, body_t *body2) {
+  contact_manifold_t manifold;
+  manifold.collided = false;
+  manifold.num_contacts = 0;
+
+  collision_info_t info = find_collision(body1, body2);
+  if (!info.collided) {
+    return manifold;
+  }
+
+  // Make sure the normal points from body1 towards body2
+  vector_t normal = info.axis;
+  vector_t between =
+      vec_subtract(body_get_centroid(body2), body_get_centroid(body1));
+  if (vec_dot(normal, between) < 0) {
+    normal = vec_negate(normal);
+  }
+  manifold.collided = true;
+  manifold.normal = normal;
+
+  edge_t edge1 = get_facing_edge(body_get_shape(body1), normal);
+  edge_t edge2 = get_facing_edge(body_get_shape(body2), vec_negate(normal));
+
+  // The reference edge is the one more perpendicular to the normal;
+  // the other (incident) edge is clipped against it
+  edge_t ref = edge1, inc = edge2;
+  vector_t ref_normal = normal;
+  vector_t dir1 = vec_unit(vec_subtract(edge1.v2, edge1.v1));
+  vector_t dir2 = vec_unit(vec_subtract(edge2.v2, edge2.v1));
+  if (fabs(vec_dot(dir2, normal)) < fabs(vec_dot(dir1, normal))) {
+    ref = edge2;
+    inc = edge1;
+    ref_normal = vec_negate(normal);
+  }
+  vector_t ref_dir = vec_unit(vec_subtract(ref.v2, ref.v1));
+
+  vector_t clipped[MAX_CONTACT_POINTS];
+  vector_t points[MAX_CONTACT_POINTS];
+  size_t count = clip_segment(inc.v1, inc.v2, ref_dir,
+                              vec_dot(ref_dir, ref.v1), clipped);
+  if (count == MAX_CONTACT_POINTS) {
+    count = clip_segment(clipped[0], clipped[1], vec_negate(ref_dir),
+                         -vec_dot(ref_dir, ref.v2), points);
+  }
+
+  // Keep the clipped points that are behind the reference edge
+  double ref_offset = vec_dot(ref_normal, ref.max);
+  if (count == MAX_CONTACT_POINTS) {
+    for (size_t i = 0; i < count; i++) {
+      double depth = ref_offset - vec_dot(ref_normal, points[i]);
+      if (depth >= 0) {
+        manifold.points[manifold.num_contacts] = points[i];
+        manifold.depths[manifold.num_contacts] = depth;
+        manifold.num_contacts++;
+      }
+    }
+  }
+
+  // Degenerate edges (e.g. touching corners) fall back to the deepest vertex
+  if (manifold.num_contacts == 0) {
+    manifold.points[0] = inc.max;
+    manifold.depths[0] = info.depth;
+    manifold.num_contacts = 1;
+  }
+  return manifold;
+}
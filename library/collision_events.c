@@ -0,0 +1,114 @@
+#include "collision_events.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "vec.h"
+
+#define ALLOC_TAG ALLOC_COLLISION
+#include "alloc.h"
+
+const size_t COLLISION_EVENTS_GROWTH_FACTOR = 2;
+
+typedef struct handler_entry {
+  collision_handler_t begin;
+  collision_handler_t end;
+} handler_entry_t;
+
+DEFINE_VEC(handler_list, handler_entry_t)
+
+struct collision_events {
+  // Ring buffer of events; the oldest is at head
+  collision_event_t *ring;
+  size_t head;
+  size_t count;
+  size_t capacity;
+  handler_list_t handlers;
+};
+
+collision_events_t *collision_events_init(size_t capacity) {
+  collision_events_t *events = malloc(sizeof(collision_events_t));
+  assert(events);
+
+  events->capacity = capacity > 0 ? capacity : 1;
+  events->ring = malloc(sizeof(collision_event_t) * events->capacity);
+  assert(events->ring);
+  events->head = 0;
+  events->count = 0;
+  handler_list_init(&events->handlers);
+  return events;
+}
+
+void collision_events_free(collision_events_t *events) {
+  free(events->ring);
+  handler_list_free(&events->handlers);
+  free(events);
+}
+
+size_t collision_events_handler_id(collision_events_t *events,
+                                   collision_handler_t handler) {
+  // There are only a handful of distinct handlers, so search them linearly
+  for (size_t i = 0; i < handler_list_size(&events->handlers); i++) {
+    if (handler_list_get(&events->handlers, i)->begin == handler) {
+      return i;
+    }
+  }
+  handler_list_push(&events->handlers, (handler_entry_t){handler, NULL});
+  return handler_list_size(&events->handlers) - 1;
+}
+
+void collision_events_set_end_handler(collision_events_t *events,
+                                      size_t handler_id,
+                                      collision_handler_t end_handler) {
+  handler_list_get(&events->handlers, handler_id)->end = end_handler;
+}
+
+/**
+ * Doubles the capacity of a full queue,
+ * unwrapping its events to the start of the new buffer.
+ */
+static void collision_events_grow(collision_events_t *events) {
+  size_t capacity = events->capacity * COLLISION_EVENTS_GROWTH_FACTOR;
+  collision_event_t *ring = malloc(sizeof(collision_event_t) * capacity);
+  assert(ring);
+  for (size_t i = 0; i < events->count; i++) {
+    ring[i] = events->ring[(events->head + i) % events->capacity];
+  }
+  free(events->ring);
+  events->ring = ring;
+  events->head = 0;
+  events->capacity = capacity;
+}
+
+void collision_events_push(collision_events_t *events,
+                           collision_event_t event) {
+  assert(event.handler < handler_list_size(&events->handlers));
+  if (events->count == events->capacity) {
+    collision_events_grow(events);
+  }
+  size_t tail = (events->head + events->count) % events->capacity;
+  events->ring[tail] = event;
+  events->count++;
+}
+
+size_t collision_events_pending(collision_events_t *events) {
+  return events->count;
+}
+
+void collision_events_dispatch(collision_events_t *events) {
+  while (events->count > 0) {
+    // Copied out, since a handler may push and grow the buffer
+    collision_event_t event = events->ring[events->head];
+    events->head = (events->head + 1) % events->capacity;
+    events->count--;
+
+    handler_entry_t *entry = handler_list_get(&events->handlers, event.handler);
+    collision_handler_t handler =
+        event.type == COLLISION_BEGIN ? entry->begin : entry->end;
+    if (handler != NULL) {
+      handler(event.body1, event.body2, event.axis, event.aux,
+              event.force_const);
+    }
+  }
+  events->head = 0;
+}
@@ -1,4 +1,6 @@
+#include "asset_loader.h"
 #include "math.h"
+#include "render_snapshot.h"
 #include "sdl_wrapper.h"
 #include "state.h"
 #include <stdio.h>
@@ -17,6 +19,8 @@ void loop() {
     state = emscripten_init();
   }
 
+  // Hand over any assets that finished loading in the background
+  asset_loader_poll();
   bool game_over = emscripten_main(state);
 
   if (sdl_is_done((void *)state)) { // Once our demo exits...
@@ -33,6 +37,96 @@ void loop() {
   }
 }
 
+#ifdef RENDER_THREAD
+#include <stdatomic.h>
+
+// How many ticks per second the simulation thread aims for
+const double SIMULATION_RATE = 120;
+
+/**
+ * Held by the simulation thread while it ticks, and by the main thread while
+ * it runs the key and button handlers, which also modify the state, and while
+ * it uses the asset cache.
+ */
+SDL_mutex *state_lock;
+/**
+ * Set by the main thread to stop the simulation thread.
+ */
+atomic_bool simulation_done;
+
+/**
+ * The simulation thread: ticks the state at SIMULATION_RATE and publishes a
+ * snapshot of every tick, regardless of how long the main thread takes to
+ * present a frame.
+ *
+ * @param buffer the snapshot_buffer_t shared with the main thread
+ * @return 0 once the main thread has stopped the simulation
+ */
+static int simulate(void *buffer) {
+  uint64_t frequency = SDL_GetPerformanceFrequency();
+  uint64_t tick_length = frequency / SIMULATION_RATE;
+  uint64_t last_tick = SDL_GetPerformanceCounter();
+
+  while (!atomic_load(&simulation_done)) {
+    uint64_t now = SDL_GetPerformanceCounter();
+    double dt = (double)(now - last_tick) / frequency;
+    last_tick = now;
+
+    SDL_LockMutex(state_lock);
+    emscripten_update(state, dt, snapshot_buffer_back(buffer));
+    SDL_UnlockMutex(state_lock);
+    snapshot_buffer_publish(buffer);
+
+    uint64_t elapsed = SDL_GetPerformanceCounter() - now;
+    if (elapsed < tick_length) {
+      SDL_Delay((tick_length - elapsed) * 1000 / frequency);
+    }
+  }
+  return 0;
+}
+
+/**
+ * Runs the simulation on its own thread while the main thread, which owns the
+ * window, handles input and draws the latest snapshot. Waiting for vsync in
+ * sdl_show() then only holds up drawing, not physics.
+ */
+int main() {
+  state = emscripten_init();
+  snapshot_buffer_t *buffer = snapshot_buffer_init();
+  state_lock = SDL_CreateMutex();
+  atomic_store(&simulation_done, false);
+  SDL_Thread *simulation = SDL_CreateThread(simulate, "simulation", buffer);
+
+  while (true) {
+    SDL_LockMutex(state_lock);
+    bool done = sdl_is_done((void *)state);
+    asset_loader_poll();
+    // Looking up textures loads and evicts images and rebuilds the static
+    // layer from its bodies, so it has to wait for the simulation; drawing
+    // then only reads the snapshot and can overlap the next tick
+    render_snapshot_t *snapshot = snapshot_buffer_acquire(buffer, NULL);
+    render_snapshot_resolve(snapshot);
+    SDL_UnlockMutex(state_lock);
+    if (done) {
+      break;
+    }
+
+    sdl_clear();
+    render_snapshot_draw(snapshot);
+    sdl_show(0);
+    // The simulation thread times its own ticks, so the frame timer measures
+    // the presented frames, as time_since_last_tick() does without threads
+    frame_timer_tick(sdl_get_frame_timer());
+  }
+
+  atomic_store(&simulation_done, true);
+  SDL_WaitThread(simulation, NULL);
+  SDL_DestroyMutex(state_lock);
+  snapshot_buffer_free(buffer);
+  emscripten_free(state);
+  return 0;
+}
+#else
 int main() {
 #ifdef __EMSCRIPTEN__
   // Set loop as the function emscripten calls to request a new frame
@@ -43,3 +137,4 @@ int main() {
   }
 #endif
 }
+#endif // #ifdef RENDER_THREAD
@@ -0,0 +1,318 @@
+#include "force_field.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#define ALLOC_TAG ALLOC_PHYSICS
+#include "alloc.h"
+
+const size_t FIELD_INITIAL_CAPACITY = 4;
+const size_t FIELD_GROWTH_FACTOR = 2;
+
+typedef enum { FIELD_UNIFORM, FIELD_WIND, FIELD_RADIAL } field_type_t;
+
+typedef struct gathered_body {
+  double y;
+  size_t index;
+} gathered_body_t;
+
+struct force_field_set {
+  // Fields, stored as parallel arrays
+  field_type_t *type;
+  bool *enabled;
+  double *min_x; // bounding box of the region the field acts in
+  double *min_y;
+  double *max_x;
+  double *max_y;
+  double *vec_x; // acceleration, wind velocity or center
+  double *vec_y;
+  double *strength; // drag constant or radial acceleration
+  size_t num_fields;
+  size_t field_capacity;
+
+  // Per-body scratch arrays, gathered from the movable bodies on every apply
+  // and sorted by y, so a field only visits the bodies in its rows
+  gathered_body_t *sorted;
+  size_t *body_index; // index into the bodies passed to apply
+  double *pos_x;
+  double *pos_y;
+  double *vel_x;
+  double *vel_y;
+  double *mass;
+  double *force_x;
+  double *force_y;
+  size_t body_capacity;
+};
+
+/**
+ * Resizes an array to hold the given number of elements.
+ * Asserts that the resize succeeded.
+ */
+static void *resize_array(void *array, size_t elem_size, size_t capacity) {
+  void *resized = realloc(array, elem_size * capacity);
+  assert(resized);
+  return resized;
+}
+
+static void reserve_fields(force_field_set_t *fields, size_t capacity) {
+  fields->type = resize_array(fields->type, sizeof(field_type_t), capacity);
+  fields->enabled = resize_array(fields->enabled, sizeof(bool), capacity);
+  fields->min_x = resize_array(fields->min_x, sizeof(double), capacity);
+  fields->min_y = resize_array(fields->min_y, sizeof(double), capacity);
+  fields->max_x = resize_array(fields->max_x, sizeof(double), capacity);
+  fields->max_y = resize_array(fields->max_y, sizeof(double), capacity);
+  fields->vec_x = resize_array(fields->vec_x, sizeof(double), capacity);
+  fields->vec_y = resize_array(fields->vec_y, sizeof(double), capacity);
+  fields->strength = resize_array(fields->strength, sizeof(double), capacity);
+  fields->field_capacity = capacity;
+}
+
+static void reserve_bodies(force_field_set_t *fields, size_t capacity) {
+  fields->sorted =
+      resize_array(fields->sorted, sizeof(gathered_body_t), capacity);
+  fields->body_index =
+      resize_array(fields->body_index, sizeof(size_t), capacity);
+  fields->pos_x = resize_array(fields->pos_x, sizeof(double), capacity);
+  fields->pos_y = resize_array(fields->pos_y, sizeof(double), capacity);
+  fields->vel_x = resize_array(fields->vel_x, sizeof(double), capacity);
+  fields->vel_y = resize_array(fields->vel_y, sizeof(double), capacity);
+  fields->mass = resize_array(fields->mass, sizeof(double), capacity);
+  fields->force_x = resize_array(fields->force_x, sizeof(double), capacity);
+  fields->force_y = resize_array(fields->force_y, sizeof(double), capacity);
+  fields->body_capacity = capacity;
+}
+
+force_field_set_t *force_fields_init(void) {
+  force_field_set_t *fields = calloc(1, sizeof(force_field_set_t));
+  assert(fields);
+
+  reserve_fields(fields, FIELD_INITIAL_CAPACITY);
+  reserve_bodies(fields, FIELD_INITIAL_CAPACITY);
+  return fields;
+}
+
+void force_fields_free(force_field_set_t *fields) {
+  if (fields == NULL) {
+    return;
+  }
+  free(fields->type);
+  free(fields->enabled);
+  free(fields->min_x);
+  free(fields->min_y);
+  free(fields->max_x);
+  free(fields->max_y);
+  free(fields->vec_x);
+  free(fields->vec_y);
+  free(fields->strength);
+  free(fields->sorted);
+  free(fields->body_index);
+  free(fields->pos_x);
+  free(fields->pos_y);
+  free(fields->vel_x);
+  free(fields->vel_y);
+  free(fields->mass);
+  free(fields->force_x);
+  free(fields->force_y);
+  free(fields);
+}
+
+size_t force_fields_size(force_field_set_t *fields) {
+  return fields->num_fields;
+}
+
+/**
+ * Appends a field to the set and returns its id.
+ */
+static size_t force_fields_add(force_field_set_t *fields, field_type_t type,
+                               vector_t min, vector_t max, vector_t vec,
+                               double strength) {
+  if (fields->num_fields >= fields->field_capacity) {
+    reserve_fields(fields, fields->field_capacity * FIELD_GROWTH_FACTOR);
+  }
+
+  size_t id = fields->num_fields++;
+  fields->type[id] = type;
+  fields->enabled[id] = true;
+  fields->min_x[id] = min.x;
+  fields->min_y[id] = min.y;
+  fields->max_x[id] = max.x;
+  fields->max_y[id] = max.y;
+  fields->vec_x[id] = vec.x;
+  fields->vec_y[id] = vec.y;
+  fields->strength[id] = strength;
+  return id;
+}
+
+size_t force_fields_add_uniform(force_field_set_t *fields,
+                                vector_t acceleration) {
+  vector_t min = {-INFINITY, -INFINITY};
+  vector_t max = {INFINITY, INFINITY};
+  return force_fields_add(fields, FIELD_UNIFORM, min, max, acceleration, 0);
+}
+
+size_t force_fields_add_wind(force_field_set_t *fields, vector_t min,
+                             vector_t max, vector_t wind, double drag) {
+  assert(min.x <= max.x && min.y <= max.y);
+  return force_fields_add(fields, FIELD_WIND, min, max, wind, drag);
+}
+
+size_t force_fields_add_radial(force_field_set_t *fields, vector_t center,
+                               double radius, double strength) {
+  assert(radius > 0);
+  vector_t extent = {radius, radius};
+  return force_fields_add(fields, FIELD_RADIAL, vec_subtract(center, extent),
+                          vec_add(center, extent), center, strength);
+}
+
+void force_fields_set_enabled(force_field_set_t *fields, size_t id,
+                              bool enabled) {
+  assert(id < fields->num_fields);
+  fields->enabled[id] = enabled;
+}
+
+/**
+ * Finds the first gathered body whose y is at least the given y,
+ * by binary search over the sorted bodies.
+ */
+static size_t force_fields_lower_bound(force_field_set_t *fields,
+                                       size_t num_bodies, double y) {
+  size_t low = 0, high = num_bodies;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (fields->pos_y[mid] < y) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+/**
+ * Accumulates the force of one field on the gathered bodies in [first, last),
+ * which are the ones whose y is inside the field's box.
+ * The loop body is branch-light arithmetic over the parallel arrays,
+ * with bodies outside the box's x range masked out rather than skipped.
+ */
+static void force_field_accumulate(force_field_set_t *fields, size_t id,
+                                   size_t first, size_t last) {
+  const double *pos_x = fields->pos_x, *pos_y = fields->pos_y;
+  const double *vel_x = fields->vel_x, *vel_y = fields->vel_y;
+  const double *mass = fields->mass;
+  double *force_x = fields->force_x, *force_y = fields->force_y;
+  double min_x = fields->min_x[id], max_x = fields->max_x[id];
+  double vec_x = fields->vec_x[id], vec_y = fields->vec_y[id];
+  double strength = fields->strength[id];
+
+  switch (fields->type[id]) {
+  case FIELD_UNIFORM:
+    for (size_t i = first; i < last; i++) {
+      force_x[i] += mass[i] * vec_x;
+      force_y[i] += mass[i] * vec_y;
+    }
+    break;
+
+  case FIELD_WIND:
+    for (size_t i = first; i < last; i++) {
+      double inside = pos_x[i] >= min_x && pos_x[i] <= max_x;
+      force_x[i] += inside * strength * (vec_x - vel_x[i]);
+      force_y[i] += inside * strength * (vec_y - vel_y[i]);
+    }
+    break;
+
+  case FIELD_RADIAL: {
+    double radius = max_x - vec_x;
+    for (size_t i = first; i < last; i++) {
+      double dx = vec_x - pos_x[i], dy = vec_y - pos_y[i];
+      double dist = sqrt(dx * dx + dy * dy);
+      double falloff = 1 - dist / radius;
+      if (falloff <= 0 || dist == 0) {
+        continue;
+      }
+      double scale = mass[i] * strength * falloff / dist;
+      force_x[i] += scale * dx;
+      force_y[i] += scale * dy;
+    }
+    break;
+  }
+  }
+}
+
+/**
+ * Orders gathered bodies by y, for qsort().
+ */
+static int compare_gathered(const void *a, const void *b) {
+  double y1 = ((const gathered_body_t *)a)->y;
+  double y2 = ((const gathered_body_t *)b)->y;
+  return (y1 > y2) - (y1 < y2);
+}
+
+void force_fields_apply(force_field_set_t *fields, body_t **bodies,
+                        size_t num_bodies) {
+  if (fields->num_fields == 0) {
+    return;
+  }
+
+  if (num_bodies > fields->body_capacity) {
+    reserve_bodies(fields, num_bodies);
+  }
+
+  // Sort the movable bodies by y; immovable bodies get no force anyway
+  size_t num_movable = 0;
+  for (size_t i = 0; i < num_bodies; i++) {
+    if (body_get_mass(bodies[i]) != INFINITY) {
+      fields->sorted[num_movable++] =
+          (gathered_body_t){body_get_centroid(bodies[i]).y, i};
+    }
+  }
+  if (num_movable == 0) {
+    return;
+  }
+  qsort(fields->sorted, num_movable, sizeof(gathered_body_t),
+        compare_gathered);
+
+  // Gather them in that order, along with their bounding box
+  double box_min_x = INFINITY, box_max_x = -INFINITY;
+  for (size_t j = 0; j < num_movable; j++) {
+    body_t *body = bodies[fields->sorted[j].index];
+    vector_t centroid = body_get_centroid(body);
+    vector_t velocity = body_get_velocity(body);
+
+    fields->body_index[j] = fields->sorted[j].index;
+    fields->pos_x[j] = centroid.x;
+    fields->pos_y[j] = centroid.y;
+    fields->vel_x[j] = velocity.x;
+    fields->vel_y[j] = velocity.y;
+    fields->mass[j] = body_get_mass(body);
+    fields->force_x[j] = 0;
+    fields->force_y[j] = 0;
+    box_min_x = fmin(box_min_x, centroid.x);
+    box_max_x = fmax(box_max_x, centroid.x);
+  }
+
+  // Each field only visits the bodies whose y is inside its box,
+  // found by binary search, and skips everything if its box misses them all
+  for (size_t id = 0; id < fields->num_fields; id++) {
+    if (!fields->enabled[id] || fields->max_x[id] < box_min_x ||
+        fields->min_x[id] > box_max_x) {
+      continue;
+    }
+    size_t first =
+        force_fields_lower_bound(fields, num_movable, fields->min_y[id]);
+    size_t last = first;
+    while (last < num_movable && fields->pos_y[last] <= fields->max_y[id]) {
+      last++;
+    }
+    if (first < last) {
+      force_field_accumulate(fields, id, first, last);
+    }
+  }
+
+  for (size_t j = 0; j < num_movable; j++) {
+    vector_t force = {fields->force_x[j], fields->force_y[j]};
+    if (!vec_cmp(force, VEC_ZERO)) {
+      body_add_force(bodies[fields->body_index[j]], force);
+    }
+  }
+}
@@ -8,18 +8,64 @@
 #include "collision.h"
 #include "list.h"
 
+#define ALLOC_TAG ALLOC_COLLISION
+#include "alloc.h"
+
 const double MIN_DIST = 5;
 const double DESTRUCTIVE_ELASTICITY = 0;
+const size_t CONTACT_INITIAL_CAPACITY = 8;
+const size_t CONTACT_GROWTH_FACTOR = 2;
+// Penetration that is left alone so resting contacts don't jitter
+const double CONTACT_SLOP = 0.5;
+// Fraction of the remaining penetration removed every tick
+const double CONTACT_CORRECTION = 0.8;
+// Closing speeds below this don't bounce, so resting bodies stay at rest
+const double RESTITUTION_THRESHOLD = 1;
+// How far a contact point can move between ticks and keep its impulse
+const double WARM_START_DISTANCE = 5;
 
 typedef struct body_aux {
   double force_const;
   list_t *bodies;
 } body_aux_t;
 
+typedef struct contact_pair {
+  size_t body1; // indices into the solver's body arrays
+  size_t body2;
+  double elasticity;
+  double friction;
+
+  contact_manifold_t manifold;
+  // Impulses accumulated at each contact point, kept between ticks
+  double normal_impulse[MAX_CONTACT_POINTS];
+  double tangent_impulse[MAX_CONTACT_POINTS];
+  double bias[MAX_CONTACT_POINTS]; // restitution target speed
+  double normal_mass;
+} contact_pair_t;
+
+struct contact_solver {
+  size_t iterations;
+  size_t num_contacts;
+
+  body_t **bodies;
+  vector_t *velocities;
+  vector_t *corrections;
+  double *inv_mass;
+  // Scratch space for the new index of each body when bodies are pruned
+  size_t *remap;
+  size_t num_bodies;
+  size_t body_capacity;
+
+  contact_pair_t *pairs;
+  size_t num_pairs;
+  size_t pair_capacity;
+};
+
 typedef struct collision_aux {
   double force_const;
   list_t *bodies;
-  collision_handler_t handler;
+  collision_events_t *events;
+  size_t handler_id;
   bool collided;
   void *aux; // aux (if allocated in memory) should be free'd by the caller
 } collision_aux_t;
@@ -35,6 +81,7 @@ body_aux_t *body_aux_init(double force_const, list_t *bodies) {
 }
 
 collision_aux_t *collision_aux_init(double force_const, list_t *bodies,
+                                    collision_events_t *events,
                                     collision_handler_t handler, bool collided,
                                     void *aux) {
   collision_aux_t *collision_aux = malloc(sizeof(collision_aux_t));
@@ -42,7 +89,8 @@ collision_aux_t *collision_aux_init(double force_const, list_t *bodies,
 
   collision_aux->force_const = force_const;
   collision_aux->bodies = bodies;
-  collision_aux->handler = handler;
+  collision_aux->events = events;
+  collision_aux->handler_id = collision_events_handler_id(events, handler);
   collision_aux->collided = collided;
   collision_aux->aux = aux;
   return collision_aux;
@@ -157,7 +205,7 @@ void create_drag(scene_t *scene, double gamma, body_t *body) {
 
 /**
  * The force creator for collisions. Checks if the bodies in the collision aux
- * are colliding, and if they do, runs the collision handler on the bodies.
+ * started or stopped colliding, and if so, queues an event for the handler.
  *
  * @param info auxiliary information about the force and associated body
  */
@@ -173,13 +221,18 @@ static void collision_force_creator(void *collision_aux) {
 
   collision_info_t info = find_collision(body1, body2);
   // avoids registering impulse multiple times while bodies are still colliding
-  if (info.collided && !prev_collision) {
-    collision_handler_t handler = col_aux->handler;
-
-    handler(body1, body2, info.axis, col_aux->aux, col_aux->force_const);
-    col_aux->collided = true;
-  } else if (!info.collided && prev_collision) {
-    col_aux->collided = false;
+  if (info.collided != prev_collision) {
+    collision_event_t event = {
+        .type = info.collided ? COLLISION_BEGIN : COLLISION_END,
+        .body1 = body1,
+        .body2 = body2,
+        .axis = info.collided ? info.axis : VEC_ZERO,
+        .depth = info.collided ? info.depth : 0,
+        .handler = col_aux->handler_id,
+        .aux = col_aux->aux,
+        .force_const = col_aux->force_const};
+    collision_events_push(col_aux->events, event);
+    col_aux->collided = info.collided;
   }
 }
 
@@ -201,7 +254,9 @@ void create_collision(scene_t *scene, body_t *body1, body_t *body2,
   list_add(aux_bodies, body2);
 
   collision_aux_t *collision_aux =
-      collision_aux_init(force_const, aux_bodies, handler, false, aux);
+      collision_aux_init(force_const, aux_bodies,
+                         scene_get_collision_events(scene), handler, false,
+                         aux);
 
   scene_add_bodies_force_creator(scene, collision_force_creator, collision_aux,
                                  bodies);
@@ -223,43 +278,16 @@ void create_destructive_collision(scene_t *scene, body_t *body1,
   list_t *bodies = list_init(2, NULL);
   list_add(bodies, body1);
   list_add(bodies, body2);
-  collision_aux_t *aux = collision_aux_init(DESTRUCTIVE_ELASTICITY, bodies,
-                                            destructive_collision, false, NULL);
+  collision_aux_t *aux = collision_aux_init(
+      DESTRUCTIVE_ELASTICITY, bodies, scene_get_collision_events(scene),
+      destructive_collision, false, NULL);
   scene_add_bodies_force_creator(scene, collision_force_creator, aux, bodies);
 }
 
 void physics_collision_handler(body_t *body1, body_t *body2, vector_t axis,
                                void *aux, double force_const) {
-  //if (strcmp((char*)aux, "v_0") == 0){
   body_set_velocity(body1, VEC_ZERO);
   body_set_velocity(body2, VEC_ZERO);
-  return;
-  // }
-  double mass1 = body_get_mass(body1);
-  double mass2 = body_get_mass(body2);
-  double mass3 = mass1;
-  double mass4 = mass2;
-
-  vector_t v_1 = body_get_velocity(body1);
-  vector_t v_2 = body_get_velocity(body2);
-  double u_a = vec_dot(v_1, axis);
-  double u_b = vec_dot(v_2, axis);
-  vector_t impulse = VEC_ZERO;
-
-  if (mass1 == INFINITY) {
-    mass1 = mass2;
-    mass3 = 0;
-  }
-  if (mass2 == INFINITY) {
-    mass2 = mass1;
-    mass4 = 0;
-  }
-  impulse = vec_multiply(((mass1 * mass2) / (mass3 + mass4)) *
-                             (1 + force_const) * (u_b - u_a),
-                         axis);
-
-  body_add_impulse(body1, impulse);
-  body_add_impulse(body2, vec_multiply(-1, impulse));
 }
 
 void create_physics_collision(scene_t *scene, body_t *body1, body_t *body2,
@@ -267,3 +295,309 @@ void create_physics_collision(scene_t *scene, body_t *body1, body_t *body2,
   create_collision(scene, body1, body2, physics_collision_handler, NULL,
                    elasticity);
 }
+
+static void contact_solver_free(contact_solver_t *solver) {
+  free(solver->bodies);
+  free(solver->velocities);
+  free(solver->corrections);
+  free(solver->inv_mass);
+  free(solver->remap);
+  free(solver->pairs);
+  free(solver);
+}
+
+static void contact_solver_reserve_bodies(contact_solver_t *solver,
+                                          size_t capacity) {
+  solver->bodies = realloc(solver->bodies, capacity * sizeof(body_t *));
+  solver->velocities =
+      realloc(solver->velocities, capacity * sizeof(vector_t));
+  solver->corrections =
+      realloc(solver->corrections, capacity * sizeof(vector_t));
+  solver->inv_mass = realloc(solver->inv_mass, capacity * sizeof(double));
+  solver->remap = realloc(solver->remap, capacity * sizeof(size_t));
+  assert(solver->bodies && solver->velocities && solver->corrections &&
+         solver->inv_mass && solver->remap);
+  solver->body_capacity = capacity;
+}
+
+/**
+ * Returns the index of a body in the solver's body arrays,
+ * adding the body if the solver doesn't reference it yet.
+ */
+static size_t contact_solver_body_index(contact_solver_t *solver,
+                                        body_t *body) {
+  for (size_t i = 0; i < solver->num_bodies; i++) {
+    if (solver->bodies[i] == body) {
+      return i;
+    }
+  }
+  if (solver->num_bodies >= solver->body_capacity) {
+    contact_solver_reserve_bodies(
+        solver, solver->body_capacity * CONTACT_GROWTH_FACTOR);
+  }
+  solver->bodies[solver->num_bodies] = body;
+  return solver->num_bodies++;
+}
+
+/**
+ * Drops the pairs whose bodies are marked for removal and compacts the body
+ * arrays. This must run before the removed bodies are freed by the scene.
+ */
+static void contact_solver_prune(contact_solver_t *solver) {
+  bool any_removed = false;
+  for (size_t i = 0; i < solver->num_bodies; i++) {
+    if (body_is_removed(solver->bodies[i])) {
+      any_removed = true;
+      break;
+    }
+  }
+  if (!any_removed) {
+    return;
+  }
+
+  size_t p = 0;
+  while (p < solver->num_pairs) {
+    contact_pair_t *pair = &solver->pairs[p];
+    if (body_is_removed(solver->bodies[pair->body1]) ||
+        body_is_removed(solver->bodies[pair->body2])) {
+      *pair = solver->pairs[--solver->num_pairs];
+    } else {
+      p++;
+    }
+  }
+
+  // Compact the live bodies, remembering their new indices
+  size_t live = 0;
+  for (size_t i = 0; i < solver->num_bodies; i++) {
+    if (!body_is_removed(solver->bodies[i])) {
+      solver->bodies[live] = solver->bodies[i];
+      solver->remap[i] = live;
+      live++;
+    }
+  }
+  solver->num_bodies = live;
+  for (size_t i = 0; i < solver->num_pairs; i++) {
+    solver->pairs[i].body1 = solver->remap[solver->pairs[i].body1];
+    solver->pairs[i].body2 = solver->remap[solver->pairs[i].body2];
+  }
+}
+
+/**
+ * Applies an impulse to the velocities of a pair's bodies,
+ * pushing body2 along the impulse and body1 against it.
+ */
+static void contact_apply_impulse(contact_solver_t *solver,
+                                  contact_pair_t *pair, vector_t impulse) {
+  vector_t *v1 = &solver->velocities[pair->body1];
+  vector_t *v2 = &solver->velocities[pair->body2];
+  *v1 = vec_subtract(*v1, vec_multiply(solver->inv_mass[pair->body1], impulse));
+  *v2 = vec_add(*v2, vec_multiply(solver->inv_mass[pair->body2], impulse));
+}
+
+/**
+ * Finds a pair's new contact manifold, carries over the impulses of contact
+ * points that barely moved since the last tick and applies them.
+ */
+static void contact_pair_prepare(contact_solver_t *solver,
+                                 contact_pair_t *pair) {
+  double w1 = solver->inv_mass[pair->body1];
+  double w2 = solver->inv_mass[pair->body2];
+  contact_manifold_t old = pair->manifold;
+  double old_normal[MAX_CONTACT_POINTS], old_tangent[MAX_CONTACT_POINTS];
+  for (size_t i = 0; i < old.num_contacts; i++) {
+    old_normal[i] = pair->normal_impulse[i];
+    old_tangent[i] = pair->tangent_impulse[i];
+  }
+
+  pair->manifold = find_contact_manifold(solver->bodies[pair->body1],
+                                         solver->bodies[pair->body2]);
+  if (w1 + w2 == 0) {
+    pair->manifold.num_contacts = 0;
+  }
+  contact_manifold_t *manifold = &pair->manifold;
+  if (manifold->num_contacts == 0) {
+    return;
+  }
+
+  vector_t normal = manifold->normal;
+  vector_t tangent = {-normal.y, normal.x};
+  vector_t v_rel = vec_subtract(solver->velocities[pair->body2],
+                                solver->velocities[pair->body1]);
+  double closing_speed = vec_dot(v_rel, normal);
+  pair->normal_mass = 1 / (w1 + w2);
+
+  for (size_t i = 0; i < manifold->num_contacts; i++) {
+    pair->normal_impulse[i] = 0;
+    pair->tangent_impulse[i] = 0;
+    for (size_t j = 0; j < old.num_contacts; j++) {
+      vector_t moved = vec_subtract(manifold->points[i], old.points[j]);
+      if (vec_get_length(moved) < WARM_START_DISTANCE) {
+        pair->normal_impulse[i] = old_normal[j];
+        pair->tangent_impulse[i] = old_tangent[j];
+        break;
+      }
+    }
+
+    pair->bias[i] = closing_speed < -RESTITUTION_THRESHOLD
+                        ? -pair->elasticity * closing_speed
+                        : 0;
+
+    // Warm start with last tick's impulses
+    vector_t impulse =
+        vec_add(vec_multiply(pair->normal_impulse[i], normal),
+                vec_multiply(pair->tangent_impulse[i], tangent));
+    contact_apply_impulse(solver, pair, impulse);
+  }
+}
+
+/**
+ * Runs one sequential-impulse iteration over a pair's contact points,
+ * clamping the accumulated (not the incremental) impulses.
+ */
+static void contact_pair_solve(contact_solver_t *solver,
+                               contact_pair_t *pair) {
+  contact_manifold_t *manifold = &pair->manifold;
+  vector_t normal = manifold->normal;
+  vector_t tangent = {-normal.y, normal.x};
+
+  for (size_t i = 0; i < manifold->num_contacts; i++) {
+    // Friction, bounded by the normal impulse at this point
+    vector_t v_rel = vec_subtract(solver->velocities[pair->body2],
+                                  solver->velocities[pair->body1]);
+    double max_friction = pair->friction * pair->normal_impulse[i];
+    double old_tangent = pair->tangent_impulse[i];
+    double tangent_impulse =
+        old_tangent - pair->normal_mass * vec_dot(v_rel, tangent);
+    tangent_impulse = fmax(-max_friction, fmin(max_friction, tangent_impulse));
+    pair->tangent_impulse[i] = tangent_impulse;
+    contact_apply_impulse(
+        solver, pair, vec_multiply(tangent_impulse - old_tangent, tangent));
+
+    // Normal impulse, which may only push the bodies apart
+    v_rel = vec_subtract(solver->velocities[pair->body2],
+                         solver->velocities[pair->body1]);
+    double old_normal = pair->normal_impulse[i];
+    double normal_impulse =
+        old_normal +
+        pair->normal_mass * (pair->bias[i] - vec_dot(v_rel, normal));
+    normal_impulse = fmax(0, normal_impulse);
+    pair->normal_impulse[i] = normal_impulse;
+    contact_apply_impulse(solver, pair,
+                          vec_multiply(normal_impulse - old_normal, normal));
+  }
+}
+
+/**
+ * Moves a pair's bodies apart to remove most of their remaining penetration.
+ */
+static void contact_pair_correct(contact_solver_t *solver,
+                                 contact_pair_t *pair) {
+  contact_manifold_t *manifold = &pair->manifold;
+  double depth = 0;
+  for (size_t i = 0; i < manifold->num_contacts; i++) {
+    depth = fmax(depth, manifold->depths[i]);
+  }
+  if (depth <= CONTACT_SLOP) {
+    return;
+  }
+
+  vector_t correction = vec_multiply(
+      CONTACT_CORRECTION * (depth - CONTACT_SLOP) * pair->normal_mass,
+      manifold->normal);
+  vector_t *c1 = &solver->corrections[pair->body1];
+  vector_t *c2 = &solver->corrections[pair->body2];
+  *c1 = vec_subtract(
+      *c1, vec_multiply(solver->inv_mass[pair->body1], correction));
+  *c2 = vec_add(*c2, vec_multiply(solver->inv_mass[pair->body2], correction));
+}
+
+/**
+ * The constraint solver for contacts registered with a scene.
+ *
+ * @param aux the contact solver
+ * @param dt the number of seconds elapsed over the tick
+ */
+static void contact_solver_step(void *aux, double dt) {
+  contact_solver_t *solver = aux;
+  contact_solver_prune(solver);
+
+  for (size_t i = 0; i < solver->num_bodies; i++) {
+    body_t *body = solver->bodies[i];
+    double mass = body_get_mass(body);
+    solver->velocities[i] = body_get_velocity(body);
+    solver->corrections[i] = VEC_ZERO;
+    solver->inv_mass[i] = mass == INFINITY ? 0 : 1 / mass;
+  }
+
+  solver->num_contacts = 0;
+  for (size_t p = 0; p < solver->num_pairs; p++) {
+    contact_pair_prepare(solver, &solver->pairs[p]);
+    solver->num_contacts += solver->pairs[p].manifold.num_contacts;
+  }
+  for (size_t iter = 0; iter < solver->iterations; iter++) {
+    for (size_t p = 0; p < solver->num_pairs; p++) {
+      contact_pair_solve(solver, &solver->pairs[p]);
+    }
+  }
+  for (size_t p = 0; p < solver->num_pairs; p++) {
+    contact_pair_correct(solver, &solver->pairs[p]);
+  }
+
+  for (size_t i = 0; i < solver->num_bodies; i++) {
+    if (solver->inv_mass[i] == 0) {
+      continue;
+    }
+    body_t *body = solver->bodies[i];
+    body_set_velocity(body, solver->velocities[i]);
+    if (!vec_cmp(solver->corrections[i], VEC_ZERO)) {
+      body_set_centroid(
+          body, vec_add(body_get_centroid(body), solver->corrections[i]));
+    }
+  }
+}
+
+contact_solver_t *create_contact_solver(scene_t *scene, size_t iterations) {
+  assert(iterations > 0);
+  contact_solver_t *solver = calloc(1, sizeof(contact_solver_t));
+  assert(solver);
+
+  solver->iterations = iterations;
+  contact_solver_reserve_bodies(solver, CONTACT_INITIAL_CAPACITY);
+  solver->pairs = malloc(CONTACT_INITIAL_CAPACITY * sizeof(contact_pair_t));
+  assert(solver->pairs);
+  solver->pair_capacity = CONTACT_INITIAL_CAPACITY;
+
+  scene_add_constraint_solver(scene, contact_solver_step, solver,
+                              (free_func_t)contact_solver_free);
+  return solver;
+}
+
+void contact_solver_add_pair(contact_solver_t *solver, body_t *body1,
+                             body_t *body2, double elasticity,
+                             double friction) {
+  assert(body1 != body2);
+  if (solver->num_pairs >= solver->pair_capacity) {
+    solver->pair_capacity *= CONTACT_GROWTH_FACTOR;
+    solver->pairs =
+        realloc(solver->pairs, solver->pair_capacity * sizeof(contact_pair_t));
+    assert(solver->pairs);
+  }
+
+  contact_pair_t *pair = &solver->pairs[solver->num_pairs++];
+  pair->body1 = contact_solver_body_index(solver, body1);
+  pair->body2 = contact_solver_body_index(solver, body2);
+  pair->elasticity = elasticity;
+  pair->friction = friction;
+  pair->manifold.collided = false;
+  pair->manifold.num_contacts = 0;
+}
+
+void contact_solver_set_iterations(contact_solver_t *solver,
+                                   size_t iterations) {
+  assert(iterations > 0);
+  solver->iterations = iterations;
+}
+
+size_t contact_solver_num_contacts(contact_solver_t *solver) {
+  return solver->num_contacts;
+}
@@ -0,0 +1,168 @@
+#include "frame_timer.h"
+
+#include <SDL2/SDL.h>
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define ALLOC_TAG ALLOC_PROFILING
+#include "alloc.h"
+
+// How many of the most recent frames the histogram covers
+const size_t FRAME_TIMER_WINDOW = 240;
+// Width of a histogram bucket, in seconds
+const double FRAME_TIMER_BUCKET_WIDTH = 0.00025;
+// Frames longer than this many buckets all go in the last bucket
+const size_t FRAME_TIMER_NUM_BUCKETS = 400;
+const double FRAME_TIMER_MS_PER_SECOND = 1000;
+
+struct frame_timer {
+  uint64_t frequency;
+  uint64_t last_tick; // 0 until the first tick
+  double dt;
+
+  double refresh_interval; // 0 if the refresh rate is unknown
+  double budget; // 0 if there is no budget
+  size_t missed_vsyncs;
+  size_t over_budget;
+
+  // The bucket of each recent frame, oldest first from window_next
+  size_t *window;
+  size_t window_next;
+  size_t window_size;
+  size_t *bucket_counts;
+};
+
+frame_timer_t *frame_timer_init(double refresh_rate) {
+  frame_timer_t *timer = malloc(sizeof(frame_timer_t));
+  assert(timer);
+
+  timer->frequency = SDL_GetPerformanceFrequency();
+  timer->last_tick = 0;
+  timer->dt = 0;
+  timer->missed_vsyncs = 0;
+  timer->budget = 0;
+  timer->over_budget = 0;
+  frame_timer_set_refresh_rate(timer, refresh_rate);
+
+  timer->window = malloc(sizeof(size_t) * FRAME_TIMER_WINDOW);
+  assert(timer->window);
+  timer->window_next = 0;
+  timer->window_size = 0;
+  timer->bucket_counts = calloc(FRAME_TIMER_NUM_BUCKETS, sizeof(size_t));
+  assert(timer->bucket_counts);
+  return timer;
+}
+
+void frame_timer_free(frame_timer_t *timer) {
+  free(timer->window);
+  free(timer->bucket_counts);
+  free(timer);
+}
+
+void frame_timer_set_refresh_rate(frame_timer_t *timer, double refresh_rate) {
+  timer->refresh_interval = refresh_rate > 0 ? 1 / refresh_rate : 0;
+}
+
+/**
+ * Adds a frame time to the histogram, evicting the oldest frame
+ * once the window is full.
+ */
+static void frame_timer_record(frame_timer_t *timer, double dt) {
+  size_t bucket = (size_t)(dt / FRAME_TIMER_BUCKET_WIDTH);
+  if (bucket >= FRAME_TIMER_NUM_BUCKETS) {
+    bucket = FRAME_TIMER_NUM_BUCKETS - 1;
+  }
+
+  if (timer->window_size == FRAME_TIMER_WINDOW) {
+    timer->bucket_counts[timer->window[timer->window_next]]--;
+  } else {
+    timer->window_size++;
+  }
+  timer->window[timer->window_next] = bucket;
+  timer->window_next = (timer->window_next + 1) % FRAME_TIMER_WINDOW;
+  timer->bucket_counts[bucket]++;
+}
+
+double frame_timer_tick(frame_timer_t *timer) {
+  uint64_t now = SDL_GetPerformanceCounter();
+  if (timer->last_tick == 0) {
+    timer->last_tick = now;
+    return 0.0; // return 0 the first time this is called
+  }
+  timer->dt = (double)(now - timer->last_tick) / timer->frequency;
+  timer->last_tick = now;
+
+  frame_timer_record(timer, timer->dt);
+  if (timer->refresh_interval > 0) {
+    // A frame spanning n intervals (to the nearest one) missed n - 1 vsyncs
+    double intervals = round(timer->dt / timer->refresh_interval);
+    if (intervals > 1) {
+      timer->missed_vsyncs += (size_t)intervals - 1;
+    }
+  }
+  if (timer->budget > 0 && timer->dt > timer->budget) {
+    timer->over_budget++;
+  }
+  return timer->dt;
+}
+
+double frame_timer_dt(frame_timer_t *timer) { return timer->dt; }
+
+double frame_timer_percentile(frame_timer_t *timer, double percentile) {
+  assert(0 <= percentile && percentile <= 100);
+  if (timer->window_size == 0) {
+    return 0;
+  }
+  size_t rank = (size_t)ceil(percentile / 100 * timer->window_size);
+  if (rank == 0) {
+    rank = 1;
+  }
+  size_t seen = 0;
+  size_t bucket = 0;
+  for (; bucket < FRAME_TIMER_NUM_BUCKETS - 1; bucket++) {
+    seen += timer->bucket_counts[bucket];
+    if (seen >= rank) {
+      break;
+    }
+  }
+  // Report the top of the bucket, so the estimate errs on the slow side
+  return (bucket + 1) * FRAME_TIMER_BUCKET_WIDTH;
+}
+
+size_t frame_timer_missed_vsyncs(frame_timer_t *timer) {
+  return timer->missed_vsyncs;
+}
+
+void frame_timer_set_budget(frame_timer_t *timer, double budget) {
+  assert(budget >= 0);
+  timer->budget = budget;
+}
+
+double frame_timer_budget_left(frame_timer_t *timer) {
+  if (timer->budget == 0) {
+    return INFINITY;
+  }
+  if (timer->last_tick == 0) {
+    return timer->budget;
+  }
+  double elapsed =
+      (double)(SDL_GetPerformanceCounter() - timer->last_tick) /
+      timer->frequency;
+  return timer->budget - elapsed;
+}
+
+size_t frame_timer_over_budget(frame_timer_t *timer) {
+  return timer->over_budget;
+}
+
+void frame_timer_print(frame_timer_t *timer, FILE *out) {
+  fprintf(out,
+          "frame time p50 %.2f ms, p95 %.2f ms, p99 %.2f ms; "
+          "%zu missed vsyncs, %zu frames over budget\n",
+          frame_timer_percentile(timer, 50) * FRAME_TIMER_MS_PER_SECOND,
+          frame_timer_percentile(timer, 95) * FRAME_TIMER_MS_PER_SECOND,
+          frame_timer_percentile(timer, 99) * FRAME_TIMER_MS_PER_SECOND,
+          timer->missed_vsyncs, timer->over_budget);
+}
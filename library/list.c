@@ -2,6 +2,9 @@
 #include <assert.h>
 #include <stdlib.h>
 
+#define ALLOC_TAG ALLOC_CONTAINERS
+#include "alloc.h"
+
 const size_t GROWTH_FACTOR = 2;
 
 typedef struct list {
@@ -81,3 +84,19 @@ void *list_remove(list_t *list, size_t index) {
   list->cur_size--;
   return removed;
 }
+
+size_t list_remove_if(list_t *list, bool (*remove)(void *, void *),
+                      void *aux) {
+  size_t kept = 0;
+  for (size_t i = 0; i < list->cur_size; i++) {
+    void *value = list->data[i];
+    if (!remove(value, aux)) {
+      list->data[kept++] = value;
+    } else if (list->freer != NULL) {
+      list->freer(value);
+    }
+  }
+  size_t removed = list->cur_size - kept;
+  list->cur_size = kept;
+  return removed;
+}
@@ -1,14 +1,21 @@
 #include "polygon.h"
+#include <assert.h>
 #include <math.h>
 #include <stdlib.h>
 
+#define ALLOC_TAG ALLOC_PHYSICS
+#include "alloc.h"
+
 struct polygon {
-  list_t *points;
+  vertex_list_t points;
   vector_t velocity;
   double rotation_speed;
   rgb_color_t *color;
   vector_t center;
   double tot_rotation_angle;
+  // Cached triangulation, or NULL until polygon_get_triangles() is called
+  int *triangles;
+  size_t num_triangle_indices;
 };
 
 polygon_t *polygon_init(list_t *points, vector_t initial_velocity,
@@ -23,12 +30,19 @@ polygon_t *polygon_init(list_t *points, vector_t initial_velocity,
     return NULL; // Allocation failed
   }
 
-  polygon->points = points;
+  vertex_list_init(&polygon->points);
+  vertex_list_reserve(&polygon->points, list_size(points));
+  for (size_t i = 0; i < list_size(points); i++) {
+    vertex_list_push(&polygon->points, *(vector_t *)list_get(points, i));
+  }
+  list_free(points);
   polygon->velocity = initial_velocity;
   polygon->rotation_speed = rotation_speed;
   polygon->color = color_init(red, green, blue); // Create color from RGB
   polygon->center = polygon_centroid(polygon);
   polygon->tot_rotation_angle = 0;
+  polygon->triangles = NULL;
+  polygon->num_triangle_indices = 0;
   return polygon;
 }
 
@@ -36,17 +50,20 @@ void polygon_free(polygon_t *polygon) {
   if (polygon == NULL) {
     return;
   }
-  list_free(polygon->points); // Assumes list_free also frees the elements
+  vertex_list_free(&polygon->points);
   color_free(polygon->color);
+  free(polygon->triangles);
   free(polygon);
 }
 
-list_t *polygon_get_points(polygon_t *polygon) { return polygon->points; }
+vertex_list_t *polygon_get_points(polygon_t *polygon) {
+  return &polygon->points;
+}
 
 void polygon_move(polygon_t *polygon, double time_elapsed) {
   // Update the position of each point based on velocity and time elapsed
-  list_t *points = polygon->points;
-  size_t num_points = list_size(points);
+  vertex_list_t *points = &polygon->points;
+  size_t num_points = vertex_list_size(points);
 
   // Update the centroid of the polygon
   vector_t center = polygon_get_center(polygon);
@@ -56,7 +73,7 @@ void polygon_move(polygon_t *polygon, double time_elapsed) {
 
   // Update every point
   for (size_t i = 0; i < num_points; i++) {
-    vector_t *point = list_get(points, i);
+    vector_t *point = vertex_list_get(points, i);
     point->x += polygon->velocity.x * time_elapsed;
     point->y += polygon->velocity.y * time_elapsed;
   }
@@ -69,13 +86,13 @@ void polygon_set_velocity(polygon_t *polygon, vector_t v) {
 vector_t polygon_get_velocity(polygon_t *polygon) { return polygon->velocity; }
 
 double polygon_area(polygon_t *polygon) {
-  list_t *points = polygon_get_points(polygon);
+  vertex_list_t *points = polygon_get_points(polygon);
   double area = 0;
-  size_t num_points = list_size(points);
+  size_t num_points = vertex_list_size(points);
 
   for (size_t i = 0; i < num_points; i++) {
-    vector_t *v1 = list_get(points, i);
-    vector_t *v2 = list_get(points, (i + 1) % num_points);
+    vector_t *v1 = vertex_list_get(points, i);
+    vector_t *v2 = vertex_list_get(points, (i + 1) % num_points);
     area += vec_cross(*v1, *v2);
   }
 
@@ -89,11 +106,11 @@ vector_t polygon_centroid(polygon_t *polygon) {
   }
   double x = 0.0, y = 0.0;
   double cross;
-  list_t *points = polygon_get_points(polygon);
-  size_t num_points = list_size(points);
+  vertex_list_t *points = polygon_get_points(polygon);
+  size_t num_points = vertex_list_size(points);
   for (size_t i = 0; i < num_points; i++) {
-    vector_t *v1 = list_get(points, i);
-    vector_t *v2 = list_get(points, (i + 1) % num_points);
+    vector_t *v1 = vertex_list_get(points, i);
+    vector_t *v2 = vertex_list_get(points, (i + 1) % num_points);
     cross = vec_cross(*v1, *v2);
 
     x += ((v1->x + v2->x) * cross);
@@ -104,22 +121,22 @@ vector_t polygon_centroid(polygon_t *polygon) {
 }
 
 void polygon_translate(polygon_t *polygon, vector_t translation) {
-  list_t *points = polygon->points;
-  size_t num_points = list_size(points);
+  vertex_list_t *points = &polygon->points;
+  size_t num_points = vertex_list_size(points);
 
   for (size_t i = 0; i < num_points; i++) {
-    vector_t *cur_vector = list_get(points, i);
+    vector_t *cur_vector = vertex_list_get(points, i);
     cur_vector->x += translation.x;
     cur_vector->y += translation.y;
   }
 }
 
 void polygon_rotate(polygon_t *polygon, double angle, vector_t point) {
-  list_t *points = polygon->points;
-  size_t num_points = list_size(points);
+  vertex_list_t *points = &polygon->points;
+  size_t num_points = vertex_list_size(points);
 
   for (size_t i = 0; i < num_points; i++) {
-    vector_t *cur_vector = list_get(points, i);
+    vector_t *cur_vector = vertex_list_get(points, i);
     vector_t translated = vec_subtract(*cur_vector, point);
     vector_t rotated = vec_rotate(translated, angle);
 
@@ -128,6 +145,130 @@ void polygon_rotate(polygon_t *polygon, double angle, vector_t point) {
   }
 }
 
+/**
+ * Checks whether a polygon is convex, i.e. every turn is in the same direction.
+ */
+static bool polygon_is_convex(vertex_list_t *points) {
+  size_t n = vertex_list_size(points);
+  int turn = 0;
+  for (size_t i = 0; i < n; i++) {
+    vector_t *a = vertex_list_get(points, i);
+    vector_t *b = vertex_list_get(points, (i + 1) % n);
+    vector_t *c = vertex_list_get(points, (i + 2) % n);
+    double cross = vec_cross(vec_subtract(*b, *a), vec_subtract(*c, *b));
+    int sign = (cross > 0) - (cross < 0);
+    if (sign != 0 && turn != 0 && sign != turn) {
+      return false;
+    }
+    if (sign != 0) {
+      turn = sign;
+    }
+  }
+  return true;
+}
+
+/**
+ * Checks whether p lies inside or on the triangle abc,
+ * whose vertices turn in the direction given by the sign of orientation.
+ */
+static bool triangle_contains(vector_t a, vector_t b, vector_t c, vector_t p,
+                              double orientation) {
+  double ab = vec_cross(vec_subtract(b, a), vec_subtract(p, a)) * orientation;
+  double bc = vec_cross(vec_subtract(c, b), vec_subtract(p, b)) * orientation;
+  double ca = vec_cross(vec_subtract(a, c), vec_subtract(p, c)) * orientation;
+  return ab >= 0 && bc >= 0 && ca >= 0;
+}
+
+/**
+ * Triangulates a simple polygon by repeatedly clipping off an ear:
+ * a convex corner whose triangle contains no other remaining vertex.
+ * Writes 3 * (n - 2) indices, or fewer if the polygon is degenerate.
+ */
+static size_t polygon_ear_clip(vertex_list_t *points, int *indices) {
+  size_t n = vertex_list_size(points);
+  int *remaining = malloc(sizeof(int) * n);
+  assert(remaining != NULL);
+  for (size_t i = 0; i < n; i++) {
+    remaining[i] = i;
+  }
+
+  // The sign of the signed area tells us which way the polygon winds
+  double area = 0;
+  for (size_t i = 0; i < n; i++) {
+    area += vec_cross(*vertex_list_get(points, i),
+                      *vertex_list_get(points, (i + 1) % n));
+  }
+  double orientation = area < 0 ? -1 : 1;
+
+  size_t num_indices = 0, num_remaining = n, i = 0, misses = 0;
+  while (num_remaining > 3 && misses < num_remaining) {
+    size_t prev = (i + num_remaining - 1) % num_remaining;
+    size_t next = (i + 1) % num_remaining;
+    vector_t a = *vertex_list_get(points, remaining[prev]);
+    vector_t b = *vertex_list_get(points, remaining[i]);
+    vector_t c = *vertex_list_get(points, remaining[next]);
+
+    bool is_ear =
+        vec_cross(vec_subtract(b, a), vec_subtract(c, b)) * orientation > 0;
+    for (size_t j = 0; is_ear && j < num_remaining; j++) {
+      if (j != prev && j != i && j != next) {
+        vector_t p = *vertex_list_get(points, remaining[j]);
+        is_ear = !triangle_contains(a, b, c, p, orientation);
+      }
+    }
+
+    if (is_ear) {
+      indices[num_indices++] = remaining[prev];
+      indices[num_indices++] = remaining[i];
+      indices[num_indices++] = remaining[next];
+      for (size_t j = i; j + 1 < num_remaining; j++) {
+        remaining[j] = remaining[j + 1];
+      }
+      num_remaining--;
+      i %= num_remaining;
+      misses = 0;
+    } else {
+      i = (i + 1) % num_remaining;
+      misses++;
+    }
+  }
+
+  // Also reached when no ear is left, if the polygon intersects itself
+  if (num_remaining == 3) {
+    indices[num_indices++] = remaining[0];
+    indices[num_indices++] = remaining[1];
+    indices[num_indices++] = remaining[2];
+  }
+  free(remaining);
+  return num_indices;
+}
+
+const int *polygon_get_triangles(polygon_t *polygon, size_t *num_indices) {
+  if (polygon->triangles == NULL) {
+    vertex_list_t *points = &polygon->points;
+    size_t n = vertex_list_size(points);
+    size_t capacity = n >= 3 ? 3 * (n - 2) : 0;
+    polygon->triangles = malloc(sizeof(int) * (capacity > 0 ? capacity : 1));
+    assert(polygon->triangles != NULL);
+
+    if (n < 3) {
+      polygon->num_triangle_indices = 0;
+    } else if (polygon_is_convex(points)) {
+      for (size_t i = 1; i + 1 < n; i++) {
+        polygon->triangles[3 * (i - 1)] = 0;
+        polygon->triangles[3 * (i - 1) + 1] = i;
+        polygon->triangles[3 * (i - 1) + 2] = i + 1;
+      }
+      polygon->num_triangle_indices = capacity;
+    } else {
+      polygon->num_triangle_indices =
+          polygon_ear_clip(points, polygon->triangles);
+    }
+  }
+  *num_indices = polygon->num_triangle_indices;
+  return polygon->triangles;
+}
+
 rgb_color_t *polygon_get_color(polygon_t *polygon) { return polygon->color; }
 
 void polygon_set_color(polygon_t *polygon, rgb_color_t *color) {
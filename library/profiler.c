@@ -0,0 +1,157 @@
+#include "profiler.h"
+
+#include <SDL2/SDL.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ALLOC_TAG ALLOC_PROFILING
+#include "alloc.h"
+
+// How many events each thread keeps; older ones are overwritten
+const size_t PROFILER_RING_CAPACITY = 1 << 16;
+const double PROFILER_US_PER_SECOND = 1e6;
+
+typedef struct profile_event {
+  const char *name;
+  uint64_t time;
+  char phase; // 'B' or 'E', as in the trace format
+} profile_event_t;
+
+typedef struct thread_events {
+  unsigned long thread_id;
+  // Ring buffer of events; the oldest is at next once it is full
+  profile_event_t *events;
+  size_t next;
+  size_t count;
+  struct thread_events *next_thread;
+} thread_events_t;
+
+/**
+ * The calling thread's events, or NULL until it records its first one.
+ */
+_Thread_local thread_events_t *profiler_thread_events = NULL;
+/**
+ * Every thread's events, so they can be written together.
+ * Guarded by profiler_lock.
+ */
+thread_events_t *profiler_threads = NULL;
+SDL_SpinLock profiler_lock = 0;
+/**
+ * The counter value when the first event was recorded, which traces are
+ * timed from.
+ */
+uint64_t profiler_epoch = 0;
+
+/**
+ * Gets the calling thread's ring buffer, allocating it the first time.
+ */
+static thread_events_t *profiler_get_thread_events(void) {
+  if (profiler_thread_events == NULL) {
+    thread_events_t *thread = malloc(sizeof(thread_events_t));
+    assert(thread);
+    thread->thread_id = SDL_ThreadID();
+    thread->events = malloc(sizeof(profile_event_t) * PROFILER_RING_CAPACITY);
+    assert(thread->events);
+    thread->next = 0;
+    thread->count = 0;
+
+    SDL_AtomicLock(&profiler_lock);
+    if (profiler_threads == NULL) {
+      profiler_epoch = SDL_GetPerformanceCounter();
+    }
+    thread->next_thread = profiler_threads;
+    profiler_threads = thread;
+    SDL_AtomicUnlock(&profiler_lock);
+    profiler_thread_events = thread;
+  }
+  return profiler_thread_events;
+}
+
+/**
+ * Appends an event to the calling thread's ring buffer.
+ */
+static void profiler_record(const char *name, char phase) {
+  thread_events_t *thread = profiler_get_thread_events();
+  thread->events[thread->next] =
+      (profile_event_t){name, SDL_GetPerformanceCounter(), phase};
+  thread->next = (thread->next + 1) % PROFILER_RING_CAPACITY;
+  if (thread->count < PROFILER_RING_CAPACITY) {
+    thread->count++;
+  }
+}
+
+void profiler_begin(const char *name) { profiler_record(name, 'B'); }
+
+void profiler_end(const char *name) { profiler_record(name, 'E'); }
+
+/**
+ * Writes a string as a JSON string literal.
+ */
+static void profiler_write_string(FILE *out, const char *str) {
+  fputc('"', out);
+  for (; *str != '\0'; str++) {
+    if (*str == '"' || *str == '\\') {
+      fputc('\\', out);
+    }
+    fputc(*str, out);
+  }
+  fputc('"', out);
+}
+
+bool profiler_write_trace(const char *path) {
+  FILE *out = fopen(path, "w");
+  if (out == NULL) {
+    return false;
+  }
+  double frequency = SDL_GetPerformanceFrequency();
+  bool first = true;
+
+  fprintf(out, "{\"traceEvents\":[");
+  SDL_AtomicLock(&profiler_lock);
+  for (thread_events_t *thread = profiler_threads; thread != NULL;
+       thread = thread->next_thread) {
+    size_t oldest =
+        (thread->next + PROFILER_RING_CAPACITY - thread->count) %
+        PROFILER_RING_CAPACITY;
+    size_t depth = 0;
+    for (size_t i = 0; i < thread->count; i++) {
+      profile_event_t *event =
+          &thread->events[(oldest + i) % PROFILER_RING_CAPACITY];
+      // The zone began before the oldest event that was kept
+      if (event->phase == 'E' && depth == 0) {
+        continue;
+      }
+      depth += event->phase == 'B' ? 1 : -1;
+
+      fprintf(out, first ? "\n" : ",\n");
+      first = false;
+      fprintf(out, "{\"name\":");
+      profiler_write_string(out, event->name);
+      fprintf(out, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu}",
+              event->phase,
+              (event->time - profiler_epoch) / frequency *
+                  PROFILER_US_PER_SECOND,
+              thread->thread_id);
+    }
+  }
+  SDL_AtomicUnlock(&profiler_lock);
+  fprintf(out, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  return fclose(out) == 0;
+}
+
+void profiler_free(void) {
+  SDL_AtomicLock(&profiler_lock);
+  thread_events_t *thread = profiler_threads;
+  while (thread != NULL) {
+    thread_events_t *next = thread->next_thread;
+    free(thread->events);
+    free(thread);
+    thread = next;
+  }
+  profiler_threads = NULL;
+  SDL_AtomicUnlock(&profiler_lock);
+  // The calling thread starts a new buffer if it records again
+  profiler_thread_events = NULL;
+}
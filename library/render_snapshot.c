@@ -0,0 +1,290 @@
+#include "render_snapshot.h"
+#include "profiler.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ALLOC_TAG ALLOC_RENDER
+#include "alloc.h"
+
+const size_t SNAPSHOT_INITIAL_ITEMS = 64;
+const size_t SNAPSHOT_INITIAL_TEXT = 256;
+#define SNAPSHOT_BUFFERS 3
+// Set in the shared index when it holds a snapshot the renderer hasn't drawn
+const unsigned SNAPSHOT_FRESH = 4;
+const unsigned SNAPSHOT_INDEX_MASK = 3;
+
+typedef enum {
+  RENDER_ITEM_IMAGE,
+  RENDER_ITEM_TEXT,
+  RENDER_ITEM_LAYER
+} render_item_type_t;
+
+/**
+ * One thing to draw. The handles are recorded by the simulation;
+ * sprite and resolved_font are filled in by render_snapshot_resolve().
+ */
+typedef struct render_item {
+  render_item_type_t type;
+
+  // RENDER_ITEM_IMAGE
+  image_handle_t image;
+  SDL_Rect dest;
+  sprite_t sprite;
+
+  // RENDER_ITEM_TEXT
+  font_handle_t font;
+  size_t text; // offset of the string in the snapshot's text
+  vector_t position;
+  SDL_Color color;
+  int8_t font_size;
+  bool dynamic;
+  TTF_Font *resolved_font;
+
+  // RENDER_ITEM_LAYER
+  static_layer_t *layer;
+} render_item_t;
+
+struct render_snapshot {
+  double vertical_offset;
+  render_item_t *items;
+  size_t num_items;
+  size_t capacity;
+
+  // The strings of the text items, one after another
+  char *text;
+  size_t text_size;
+  size_t text_capacity;
+
+  bool resolved;
+};
+
+struct snapshot_buffer {
+  render_snapshot_t *snapshots[SNAPSHOT_BUFFERS];
+  // Owned by the simulation thread
+  unsigned back;
+  // Owned by the render thread
+  unsigned front;
+  // The snapshot between the two threads, plus SNAPSHOT_FRESH if it is new
+  atomic_uint middle;
+};
+
+render_snapshot_t *render_snapshot_init(void) {
+  render_snapshot_t *snapshot = malloc(sizeof(render_snapshot_t));
+  assert(snapshot);
+
+  snapshot->items = malloc(SNAPSHOT_INITIAL_ITEMS * sizeof(render_item_t));
+  assert(snapshot->items);
+  snapshot->vertical_offset = 0;
+  snapshot->num_items = 0;
+  snapshot->capacity = SNAPSHOT_INITIAL_ITEMS;
+
+  snapshot->text = malloc(SNAPSHOT_INITIAL_TEXT);
+  assert(snapshot->text);
+  snapshot->text_size = 0;
+  snapshot->text_capacity = SNAPSHOT_INITIAL_TEXT;
+  snapshot->resolved = false;
+  return snapshot;
+}
+
+/**
+ * Releases the snapshot's references to the images of its items.
+ */
+static void render_snapshot_release(render_snapshot_t *snapshot) {
+  for (size_t i = 0; i < snapshot->num_items; i++) {
+    render_item_t *item = &snapshot->items[i];
+    if (item->type == RENDER_ITEM_IMAGE) {
+      asset_cache_release_image(item->image);
+    }
+  }
+}
+
+void render_snapshot_free(render_snapshot_t *snapshot) {
+  render_snapshot_release(snapshot);
+  free(snapshot->items);
+  free(snapshot->text);
+  free(snapshot);
+}
+
+void render_snapshot_clear(render_snapshot_t *snapshot,
+                           double vertical_offset) {
+  render_snapshot_release(snapshot);
+  snapshot->vertical_offset = vertical_offset;
+  snapshot->num_items = 0;
+  snapshot->text_size = 0;
+  snapshot->resolved = false;
+}
+
+size_t render_snapshot_size(render_snapshot_t *snapshot) {
+  return snapshot->num_items;
+}
+
+/**
+ * Appends an item to a snapshot, growing it if it is full.
+ */
+static void render_snapshot_add(render_snapshot_t *snapshot,
+                                render_item_t item) {
+  if (snapshot->num_items >= snapshot->capacity) {
+    snapshot->capacity *= 2;
+    snapshot->items = realloc(snapshot->items,
+                              snapshot->capacity * sizeof(render_item_t));
+    assert(snapshot->items);
+  }
+  snapshot->items[snapshot->num_items++] = item;
+}
+
+void render_snapshot_add_image(render_snapshot_t *snapshot,
+                               image_handle_t image, SDL_Rect dest) {
+  asset_cache_retain_image(image);
+  render_snapshot_add(snapshot, (render_item_t){.type = RENDER_ITEM_IMAGE,
+                                                .image = image,
+                                                .dest = dest});
+}
+
+/**
+ * Copies a string into a snapshot's text, growing it if it is full,
+ * and returns the string's offset.
+ */
+static size_t render_snapshot_copy_text(render_snapshot_t *snapshot,
+                                        const char *text) {
+  size_t size = strlen(text) + 1;
+  if (snapshot->text_size + size > snapshot->text_capacity) {
+    while (snapshot->text_size + size > snapshot->text_capacity) {
+      snapshot->text_capacity *= 2;
+    }
+    snapshot->text = realloc(snapshot->text, snapshot->text_capacity);
+    assert(snapshot->text);
+  }
+  size_t offset = snapshot->text_size;
+  memcpy(snapshot->text + offset, text, size);
+  snapshot->text_size += size;
+  return offset;
+}
+
+void render_snapshot_add_text(render_snapshot_t *snapshot, font_handle_t font,
+                              const char *text, vector_t position,
+                              SDL_Color color, int8_t font_size, bool dynamic) {
+  assert(text != NULL);
+  render_snapshot_add(snapshot,
+                      (render_item_t){.type = RENDER_ITEM_TEXT,
+                                      .font = font,
+                                      .text = render_snapshot_copy_text(
+                                          snapshot, text),
+                                      .position = position,
+                                      .color = color,
+                                      .font_size = font_size,
+                                      .dynamic = dynamic});
+}
+
+void render_snapshot_add_layer(render_snapshot_t *snapshot,
+                               static_layer_t *layer) {
+  assert(layer != NULL);
+  render_snapshot_add(snapshot,
+                      (render_item_t){.type = RENDER_ITEM_LAYER,
+                                      .layer = layer});
+}
+
+void render_snapshot_resolve(render_snapshot_t *snapshot) {
+  PROFILE_BEGIN("render_snapshot_resolve");
+  for (size_t i = 0; i < snapshot->num_items; i++) {
+    render_item_t *item = &snapshot->items[i];
+    switch (item->type) {
+    case RENDER_ITEM_IMAGE:
+      // The snapshot holds a reference, so this can't be evicted before the
+      // snapshot is drawn
+      item->sprite = *asset_cache_image(item->image);
+      break;
+    case RENDER_ITEM_TEXT:
+      item->resolved_font = asset_cache_font(item->font);
+      break;
+    case RENDER_ITEM_LAYER:
+      static_layer_prepare(item->layer);
+      break;
+    }
+  }
+  snapshot->resolved = true;
+  PROFILE_END("render_snapshot_resolve");
+}
+
+void render_snapshot_draw(render_snapshot_t *snapshot) {
+  assert(snapshot->resolved);
+  PROFILE_BEGIN("render_snapshot_draw");
+  for (size_t i = 0; i < snapshot->num_items; i++) {
+    render_item_t *item = &snapshot->items[i];
+    switch (item->type) {
+    case RENDER_ITEM_IMAGE:
+      // The image may have failed to load
+      if (item->sprite.texture != NULL) {
+        sdl_batch_draw(item->sprite.texture, &item->sprite.src, item->dest);
+      }
+      break;
+    case RENDER_ITEM_TEXT: {
+      if (item->resolved_font == NULL) {
+        break;
+      }
+      const char *text = snapshot->text + item->text;
+      if (item->dynamic) {
+        sdl_render_glyphs(item->resolved_font, text, item->position,
+                          item->color);
+      } else {
+        sdl_render_font(item->resolved_font, text, item->position,
+                        item->color, item->font_size);
+      }
+      break;
+    }
+    case RENDER_ITEM_LAYER:
+      static_layer_render(item->layer, snapshot->vertical_offset);
+      break;
+    }
+  }
+  PROFILE_END("render_snapshot_draw");
+}
+
+snapshot_buffer_t *snapshot_buffer_init(void) {
+  snapshot_buffer_t *buffer = malloc(sizeof(snapshot_buffer_t));
+  assert(buffer);
+
+  for (size_t i = 0; i < SNAPSHOT_BUFFERS; i++) {
+    buffer->snapshots[i] = render_snapshot_init();
+  }
+  buffer->back = 0;
+  buffer->middle = 1;
+  buffer->front = 2;
+  return buffer;
+}
+
+void snapshot_buffer_free(snapshot_buffer_t *buffer) {
+  for (size_t i = 0; i < SNAPSHOT_BUFFERS; i++) {
+    render_snapshot_free(buffer->snapshots[i]);
+  }
+  free(buffer);
+}
+
+render_snapshot_t *snapshot_buffer_back(snapshot_buffer_t *buffer) {
+  return buffer->snapshots[buffer->back];
+}
+
+void snapshot_buffer_publish(snapshot_buffer_t *buffer) {
+  // Release makes the snapshot's contents visible before its index is
+  unsigned previous = atomic_exchange_explicit(
+      &buffer->middle, buffer->back | SNAPSHOT_FRESH, memory_order_acq_rel);
+  buffer->back = previous & SNAPSHOT_INDEX_MASK;
+}
+
+render_snapshot_t *snapshot_buffer_acquire(snapshot_buffer_t *buffer,
+                                           bool *fresh) {
+  bool is_fresh =
+      atomic_load_explicit(&buffer->middle, memory_order_relaxed) &
+      SNAPSHOT_FRESH;
+  if (is_fresh) {
+    unsigned previous = atomic_exchange_explicit(
+        &buffer->middle, buffer->front, memory_order_acq_rel);
+    buffer->front = previous & SNAPSHOT_INDEX_MASK;
+  }
+  if (fresh != NULL) {
+    *fresh = is_fresh;
+  }
+  return buffer->snapshots[buffer->front];
+}
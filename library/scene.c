@@ -10,14 +10,33 @@
 #include <stdlib.h>
 
 #include "forces.h"
+#include "profiler.h"
 #include "scene.h"
+#include "vec.h"
+
+#define ALLOC_TAG ALLOC_PHYSICS
+#include "alloc.h"
 
 extern size_t INITIAL_CAPACITY;
 
+const body_handle_t BODY_HANDLE_NONE = {0, 0};
+
+DEFINE_VEC(body_list, body_t *)
+DEFINE_VEC(slot_index_list, uint32_t)
+// Maps handles to the index of their body in the dense array
+DEFINE_SLOT_MAP(dense_index_map, uint32_t)
+
 struct scene {
-  size_t num_bodies;
-  list_t *bodies;
+  // The bodies, densely packed, and the slot of each one
+  body_list_t bodies;
+  slot_index_list_t body_slots;
+  dense_index_map_t slots;
+  // These stay list_t: they are only walked once per tick, and their elements
+  // are heap-allocated infos that own their aux and its freer
   list_t *force_creators;
+  list_t *constraint_solvers;
+  force_field_set_t *fields;
+  collision_events_t *collision_events;
 };
 
 typedef struct force_creator_info {
@@ -25,19 +44,56 @@ typedef struct force_creator_info {
   void *aux;
 } force_creator_info_t;
 
+typedef struct constraint_solver_info {
+  constraint_solver_t solver;
+  void *aux;
+  free_func_t freer;
+} constraint_solver_info_t;
+
 void force_creator_info_free(void *force_info) {
   force_creator_info_t *info = (force_creator_info_t *)force_info;
   body_aux_free(info->aux);
   free(info);
 }
 
+/**
+ * Checks whether a force creator acts on a body marked for removal,
+ * for list_remove_if().
+ */
+static bool force_creator_uses_removed_body(void *force_info, void *aux) {
+  force_creator_info_t *info = (force_creator_info_t *)force_info;
+  list_t *bodies = get_bodies_from_aux(info->aux);
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    if (body_is_removed(list_get(bodies, i))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void constraint_solver_info_free(void *solver_info) {
+  constraint_solver_info_t *info = (constraint_solver_info_t *)solver_info;
+  if (info->freer != NULL) {
+    info->freer(info->aux);
+  }
+  free(info);
+}
+
 scene_t *scene_init(void) {
   scene_t *scene = malloc(sizeof(scene_t));
   assert(scene);
-  scene->num_bodies = 0;
 
-  scene->bodies = list_init(INITIAL_CAPACITY, (free_func_t)body_free);
+  body_list_init(&scene->bodies);
+  body_list_reserve(&scene->bodies, INITIAL_CAPACITY);
+  slot_index_list_init(&scene->body_slots);
+  slot_index_list_reserve(&scene->body_slots, INITIAL_CAPACITY);
+  dense_index_map_init(&scene->slots);
+  dense_index_map_reserve(&scene->slots, INITIAL_CAPACITY);
   scene->force_creators = list_init(INITIAL_CAPACITY, force_creator_info_free);
+  scene->constraint_solvers =
+      list_init(INITIAL_CAPACITY, constraint_solver_info_free);
+  scene->fields = force_fields_init();
+  scene->collision_events = collision_events_init(INITIAL_CAPACITY);
 
   return scene;
 }
@@ -45,22 +101,64 @@ scene_t *scene_init(void) {
 void scene_free(scene_t *scene) {
   // Free force creators and their auxiliary data
   list_free(scene->force_creators);
-  list_free(scene->bodies);
+  list_free(scene->constraint_solvers);
+  force_fields_free(scene->fields);
+  collision_events_free(scene->collision_events);
+  for (size_t i = 0; i < body_list_size(&scene->bodies); i++) {
+    body_free(*body_list_get(&scene->bodies, i));
+  }
+  body_list_free(&scene->bodies);
+  slot_index_list_free(&scene->body_slots);
+  dense_index_map_free(&scene->slots);
   free(scene);
 }
 
-size_t scene_bodies(scene_t *scene) { return scene->num_bodies; }
+size_t scene_bodies(scene_t *scene) { return body_list_size(&scene->bodies); }
 
 body_t *scene_get_body(scene_t *scene, size_t index) {
-  body_t *body = list_get(scene->bodies, index);
+  body_t *body = *body_list_get(&scene->bodies, index);
   assert(body);
   return body;
 }
 
-void scene_add_body(scene_t *scene, body_t *body) {
-  list_t *bodies = scene->bodies;
-  list_add(bodies, body);
-  scene->num_bodies++;
+body_handle_t scene_get_handle(scene_t *scene, size_t index) {
+  uint32_t slot = *slot_index_list_get(&scene->body_slots, index);
+  slot_handle_t handle = dense_index_map_handle(&scene->slots, slot);
+  return (body_handle_t){handle.index, handle.generation};
+}
+
+body_t *scene_resolve_body(scene_t *scene, body_handle_t handle) {
+  uint32_t *dense_index = dense_index_map_find(
+      &scene->slots, (slot_handle_t){handle.index, handle.generation});
+  if (dense_index == NULL) {
+    return NULL;
+  }
+  return *body_list_get(&scene->bodies, *dense_index);
+}
+
+body_handle_t scene_add_body(scene_t *scene, body_t *body) {
+  assert(body != NULL);
+  slot_handle_t handle =
+      dense_index_map_insert(&scene->slots, body_list_size(&scene->bodies));
+  body_list_push(&scene->bodies, body);
+  slot_index_list_push(&scene->body_slots, handle.index);
+  return (body_handle_t){handle.index, handle.generation};
+}
+
+/**
+ * Takes the body at an index out of the dense array, by moving the last body
+ * into its place, and frees its slot. Doesn't free the body.
+ */
+static void scene_erase_body(scene_t *scene, size_t index) {
+  uint32_t slot = *slot_index_list_get(&scene->body_slots, index);
+  dense_index_map_erase(&scene->slots,
+                        dense_index_map_handle(&scene->slots, slot));
+  body_list_swap_remove(&scene->bodies, index);
+  slot_index_list_swap_remove(&scene->body_slots, index);
+  if (index < body_list_size(&scene->bodies)) {
+    uint32_t moved = *slot_index_list_get(&scene->body_slots, index);
+    *dense_index_map_get_slot(&scene->slots, moved) = index;
+  }
 }
 
 void scene_remove_body(scene_t *scene, size_t index) {
@@ -68,43 +166,81 @@ void scene_remove_body(scene_t *scene, size_t index) {
   body_remove(scene_get_body(scene, index));
 }
 
+force_field_set_t *scene_get_force_fields(scene_t *scene) {
+  return scene->fields;
+}
+
+collision_events_t *scene_get_collision_events(scene_t *scene) {
+  return scene->collision_events;
+}
+
 void scene_tick(scene_t *scene, double dt) {
+  PROFILE_BEGIN("scene_tick");
+
+  // Apply every force field in one pass over the bodies
+  PROFILE_BEGIN("force_fields");
+  force_fields_apply(scene->fields, body_list_data(&scene->bodies),
+                     body_list_size(&scene->bodies));
+  PROFILE_END("force_fields");
+
   // Execute all force creators
+  PROFILE_BEGIN("force_creators");
   for (size_t i = 0; i < list_size(scene->force_creators); i++) {
     force_creator_info_t *force_info = list_get(scene->force_creators, i);
     force_info->forcer(force_info->aux);
   }
+  PROFILE_END("force_creators");
+
+  // Run the collision handlers once detection is done
+  PROFILE_BEGIN("collision_events");
+  collision_events_dispatch(scene->collision_events);
+  PROFILE_END("collision_events");
 
-  // Update bodies and remove any that are marked for removal
-  ssize_t i = 0;
-  while (i < (ssize_t)list_size(scene->bodies)) {
+  // Update bodies that aren't marked for removal
+  PROFILE_BEGIN("body_tick");
+  for (size_t i = 0; i < scene_bodies(scene); i++) {
     body_t *body = scene_get_body(scene, i);
-    if (body_is_removed(body)) {
-      // Remove the associated force creators
-      ssize_t j = 0;
-      while (j < (ssize_t)list_size(scene->force_creators)) {
-        force_creator_info_t *force_info = list_get(scene->force_creators, j);
-        for (size_t k = 0; k < list_size(get_bodies_from_aux(force_info->aux));
-             k++) {
-          if (list_get(get_bodies_from_aux(force_info->aux), k) == body) {
-            list_remove(scene->force_creators, j);
-            force_creator_info_free(force_info);
-            j--;
-            break;
-          }
-        }
-        j++;
-      }
-      // Remove the body
-      list_remove(scene->bodies, i);
-      body_free(body);
-      scene->num_bodies--;
-    } else {
-      // If the body isn't removed, run body_tick and increment i
+    if (!body_is_removed(body)) {
       body_tick(body, dt);
-      i++;
     }
   }
+  PROFILE_END("body_tick");
+
+  // Correct the integrated bodies before any of them are freed
+  PROFILE_BEGIN("constraint_solvers");
+  for (size_t i = 0; i < list_size(scene->constraint_solvers); i++) {
+    constraint_solver_info_t *solver_info =
+        list_get(scene->constraint_solvers, i);
+    solver_info->solver(solver_info->aux, dt);
+  }
+  PROFILE_END("constraint_solvers");
+
+  // Remove any bodies that are marked for removal
+  PROFILE_BEGIN("remove_bodies");
+  bool any_removed = false;
+  for (size_t i = 0; i < scene_bodies(scene) && !any_removed; i++) {
+    any_removed = body_is_removed(scene_get_body(scene, i));
+  }
+  if (any_removed) {
+    // Drop the force creators on any removed body, in one pass, while the
+    // bodies can still be checked
+    list_remove_if(scene->force_creators, force_creator_uses_removed_body,
+                   NULL);
+    size_t i = 0;
+    while (i < scene_bodies(scene)) {
+      body_t *body = scene_get_body(scene, i);
+      if (body_is_removed(body)) {
+        // The last body moves to i, so i isn't advanced
+        scene_erase_body(scene, i);
+        body_free(body);
+      } else {
+        i++;
+      }
+    }
+  }
+  PROFILE_END("remove_bodies");
+
+  PROFILE_END("scene_tick");
 }
 
 void scene_add_force_creator(scene_t *scene, force_creator_t force_creator,
@@ -126,3 +262,16 @@ void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer,
 
   list_add(scene->force_creators, force_info);
 }
+
+void scene_add_constraint_solver(scene_t *scene, constraint_solver_t solver,
+                                 void *aux, free_func_t freer) {
+  constraint_solver_info_t *solver_info =
+      malloc(sizeof(constraint_solver_info_t));
+  assert(solver_info != NULL);
+
+  solver_info->solver = solver;
+  solver_info->aux = aux;
+  solver_info->freer = freer;
+
+  list_add(scene->constraint_solvers, solver_info);
+}
\ No newline at end of file
@@ -1,18 +1,39 @@
 #include "sdl_wrapper.h"
 #include "asset_cache.h"
+#include "profiler.h"
 #include <SDL2/SDL.h>
 
-#include <SDL2/SDL2_gfxPrimitives.h>
 #include <assert.h>
 #include <math.h>
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
 #include <SDL2/SDL_mixer.h>
 
+#define ALLOC_TAG ALLOC_RENDER
+#include "alloc.h"
+
 const char WINDOW_TITLE[] = "CS 3";
 const int WINDOW_WIDTH = 1000;
 const int WINDOW_HEIGHT = 500;
 const double MS_PER_S = 1e3;
+const size_t BATCH_INITIAL_VERTICES = 256;
+const size_t VERTICES_PER_QUAD = 4;
+const size_t INDICES_PER_QUAD = 6;
+// The largest atlas page, on each side, if the renderer allows it
+const int ATLAS_PAGE_SIZE = 4096;
+// FNV-1a parameters for sdl_frame_checksum()
+const uint32_t FNV_OFFSET_BASIS = 2166136261u;
+const uint32_t FNV_PRIME = 16777619u;
+// Transparent pixels between atlas sprites, so filtering doesn't bleed
+const int ATLAS_PADDING = 2;
+// Marks a sound bank voice that hasn't played a sound from the bank
+const size_t BANK_NO_SOUND = SIZE_MAX;
+#define TEXT_CACHE_SIZE 32
+#define GLYPH_ATLAS_FONTS 4
+// Glyph atlases cover the printable ASCII characters
+#define FIRST_GLYPH ' '
+#define LAST_GLYPH '~'
+#define NUM_GLYPHS (LAST_GLYPH - FIRST_GLYPH + 1)
 
 /**
  * The coordinate at the center of the screen.
@@ -30,6 +51,17 @@ SDL_Window *window;
  * The renderer used to draw the scene.
  */
 SDL_Renderer *renderer;
+/**
+ * The surface drawn into instead of a window by sdl_init_headless(),
+ * or NULL when drawing to a window.
+ */
+SDL_Surface *headless_surface = NULL;
+/**
+ * The performance counter when the current frame was started by sdl_clear(),
+ * and how long the last frame took from then until sdl_show() returned.
+ */
+uint64_t frame_start = 0;
+double last_frame_time = 0;
 /**
  * The keypress handler, or NULL if none has been configured.
  */
@@ -40,23 +72,129 @@ key_handler_t key_handler = NULL;
  */
 uint32_t key_start_timestamp;
 /**
- * The value of clock() when time_since_last_tick() was last called.
- * Initially 0.
+ * Times the calls to time_since_last_tick().
+ * Created by sdl_init() or sdl_init_headless() and freed by sdl_quit().
+ */
+frame_timer_t *tick_timer = NULL;
+/**
+ * The refresh rate of the window's display, or 0 if unknown.
+ */
+double display_refresh_rate = 0;
+
+/**
+ * Triangles queued for drawing that all share one texture,
+ * or no texture for filled polygons.
+ */
+typedef struct sprite_batch {
+  SDL_Texture *texture;
+  SDL_Vertex *vertices;
+  int *indices;
+  size_t num_vertices;
+  size_t num_indices;
+  size_t vertex_capacity;
+  size_t index_capacity;
+} sprite_batch_t;
+
+/**
+ * The sprite batch for the current frame.
  */
-clock_t last_clock = 0;
+sprite_batch_t batch = {0};
 
-/** Computes the center of the window in pixel coordinates */
-vector_t get_window_center(void) {
-  int *width = malloc(sizeof(*width)), *height = malloc(sizeof(*height));
-  assert(width != NULL);
-  assert(height != NULL);
-  SDL_GetWindowSize(window, width, height);
-  vector_t dimensions = {.x = *width, .y = *height};
-  free(width);
-  free(height);
-  return vec_multiply(0.5, dimensions);
+/**
+ * Starts or continues a run of triangles with the given texture,
+ * flushing the batch if it holds triangles with a different one.
+ */
+static void batch_use_texture(SDL_Texture *texture) {
+  if (texture != batch.texture) {
+    sdl_batch_flush();
+    batch.texture = texture;
+  }
 }
 
+/**
+ * Makes room in the batch for more vertices and indices.
+ */
+static void batch_reserve(size_t num_vertices, size_t num_indices) {
+  size_t vertex_capacity = batch.vertex_capacity;
+  if (vertex_capacity == 0) {
+    vertex_capacity = BATCH_INITIAL_VERTICES;
+  }
+  while (batch.num_vertices + num_vertices > vertex_capacity) {
+    vertex_capacity *= 2;
+  }
+  if (vertex_capacity != batch.vertex_capacity) {
+    batch.vertices =
+        realloc(batch.vertices, vertex_capacity * sizeof(SDL_Vertex));
+    assert(batch.vertices != NULL);
+    batch.vertex_capacity = vertex_capacity;
+  }
+
+  size_t index_capacity = batch.index_capacity;
+  if (index_capacity == 0) {
+    index_capacity = BATCH_INITIAL_VERTICES;
+  }
+  while (batch.num_indices + num_indices > index_capacity) {
+    index_capacity *= 2;
+  }
+  if (index_capacity != batch.index_capacity) {
+    batch.indices = realloc(batch.indices, index_capacity * sizeof(int));
+    assert(batch.indices != NULL);
+    batch.index_capacity = index_capacity;
+  }
+}
+
+/**
+ * A string rendered with a font and color, kept on the GPU between frames.
+ */
+typedef struct text_cache_entry {
+  TTF_Font *font;
+  char *text;
+  SDL_Color color;
+  SDL_Texture *texture;
+  int width;
+  int height;
+  uint64_t last_used;
+} text_cache_entry_t;
+
+/**
+ * Recently rendered strings. When full, the least recently used is replaced.
+ */
+text_cache_entry_t text_cache[TEXT_CACHE_SIZE] = {0};
+/**
+ * Incremented every time a cached string is drawn, to order the entries.
+ */
+uint64_t text_cache_clock = 0;
+
+/**
+ * The printable ASCII characters of a font, rendered in white into one texture.
+ */
+typedef struct glyph_atlas {
+  TTF_Font *font;
+  SDL_Texture *texture;
+  SDL_Rect glyphs[NUM_GLYPHS];
+  int advances[NUM_GLYPHS];
+} glyph_atlas_t;
+
+/**
+ * Glyph atlases for the fonts drawn with sdl_render_glyphs().
+ */
+glyph_atlas_t glyph_atlases[GLYPH_ATLAS_FONTS] = {0};
+
+/**
+ * The mapping from scene coordinates to pixel coordinates.
+ * Only changes when the window is resized, so it is cached rather than
+ * queried from SDL for every polygon and bounding box.
+ */
+typedef struct viewport {
+  vector_t window_center;
+  double scale;
+} viewport_t;
+
+/**
+ * The viewport of the window, updated by viewport_update().
+ */
+viewport_t viewport = {0};
+
 /**
  * Computes the scaling factor between scene coordinates and pixel coordinates.
  * The scene is scaled by the same factor in the x and y dimensions,
@@ -69,11 +207,30 @@ double get_scene_scale(vector_t window_center) {
   return x_scale < y_scale ? x_scale : y_scale;
 }
 
+/**
+ * Recomputes the viewport from the window's current size.
+ * Called on startup and whenever the window is resized.
+ */
+static void viewport_update(void) {
+  int width, height;
+  if (window != NULL) {
+    SDL_GetWindowSize(window, &width, &height);
+  } else {
+    SDL_GetRendererOutputSize(renderer, &width, &height);
+  }
+  vector_t dimensions = {.x = width, .y = height};
+  viewport.window_center = vec_multiply(0.5, dimensions);
+  viewport.scale = get_scene_scale(viewport.window_center);
+}
+
+/** Gets the center of the window in pixel coordinates */
+vector_t get_window_center(void) { return viewport.window_center; }
+
 /** Maps a scene coordinate to a window coordinate */
 vector_t get_window_position(vector_t scene_pos, vector_t window_center, double vertical_offset) {
   // Scale scene coordinates by the scaling factor
   // and map the center of the scene to the center of the window
-  double scale = get_scene_scale(window_center);
+  double scale = viewport.scale;
   vector_t scene_center_offset = vec_subtract(scene_pos, center);
   scene_center_offset.y -= vertical_offset;
   vector_t pixel_center_offset = vec_multiply(scale, scene_center_offset);
@@ -83,6 +240,34 @@ vector_t get_window_position(vector_t scene_pos, vector_t window_center, double
   return pixel;
 }
 
+/**
+ * Converts a list of scene points to window coordinates and appends them to
+ * the batch as untextured vertices of the given color.
+ *
+ * @param points the points, in scene coordinates
+ * @param vertical_offset the vertical offset of the camera
+ * @param color the color of the vertices
+ */
+static void batch_push_points(vertex_list_t *points, double vertical_offset,
+                              SDL_Color color) {
+  size_t n = vertex_list_size(points);
+  vector_t *point = vertex_list_data(points);
+  SDL_Vertex *vertex = &batch.vertices[batch.num_vertices];
+
+  // Expand the affine transform once, instead of per vertex
+  double scale = viewport.scale;
+  double offset_x = viewport.window_center.x - scale * center.x;
+  double offset_y = viewport.window_center.y + scale * (center.y + vertical_offset);
+  for (size_t i = 0; i < n; i++) {
+    vertex[i].position.x = offset_x + scale * point[i].x;
+    vertex[i].position.y = offset_y - scale * point[i].y;
+    vertex[i].color = color;
+    vertex[i].tex_coord.x = 0;
+    vertex[i].tex_coord.y = 0;
+  }
+  batch.num_vertices += n;
+}
+
 /**
  * Converts an SDL key code to a char.
  * 7-bit ASCII characters are just returned
@@ -118,6 +303,12 @@ void sdl_init(vector_t min, vector_t max) {
                             SDL_WINDOWPOS_CENTERED, WINDOW_WIDTH, WINDOW_HEIGHT,
                             SDL_WINDOW_RESIZABLE | SDL_WINDOW_BORDERLESS);
   renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC);
+  SDL_DisplayMode mode;
+  if (SDL_GetCurrentDisplayMode(0, &mode) == 0) {
+    display_refresh_rate = mode.refresh_rate;
+  }
+  tick_timer = frame_timer_init(display_refresh_rate);
+  viewport_update();
   TTF_Init();
   if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
     printf("SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError());
@@ -126,47 +317,108 @@ void sdl_init(vector_t min, vector_t max) {
   Mix_Volume(-1, MIX_MAX_VOLUME); 
 }
 
+void sdl_init_headless(vector_t min, vector_t max, int width, int height) {
+  // Check parameters
+  assert(min.x < max.x);
+  assert(min.y < max.y);
+  assert(width > 0 && height > 0);
+
+  center = vec_multiply(0.5, vec_add(min, max));
+  max_diff = vec_subtract(max, center);
+  // Sounds are mixed as usual but never reach a device
+  SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+  SDL_Init(SDL_INIT_TIMER | SDL_INIT_AUDIO | SDL_INIT_EVENTS);
+  window = NULL;
+  headless_surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32,
+                                                    SDL_PIXELFORMAT_RGBA32);
+  assert(headless_surface != NULL);
+  renderer = SDL_CreateSoftwareRenderer(headless_surface);
+  assert(renderer != NULL);
+  // There is no display, so missed vsyncs aren't counted
+  tick_timer = frame_timer_init(0);
+  viewport_update();
+  TTF_Init();
+  if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
+    printf("SDL_mixer could not initialize! SDL_mixer Error: %s\n", Mix_GetError());
+    exit(1);
+  }
+}
+
+uint32_t sdl_frame_checksum(void) {
+  assert(headless_surface != NULL);
+  sdl_batch_flush();
+  SDL_RenderFlush(renderer);
+
+  SDL_LockSurface(headless_surface);
+  uint32_t hash = FNV_OFFSET_BASIS;
+  size_t row_bytes = headless_surface->w * sizeof(uint32_t);
+  for (int y = 0; y < headless_surface->h; y++) {
+    const uint8_t *row =
+        (const uint8_t *)headless_surface->pixels + y * headless_surface->pitch;
+    for (size_t i = 0; i < row_bytes; i++) {
+      hash = (hash ^ row[i]) * FNV_PRIME;
+    }
+  }
+  SDL_UnlockSurface(headless_surface);
+  return hash;
+}
+
+bool sdl_save_frame(const char *path) {
+  assert(headless_surface != NULL);
+  sdl_batch_flush();
+  SDL_RenderFlush(renderer);
+  return SDL_SaveBMP(headless_surface, path) == 0;
+}
+
+double sdl_get_frame_time(void) { return last_frame_time; }
+
 bool sdl_is_done(void *state) {
-  SDL_Event *event = malloc(sizeof(*event));
-  assert(event != NULL);
-  while (SDL_PollEvent(event)) {
-    switch (event->type) {
+  SDL_Event event;
+  while (SDL_PollEvent(&event)) {
+    switch (event.type) {
     case SDL_QUIT:
-      free(event);
       return true;
+    case SDL_WINDOWEVENT:
+      if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+        viewport_update();
+      }
+      break;
     case SDL_KEYDOWN:
     case SDL_KEYUP:
       // Skip the keypress if no handler is configured
       // or an unrecognized key was pressed
       if (key_handler == NULL)
         break;
-      char key = get_keycode(event->key.keysym.sym);
+      char key = get_keycode(event.key.keysym.sym);
       if (key == '\0')
         break;
 
-      uint32_t timestamp = event->key.timestamp;
-      if (!event->key.repeat) {
+      uint32_t timestamp = event.key.timestamp;
+      if (!event.key.repeat) {
         key_start_timestamp = timestamp;
       }
       key_event_type_t type =
-          event->type == SDL_KEYDOWN ? KEY_PRESSED : KEY_RELEASED;
+          event.type == SDL_KEYDOWN ? KEY_PRESSED : KEY_RELEASED;
       double held_time = (timestamp - key_start_timestamp) / MS_PER_S;
       key_handler(key, type, held_time, state);
       break;
 
     case SDL_MOUSEBUTTONDOWN: {
-      asset_cache_handle_buttons(state, event->button.x, event->button.y);
+      asset_cache_handle_buttons(state, event.button.x, event.button.y);
       break;
     }
     }
   }
-  free(event);
   return false;
 }
 
 void sdl_clear(void) {
+  PROFILE_BEGIN("sdl_clear");
+  frame_start = SDL_GetPerformanceCounter();
+  sdl_batch_flush();
   SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
   SDL_RenderClear(renderer);
+  PROFILE_END("sdl_clear");
 }
 
 Mix_Chunk *sdl_load_sound(const char *file){
@@ -181,32 +433,202 @@ void sdl_play_sound(Mix_Chunk *sound){
   Mix_PlayChannel(-1, sound, 0);
 }
 
+typedef struct bank_sound {
+  Mix_Chunk *chunk;
+  size_t max_instances;
+  int priority;
+  // Whether it has been requested since the last update
+  bool requested;
+} bank_sound_t;
+
+typedef struct voice {
+  // The id of the sound it last played, or BANK_NO_SOUND
+  size_t sound;
+  // The update it started playing in
+  uint64_t started;
+} voice_t;
+
+struct sound_bank {
+  bank_sound_t *sounds;
+  size_t num_sounds;
+  voice_t *voices;
+  int first_channel;
+  size_t num_voices;
+  // The ids requested since the last update; each at most once
+  size_t *requests;
+  size_t num_requests;
+  uint64_t updates;
+};
+
+sound_bank_t *sdl_sound_bank_init(size_t num_sounds, int first_channel,
+                                  size_t num_voices) {
+  assert(first_channel >= 0);
+  assert(num_voices > 0);
+  sound_bank_t *bank = malloc(sizeof(sound_bank_t));
+  assert(bank);
+  bank->sounds = calloc(num_sounds, sizeof(bank_sound_t));
+  bank->voices = malloc(num_voices * sizeof(voice_t));
+  bank->requests = malloc(num_sounds * sizeof(size_t));
+  assert(bank->sounds && bank->voices && bank->requests);
+  for (size_t i = 0; i < num_sounds; i++) {
+    bank->sounds[i].max_instances = 1;
+  }
+  for (size_t i = 0; i < num_voices; i++) {
+    bank->voices[i] = (voice_t){.sound = BANK_NO_SOUND, .started = 0};
+  }
+  bank->num_sounds = num_sounds;
+  bank->first_channel = first_channel;
+  bank->num_voices = num_voices;
+  bank->num_requests = 0;
+  bank->updates = 0;
+
+  int channels = first_channel + (int)num_voices;
+  if (Mix_AllocateChannels(-1) < channels) {
+    Mix_AllocateChannels(channels);
+  }
+  return bank;
+}
+
+void sdl_sound_bank_free(sound_bank_t *bank) {
+  for (size_t i = 0; i < bank->num_voices; i++) {
+    Mix_HaltChannel(bank->first_channel + i);
+  }
+  free(bank->sounds);
+  free(bank->voices);
+  free(bank->requests);
+  free(bank);
+}
+
+void sdl_sound_bank_define(sound_bank_t *bank, size_t id, Mix_Chunk *sound,
+                           size_t max_instances, int priority) {
+  assert(id < bank->num_sounds);
+  assert(max_instances > 0);
+  bank->sounds[id].chunk = sound;
+  bank->sounds[id].max_instances = max_instances;
+  bank->sounds[id].priority = priority;
+}
+
+void sdl_sound_bank_set(sound_bank_t *bank, size_t id, Mix_Chunk *sound) {
+  assert(id < bank->num_sounds);
+  bank->sounds[id].chunk = sound;
+}
+
+void sdl_sound_bank_play(sound_bank_t *bank, size_t id) {
+  assert(id < bank->num_sounds);
+  bank_sound_t *sound = &bank->sounds[id];
+  if (!sound->requested) {
+    sound->requested = true;
+    bank->requests[bank->num_requests++] = id;
+  }
+}
+
+/**
+ * Picks the voice to play a sound on: its oldest instance if it is at its
+ * limit, else a free voice, else the oldest voice with the lowest priority,
+ * if that isn't higher than the sound's.
+ *
+ * @return the index of the voice, or num_voices if the sound can't be played
+ */
+static size_t sound_bank_pick_voice(sound_bank_t *bank, size_t id) {
+  size_t none = bank->num_voices;
+  size_t instances = 0, oldest_instance = none;
+  size_t free_voice = none, victim = none;
+  for (size_t i = 0; i < bank->num_voices; i++) {
+    voice_t *voice = &bank->voices[i];
+    if (!Mix_Playing(bank->first_channel + i)) {
+      if (free_voice == none) {
+        free_voice = i;
+      }
+      continue;
+    }
+    if (voice->sound == BANK_NO_SOUND) {
+      continue;
+    }
+    if (voice->sound == id) {
+      instances++;
+      if (oldest_instance == none ||
+          voice->started < bank->voices[oldest_instance].started) {
+        oldest_instance = i;
+      }
+    }
+    if (victim == none) {
+      victim = i;
+      continue;
+    }
+    int priority = bank->sounds[voice->sound].priority;
+    int victim_priority = bank->sounds[bank->voices[victim].sound].priority;
+    if (priority < victim_priority ||
+        (priority == victim_priority &&
+         voice->started < bank->voices[victim].started)) {
+      victim = i;
+    }
+  }
+
+  if (instances >= bank->sounds[id].max_instances) {
+    return oldest_instance;
+  }
+  if (free_voice != none) {
+    return free_voice;
+  }
+  if (victim != none && bank->sounds[bank->voices[victim].sound].priority <=
+                            bank->sounds[id].priority) {
+    return victim;
+  }
+  return none;
+}
+
+void sdl_sound_bank_update(sound_bank_t *bank) {
+  // Sorts the requests by priority, highest first; there are only a few
+  size_t *requests = bank->requests;
+  for (size_t i = 1; i < bank->num_requests; i++) {
+    size_t id = requests[i];
+    size_t j = i;
+    for (; j > 0 && bank->sounds[requests[j - 1]].priority <
+                        bank->sounds[id].priority;
+         j--) {
+      requests[j] = requests[j - 1];
+    }
+    requests[j] = id;
+  }
+
+  for (size_t i = 0; i < bank->num_requests; i++) {
+    size_t id = requests[i];
+    bank_sound_t *sound = &bank->sounds[id];
+    sound->requested = false;
+    if (sound->chunk == NULL) {
+      continue;
+    }
+    size_t index = sound_bank_pick_voice(bank, id);
+    if (index == bank->num_voices) {
+      continue;
+    }
+    // Playing on a busy channel halts what it was playing
+    if (Mix_PlayChannel(bank->first_channel + index, sound->chunk, 0) >= 0) {
+      bank->voices[index] = (voice_t){.sound = id, .started = bank->updates};
+    }
+  }
+  bank->num_requests = 0;
+  bank->updates++;
+}
+
 
 void sdl_draw_polygon(polygon_t *poly, rgb_color_t color, double vector_offset) {
-  list_t *points = polygon_get_points(poly);
+  vertex_list_t *points = polygon_get_points(poly);
   // Check parameters
-  size_t n = list_size(points);
+  size_t n = vertex_list_size(points);
   assert(n >= 3);
+  size_t num_indices;
+  const int *triangles = polygon_get_triangles(poly, &num_indices);
 
-  vector_t window_center = get_window_center();
-
-  // Convert each vertex to a point on screen
-  int16_t *x_points = malloc(sizeof(*x_points) * n),
-          *y_points = malloc(sizeof(*y_points) * n);
-  assert(x_points != NULL);
-  assert(y_points != NULL);
-  for (size_t i = 0; i < n; i++) {
-    vector_t *vertex = list_get(points, i);
-    vector_t pixel = get_window_position(*vertex, window_center, vector_offset);
-    x_points[i] = pixel.x;
-    y_points[i] = pixel.y;
+  // Queue the cached triangles, offset to this polygon's first vertex
+  batch_use_texture(NULL);
+  batch_reserve(n, num_indices);
+  int first = batch.num_vertices;
+  SDL_Color sdl_color = {color.r * 255, color.g * 255, color.b * 255, 255};
+  batch_push_points(points, vector_offset, sdl_color);
+  for (size_t i = 0; i < num_indices; i++) {
+    batch.indices[batch.num_indices++] = first + triangles[i];
   }
-
-  // Draw polygon with the given color
-  filledPolygonRGBA(renderer, x_points, y_points, n, color.r * 255,
-                    color.g * 255, color.b * 255, 255);
-  free(x_points);
-  free(y_points);
 }
 
 SDL_Texture *sdl_load_image(const char *image_path) {
@@ -214,35 +636,386 @@ SDL_Texture *sdl_load_image(const char *image_path) {
   return image;
 }
 
+SDL_Texture *sdl_create_texture(SDL_Surface *surface) {
+  return SDL_CreateTextureFromSurface(renderer, surface);
+}
+
+/**
+ * An image being packed into an atlas.
+ */
+typedef struct atlas_entry {
+  size_t index;
+  SDL_Surface *surface;
+  size_t page;
+  SDL_Rect rect;
+} atlas_entry_t;
+
+/**
+ * Gets the largest texture the renderer can create, capped at
+ * ATLAS_PAGE_SIZE on each side.
+ */
+static void sdl_max_texture_size(int *width, int *height) {
+  *width = ATLAS_PAGE_SIZE;
+  *height = ATLAS_PAGE_SIZE;
+  SDL_RendererInfo info;
+  if (SDL_GetRendererInfo(renderer, &info) != 0) {
+    return;
+  }
+  // A renderer reports 0 if it has no limit
+  if (info.max_texture_width > 0 && info.max_texture_width < *width) {
+    *width = info.max_texture_width;
+  }
+  if (info.max_texture_height > 0 && info.max_texture_height < *height) {
+    *height = info.max_texture_height;
+  }
+}
+
+/** Orders atlas entries by decreasing height, for shelf packing */
+static int atlas_entry_compare(const void *a, const void *b) {
+  const atlas_entry_t *entry_a = a, *entry_b = b;
+  return entry_b->rect.h - entry_a->rect.h;
+}
+
+size_t sdl_load_atlas(SDL_Surface **images, size_t num_images,
+                      sprite_t *sprites, SDL_Texture **pages) {
+  atlas_entry_t *entries = malloc(num_images * sizeof(atlas_entry_t));
+  int *page_heights = malloc(num_images * sizeof(int));
+  assert(entries != NULL);
+  assert(page_heights != NULL);
+
+  size_t num_entries = 0;
+  for (size_t i = 0; i < num_images; i++) {
+    sprites[i].texture = NULL;
+    SDL_Surface *surface = images[i];
+    if (surface == NULL) {
+      continue;
+    }
+    atlas_entry_t *entry = &entries[num_entries++];
+    entry->index = i;
+    entry->surface = surface;
+    entry->rect = (SDL_Rect){0, 0, surface->w, surface->h};
+  }
+  qsort(entries, num_entries, sizeof(atlas_entry_t), atlas_entry_compare);
+
+  // Place the images on shelves, opening a new page when one fills up
+  int max_width, max_height;
+  sdl_max_texture_size(&max_width, &max_height);
+  size_t num_pages = 0;
+  int x = 0, y = 0, shelf_height = 0;
+  for (size_t i = 0; i < num_entries; i++) {
+    SDL_Rect *rect = &entries[i].rect;
+    int w = rect->w + ATLAS_PADDING, h = rect->h + ATLAS_PADDING;
+    if (num_pages > 0 && x + w > max_width) {
+      x = 0;
+      y += shelf_height;
+      shelf_height = 0;
+    }
+    if (num_pages == 0 || y + h > max_height) {
+      page_heights[num_pages++] = 0;
+      x = y = shelf_height = 0;
+    }
+    rect->x = x;
+    rect->y = y;
+    entries[i].page = num_pages - 1;
+    if (y + rect->h > page_heights[num_pages - 1]) {
+      page_heights[num_pages - 1] = y + rect->h;
+    }
+    x += w;
+    shelf_height = shelf_height > h ? shelf_height : h;
+  }
+
+  // Copy the images into one surface per page and upload the pages
+  size_t num_textures = 0;
+  for (size_t page = 0; page < num_pages; page++) {
+    int page_width = 0;
+    for (size_t i = 0; i < num_entries; i++) {
+      SDL_Rect rect = entries[i].rect;
+      if (entries[i].page == page && rect.x + rect.w > page_width) {
+        page_width = rect.x + rect.w;
+      }
+    }
+
+    SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(
+        0, page_width, page_heights[page], 32, SDL_PIXELFORMAT_RGBA32);
+    assert(atlas != NULL);
+    SDL_FillRect(atlas, NULL, 0);
+    for (size_t i = 0; i < num_entries; i++) {
+      if (entries[i].page == page) {
+        SDL_SetSurfaceBlendMode(entries[i].surface, SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(entries[i].surface, NULL, atlas, &entries[i].rect);
+      }
+    }
+    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, atlas);
+    SDL_FreeSurface(atlas);
+
+    for (size_t i = 0; i < num_entries; i++) {
+      if (entries[i].page != page) {
+        continue;
+      }
+      sprite_t *sprite = &sprites[entries[i].index];
+      if (texture != NULL) {
+        sprite->texture = texture;
+        sprite->src = entries[i].rect;
+      } else {
+        // The page was too big for the renderer, e.g. an image bigger than
+        // the largest page, so give each of its images its own texture
+        sprite->texture = sdl_create_texture(entries[i].surface);
+        sprite->src = (SDL_Rect){0, 0, entries[i].rect.w, entries[i].rect.h};
+        if (sprite->texture != NULL) {
+          pages[num_textures++] = sprite->texture;
+        }
+      }
+    }
+    if (texture != NULL) {
+      SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+      pages[num_textures++] = texture;
+    }
+  }
+
+  free(entries);
+  free(page_heights);
+  return num_textures;
+}
+
 void sdl_render_image(SDL_Texture *image_texture, vector_t position,
                       vector_t image_size) {
-  // Allocate memory for the SDL_Rect structure
-  SDL_Rect *img_rect = malloc(sizeof(SDL_Rect));
+  SDL_Rect img_rect = {.x = position.x, .y = position.y,
+                       .w = image_size.x, .h = image_size.y};
+  sdl_batch_draw(image_texture, NULL, img_rect);
+}
 
-  // Set the coordinates and dimensions
-  img_rect->x = position.x;
-  img_rect->y = position.y;
-  img_rect->w = image_size.x;
-  img_rect->h = image_size.y;
+void sdl_batch_flush(void) {
+  if (batch.num_indices == 0) {
+    return;
+  }
+  SDL_RenderGeometry(renderer, batch.texture, batch.vertices,
+                     batch.num_vertices, batch.indices, batch.num_indices);
+  batch.num_vertices = 0;
+  batch.num_indices = 0;
+}
+
+/**
+ * Queues a textured quad whose texture is modulated by the given color.
+ */
+static void batch_push_quad(SDL_Texture *texture, const SDL_Rect *src,
+                            SDL_Rect dest, SDL_Color color) {
+  if (texture == NULL) {
+    return;
+  }
+  // A new texture ends the current run of quads
+  batch_use_texture(texture);
+  batch_reserve(VERTICES_PER_QUAD, INDICES_PER_QUAD);
+
+  // Texture coordinates of the source rectangle, normalized to [0, 1]
+  float u0 = 0, v0 = 0, u1 = 1, v1 = 1;
+  if (src != NULL) {
+    int tex_w, tex_h;
+    SDL_QueryTexture(texture, NULL, NULL, &tex_w, &tex_h);
+    u0 = (float)src->x / tex_w;
+    v0 = (float)src->y / tex_h;
+    u1 = (float)(src->x + src->w) / tex_w;
+    v1 = (float)(src->y + src->h) / tex_h;
+  }
+
+  float x0 = dest.x, y0 = dest.y;
+  float x1 = dest.x + dest.w, y1 = dest.y + dest.h;
+  size_t first = batch.num_vertices;
+  SDL_Vertex *vertex = &batch.vertices[first];
+  vertex[0] = (SDL_Vertex){{x0, y0}, color, {u0, v0}};
+  vertex[1] = (SDL_Vertex){{x1, y0}, color, {u1, v0}};
+  vertex[2] = (SDL_Vertex){{x1, y1}, color, {u1, v1}};
+  vertex[3] = (SDL_Vertex){{x0, y1}, color, {u0, v1}};
+
+  int *index = &batch.indices[batch.num_indices];
+  index[0] = first;
+  index[1] = first + 1;
+  index[2] = first + 2;
+  index[3] = first;
+  index[4] = first + 2;
+  index[5] = first + 3;
+  batch.num_vertices += VERTICES_PER_QUAD;
+  batch.num_indices += INDICES_PER_QUAD;
+}
+
+void sdl_batch_draw(SDL_Texture *texture, const SDL_Rect *src,
+                    SDL_Rect dest) {
+  SDL_Color white = {255, 255, 255, 255};
+  batch_push_quad(texture, src, dest, white);
+}
+
+/**
+ * Finds the cache entry for a string, rasterizing it into the least recently
+ * used entry if it isn't cached.
+ *
+ * @return the entry, or NULL if the string could not be rendered
+ */
+static text_cache_entry_t *text_cache_get(TTF_Font *font, const char *text,
+                                          SDL_Color color) {
+  text_cache_entry_t *oldest = &text_cache[0];
+  for (size_t i = 0; i < TEXT_CACHE_SIZE; i++) {
+    text_cache_entry_t *entry = &text_cache[i];
+    if (entry->font == font && entry->text != NULL &&
+        entry->color.r == color.r && entry->color.g == color.g &&
+        entry->color.b == color.b && entry->color.a == color.a &&
+        strcmp(entry->text, text) == 0) {
+      entry->last_used = ++text_cache_clock;
+      return entry;
+    }
+    if (entry->last_used < oldest->last_used) {
+      oldest = entry;
+    }
+  }
 
-  // Render the image texture
-  SDL_RenderCopy(renderer, image_texture, NULL, img_rect);
+  SDL_Surface *surface = TTF_RenderText_Blended(font, text, color);
+  if (surface == NULL) {
+    return NULL;
+  }
+  if (oldest->texture != NULL) {
+    if (batch.texture == oldest->texture) {
+      sdl_batch_flush();
+    }
+    SDL_DestroyTexture(oldest->texture);
+  }
+  free(oldest->text);
 
-  // Free the allocated memory
-  free(img_rect);
+  size_t length = strlen(text);
+  oldest->text = malloc(length + 1);
+  assert(oldest->text != NULL);
+  memcpy(oldest->text, text, length + 1);
+  oldest->font = font;
+  oldest->color = color;
+  oldest->texture = SDL_CreateTextureFromSurface(renderer, surface);
+  oldest->width = surface->w;
+  oldest->height = surface->h;
+  oldest->last_used = ++text_cache_clock;
+  SDL_FreeSurface(surface);
+  return oldest;
 }
 
 void sdl_render_font(TTF_Font *font, const char *text, vector_t position,
                      SDL_Color color, int8_t font_size) {
-  SDL_Surface *surface = TTF_RenderText_Blended(font, text, color);
-  SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
+  text_cache_entry_t *entry = text_cache_get(font, text, color);
+  if (entry == NULL) {
+    return;
+  }
+  SDL_Rect destination = {(int)position.x, (int)position.y, entry->width,
+                          entry->height};
+  sdl_batch_draw(entry->texture, NULL, destination);
+}
 
-  SDL_Rect destination = {(int)position.x, (int)position.y, surface->w,
-                          surface->h};
+/**
+ * Finds the glyph atlas of a font, building it the first time the font is
+ * drawn. When every atlas is taken, the last one is rebuilt for this font.
+ */
+static glyph_atlas_t *glyph_atlas_get(TTF_Font *font) {
+  size_t slot = GLYPH_ATLAS_FONTS - 1;
+  for (size_t i = 0; i < GLYPH_ATLAS_FONTS; i++) {
+    if (glyph_atlases[i].font == font) {
+      return &glyph_atlases[i];
+    }
+    if (glyph_atlases[i].font == NULL) {
+      slot = i;
+      break;
+    }
+  }
+
+  glyph_atlas_t *atlas = &glyph_atlases[slot];
+  if (atlas->texture != NULL) {
+    if (batch.texture == atlas->texture) {
+      sdl_batch_flush();
+    }
+    SDL_DestroyTexture(atlas->texture);
+  }
+  atlas->font = font;
+
+  // Lay the glyphs out in rows, starting a new row when one would be wider
+  // than the renderer's largest texture
+  int max_width, max_height;
+  sdl_max_texture_size(&max_width, &max_height);
+  SDL_Color white = {255, 255, 255, 255};
+  SDL_Surface *glyph_surfaces[NUM_GLYPHS];
+  int x = 0, y = 0, row_height = TTF_FontHeight(font), width = 0;
+  for (size_t i = 0; i < NUM_GLYPHS; i++) {
+    Uint16 ch = FIRST_GLYPH + i;
+    int advance = 0;
+    TTF_GlyphMetrics(font, ch, NULL, NULL, NULL, NULL, &advance);
+    glyph_surfaces[i] = TTF_RenderGlyph_Blended(font, ch, white);
+    atlas->advances[i] = advance;
+    atlas->glyphs[i] = (SDL_Rect){0, 0, 0, 0};
+    if (glyph_surfaces[i] == NULL) {
+      continue;
+    }
+    int w = glyph_surfaces[i]->w, h = glyph_surfaces[i]->h;
+    if (x > 0 && x + w > max_width) {
+      x = 0;
+      y += row_height + ATLAS_PADDING;
+      row_height = TTF_FontHeight(font);
+    }
+    atlas->glyphs[i] = (SDL_Rect){x, y, w, h};
+    x += w + ATLAS_PADDING;
+    width = width > x ? width : x;
+    row_height = row_height > h ? row_height : h;
+  }
+  int height = y + row_height;
 
-  SDL_RenderCopy(renderer, texture, NULL, &destination);
+  SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(
+      0, width > 0 ? width : 1, height, 32, SDL_PIXELFORMAT_RGBA32);
+  assert(surface != NULL);
+  SDL_FillRect(surface, NULL, 0);
+  for (size_t i = 0; i < NUM_GLYPHS; i++) {
+    if (glyph_surfaces[i] != NULL) {
+      SDL_SetSurfaceBlendMode(glyph_surfaces[i], SDL_BLENDMODE_NONE);
+      SDL_BlitSurface(glyph_surfaces[i], NULL, surface, &atlas->glyphs[i]);
+      SDL_FreeSurface(glyph_surfaces[i]);
+    }
+  }
+  // Without a texture, sdl_render_glyphs() falls back to sdl_render_font()
+  atlas->texture = SDL_CreateTextureFromSurface(renderer, surface);
+  if (atlas->texture != NULL) {
+    SDL_SetTextureBlendMode(atlas->texture, SDL_BLENDMODE_BLEND);
+  }
   SDL_FreeSurface(surface);
-  SDL_DestroyTexture(texture);
+  return atlas;
+}
+
+void sdl_render_glyphs(TTF_Font *font, const char *text, vector_t position,
+                       SDL_Color color) {
+  glyph_atlas_t *atlas = glyph_atlas_get(font);
+  if (atlas->texture == NULL) {
+    // The font was opened at its size, so sdl_render_font() ignores it
+    sdl_render_font(font, text, position, color, 0);
+    return;
+  }
+  int x = (int)position.x, y = (int)position.y;
+  for (const char *c = text; *c != '\0'; c++) {
+    if (*c < FIRST_GLYPH || *c > LAST_GLYPH) {
+      continue;
+    }
+    size_t i = *c - FIRST_GLYPH;
+    SDL_Rect glyph = atlas->glyphs[i];
+    if (glyph.w > 0) {
+      SDL_Rect destination = {x, y, glyph.w, glyph.h};
+      batch_push_quad(atlas->texture, &glyph, destination, color);
+    }
+    x += atlas->advances[i];
+  }
+}
+
+void sdl_clear_text_cache(void) {
+  sdl_batch_flush();
+  for (size_t i = 0; i < TEXT_CACHE_SIZE; i++) {
+    if (text_cache[i].texture != NULL) {
+      SDL_DestroyTexture(text_cache[i].texture);
+    }
+    free(text_cache[i].text);
+    text_cache[i] = (text_cache_entry_t){0};
+  }
+  for (size_t i = 0; i < GLYPH_ATLAS_FONTS; i++) {
+    if (glyph_atlases[i].texture != NULL) {
+      SDL_DestroyTexture(glyph_atlases[i].texture);
+    }
+    glyph_atlases[i] = (glyph_atlas_t){0};
+  }
 }
 
 TTF_Font *sdl_load_font(const char *font_path, int8_t font_size) {
@@ -251,27 +1024,24 @@ TTF_Font *sdl_load_font(const char *font_path, int8_t font_size) {
 }
 
 void sdl_show(double vector_offset) {
+  PROFILE_BEGIN("sdl_show");
+  sdl_batch_flush();
+  PROFILE_BEGIN("present");
   SDL_RenderPresent(renderer);
+  PROFILE_END("present");
+  last_frame_time = (double)(SDL_GetPerformanceCounter() - frame_start) /
+                    SDL_GetPerformanceFrequency();
+  alloc_end_frame();
+  PROFILE_END("sdl_show");
 }
 
 void sdl_render_scene(scene_t *scene, void *aux, double vertical_offset) {
   sdl_clear();
   size_t body_count = scene_bodies(scene);
-  vector_t window_center = get_window_center();
 
   for (size_t i = 0; i < body_count; i++) {
     body_t *body = scene_get_body(scene, i);
-    list_t *shape = body_get_shape(body);
-
-    for (size_t j = 0; j < list_size(shape); j++) {
-      vector_t *point = list_get(shape, j);
-      vector_t window_point = get_window_position(*point, window_center, vertical_offset);
-      vector_t *new_point = malloc(sizeof(*new_point));
-      *new_point = window_point;
-    }
-
     sdl_draw_polygon(body_get_polygon(body), *body_get_color(body), vertical_offset);
-    list_free(shape);
   }
   if (aux != NULL) {
   body_t *body = aux;
@@ -283,37 +1053,89 @@ void sdl_render_scene(scene_t *scene, void *aux, double vertical_offset) {
 void sdl_on_key(key_handler_t handler) { key_handler = handler; }
 
 double time_since_last_tick(void) {
-  clock_t now = clock();
-  double difference = last_clock
-                          ? (double)(now - last_clock) / CLOCKS_PER_SEC
-                          : 0.0; // return 0 the first time this is called
-  last_clock = now;
-  return difference;
+  return frame_timer_tick(sdl_get_frame_timer());
 }
 
-void get_body_bounding_box(body_t *body, SDL_Rect *bounding_box, double vertical_offset) {
-  list_t *points = body_get_shape(body);
-  vector_t window_center = get_window_center();
+frame_timer_t *sdl_get_frame_timer(void) {
+  assert(tick_timer != NULL);
+  return tick_timer;
+}
 
-  double min_x = __DBL_MAX__, max_x = -__DBL_MAX__;
-  double min_y = __DBL_MAX__, max_y = -__DBL_MAX__;
+void sdl_quit(void) {
+  sdl_clear_text_cache();
+  free(batch.vertices);
+  free(batch.indices);
+  batch = (sprite_batch_t){0};
+  frame_timer_free(tick_timer);
+  tick_timer = NULL;
 
-  for (size_t i = 0; i < list_size(points); i++) {
-    vector_t *point = list_get(points, i);
-    vector_t sdl_point = get_window_position(*point, window_center, vertical_offset);
+  Mix_CloseAudio();
+  TTF_Quit();
+  SDL_DestroyRenderer(renderer);
+  renderer = NULL;
+  if (window != NULL) {
+    SDL_DestroyWindow(window);
+    window = NULL;
+  }
+  if (headless_surface != NULL) {
+    SDL_FreeSurface(headless_surface);
+    headless_surface = NULL;
+  }
+  SDL_Quit();
+}
+
+void sdl_get_view_bounds(double vertical_offset, vector_t *min,
+                         vector_t *max) {
+  vector_t half_view = vec_multiply(1 / viewport.scale, viewport.window_center);
+  vector_t view_center = {center.x, center.y + vertical_offset};
+  *min = vec_subtract(view_center, half_view);
+  *max = vec_add(view_center, half_view);
+}
+
+double sdl_get_scene_scale(void) { return viewport.scale; }
+
+bool sdl_in_view(vector_t min, vector_t max, double vertical_offset,
+                 double margin) {
+  vector_t view_min, view_max;
+  sdl_get_view_bounds(vertical_offset, &view_min, &view_max);
+
+  return max.x >= view_min.x - margin && min.x <= view_max.x + margin &&
+         max.y >= view_min.y - margin && min.y <= view_max.y + margin;
+}
 
-    if (sdl_point.x < min_x)
-      min_x = sdl_point.x;
-    if (sdl_point.x > max_x)
-      max_x = sdl_point.x;
-    if (sdl_point.y < min_y)
-      min_y = sdl_point.y;
-    if (sdl_point.y > max_y)
-      max_y = sdl_point.y;
+SDL_Texture *sdl_create_render_target(void) {
+  int width = 2 * viewport.window_center.x;
+  int height = 2 * viewport.window_center.y;
+  SDL_Texture *target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+                                          SDL_TEXTUREACCESS_TARGET, width,
+                                          height);
+  assert(target != NULL);
+  SDL_SetTextureBlendMode(target, SDL_BLENDMODE_BLEND);
+  return target;
+}
+
+void sdl_set_render_target(SDL_Texture *target) {
+  sdl_batch_flush();
+  SDL_SetRenderTarget(renderer, target);
+  if (target != NULL) {
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
   }
+}
+
+void get_body_bounding_box(body_t *body, SDL_Rect *bounding_box, double vertical_offset) {
+  vector_t min, max;
+  body_get_bounds(body, &min, &max);
+  vector_t window_center = get_window_center();
+
+  // The y axis is flipped, so the top left corner comes from max.y
+  vector_t top_left = get_window_position((vector_t){min.x, max.y},
+                                          window_center, vertical_offset);
+  vector_t bottom_right = get_window_position((vector_t){max.x, min.y},
+                                              window_center, vertical_offset);
 
-  bounding_box->x = (int)min_x;
-  bounding_box->y = (int)min_y;
-  bounding_box->w = (int)(max_x - min_x);
-  bounding_box->h = (int)(max_y - min_y);
+  bounding_box->x = (int)top_left.x;
+  bounding_box->y = (int)top_left.y;
+  bounding_box->w = (int)(bottom_right.x - top_left.x);
+  bounding_box->h = (int)(bottom_right.y - top_left.y);
 }
@@ -0,0 +1,338 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sound_stream.h"
+
+#define ALLOC_TAG ALLOC_AUDIO
+#include "alloc.h"
+
+// How much of the sound is read and converted at a time, in bytes
+const size_t STREAM_BLOCK_BYTES = 4096;
+// The size of the silent chunk that keeps a stream's channel playing
+const size_t STREAM_CARRIER_BYTES = 8192;
+
+// Format tags and sizes from the "fmt " chunk of a WAV file
+const Uint16 WAV_PCM = 0x0001;
+const Uint16 WAV_FLOAT = 0x0003;
+const Uint16 WAV_EXTENSIBLE = 0xFFFE;
+const Uint32 WAV_FMT_SIZE = 16;
+const Uint32 WAV_EXTENSIBLE_FMT_SIZE = 40;
+// The bytes between the end of a plain "fmt " chunk and the format tag of
+// an extensible one: the extension size, valid bits and channel mask
+const Sint64 WAV_SUBFORMAT_OFFSET = 8;
+
+/**
+ * The mixer doesn't let a callback feed a channel, so a stream plays a silent
+ * carrier chunk on its channel, with an effect that replaces the silence
+ * with the converted sound as the mixer asks for it.
+ */
+typedef struct sound_stream {
+  SDL_RWops *source;
+  // Where the samples start in the source, and how many bytes of them
+  Sint64 data_start;
+  size_t data_size;
+  // How many bytes of the samples have been read since the last rewind
+  size_t position;
+  size_t in_frame_bytes;
+  // Converts the samples to the mixer's format
+  SDL_AudioStream *converter;
+  // How long one play of the sound is once converted
+  uint64_t out_bytes;
+  Uint8 silence;
+
+  Uint8 *carrier_samples;
+  Mix_Chunk *carrier;
+  // The channel playing the stream, or -1. The mixer clears it on the audio
+  // thread when the channel stops, so it is only accessed atomically
+  SDL_atomic_t channel;
+  // Only used on the audio thread while playing
+  int loops_left;
+  bool flushed;
+  Uint8 *block;
+} sound_stream_t;
+
+/**
+ * Gets the SDL audio format for a WAV format tag and sample size, or 0 if it
+ * isn't supported.
+ */
+static SDL_AudioFormat sound_stream_wav_format(Uint16 tag, Uint16 bits) {
+  if (tag == WAV_PCM) {
+    switch (bits) {
+    case 8:
+      return AUDIO_U8;
+    case 16:
+      return AUDIO_S16LSB;
+    case 32:
+      return AUDIO_S32LSB;
+    }
+  } else if (tag == WAV_FLOAT && bits == 32) {
+    return AUDIO_F32LSB;
+  }
+  return 0;
+}
+
+/**
+ * Makes a stream over the samples in a source. On failure, the caller still
+ * owns the source.
+ */
+static sound_stream_t *sound_stream_init(SDL_RWops *source, Sint64 data_start,
+                                         size_t data_size,
+                                         SDL_AudioFormat format, int frequency,
+                                         int channels) {
+  int out_frequency, out_channels;
+  Uint16 out_format;
+  if (Mix_QuerySpec(&out_frequency, &out_format, &out_channels) == 0 ||
+      format == 0 || frequency <= 0 || channels <= 0) {
+    return NULL;
+  }
+  SDL_AudioStream *converter =
+      SDL_NewAudioStream(format, channels, frequency, out_format,
+                         out_channels, out_frequency);
+  if (converter == NULL) {
+    return NULL;
+  }
+
+  sound_stream_t *stream = malloc(sizeof(sound_stream_t));
+  assert(stream);
+  stream->source = source;
+  stream->data_start = data_start;
+  stream->in_frame_bytes = SDL_AUDIO_BITSIZE(format) / 8 * channels;
+  stream->data_size = data_size - data_size % stream->in_frame_bytes;
+  stream->position = 0;
+  stream->converter = converter;
+  size_t out_frame_bytes = SDL_AUDIO_BITSIZE(out_format) / 8 * out_channels;
+  uint64_t frames = stream->data_size / stream->in_frame_bytes;
+  stream->out_bytes = frames * out_frequency / frequency * out_frame_bytes;
+  stream->silence = SDL_AUDIO_ISSIGNED(out_format) ? 0 : 0x80;
+
+  size_t carrier_size =
+      STREAM_CARRIER_BYTES - STREAM_CARRIER_BYTES % out_frame_bytes;
+  stream->carrier_samples = malloc(carrier_size);
+  assert(stream->carrier_samples);
+  memset(stream->carrier_samples, stream->silence, carrier_size);
+  stream->carrier = Mix_QuickLoad_RAW(stream->carrier_samples, carrier_size);
+  assert(stream->carrier);
+
+  SDL_AtomicSet(&stream->channel, -1);
+  stream->loops_left = 0;
+  stream->flushed = false;
+  stream->block = malloc(STREAM_BLOCK_BYTES);
+  assert(stream->block);
+  return stream;
+}
+
+sound_stream_t *sound_stream_open(const char *filepath) {
+  SDL_RWops *file = SDL_RWFromFile(filepath, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  char id[4];
+  if (SDL_RWread(file, id, sizeof(id), 1) != 1 ||
+      memcmp(id, "RIFF", sizeof(id)) != 0) {
+    SDL_RWclose(file);
+    return NULL;
+  }
+  SDL_ReadLE32(file); // the size of the rest of the file
+  if (SDL_RWread(file, id, sizeof(id), 1) != 1 ||
+      memcmp(id, "WAVE", sizeof(id)) != 0) {
+    SDL_RWclose(file);
+    return NULL;
+  }
+
+  // Walks the chunks until the samples, skipping any it doesn't need
+  SDL_AudioFormat format = 0;
+  int frequency = 0, channels = 0;
+  while (SDL_RWread(file, id, sizeof(id), 1) == 1) {
+    Uint32 size = SDL_ReadLE32(file);
+    Sint64 start = SDL_RWtell(file);
+    if (memcmp(id, "fmt ", sizeof(id)) == 0 && size >= WAV_FMT_SIZE) {
+      Uint16 tag = SDL_ReadLE16(file);
+      channels = SDL_ReadLE16(file);
+      frequency = SDL_ReadLE32(file);
+      SDL_ReadLE32(file); // bytes per second
+      SDL_ReadLE16(file); // bytes per frame
+      Uint16 bits = SDL_ReadLE16(file);
+      if (tag == WAV_EXTENSIBLE && size >= WAV_EXTENSIBLE_FMT_SIZE) {
+        SDL_RWseek(file, WAV_SUBFORMAT_OFFSET, RW_SEEK_CUR);
+        tag = SDL_ReadLE16(file);
+      }
+      format = sound_stream_wav_format(tag, bits);
+    } else if (memcmp(id, "data", sizeof(id)) == 0) {
+      // Some writers leave the size unset, so trust the file's length
+      Sint64 file_size = SDL_RWsize(file);
+      if (file_size >= start && (Sint64)size > file_size - start) {
+        size = file_size - start;
+      }
+      sound_stream_t *stream =
+          sound_stream_init(file, start, size, format, frequency, channels);
+      if (stream == NULL) {
+        SDL_RWclose(file);
+      }
+      return stream;
+    }
+    // Chunks are padded to an even size
+    if (SDL_RWseek(file, start + size + (size & 1), RW_SEEK_SET) < 0) {
+      break;
+    }
+  }
+  SDL_RWclose(file);
+  return NULL;
+}
+
+sound_stream_t *sound_stream_open_raw(const void *samples, size_t size,
+                                      SDL_AudioFormat format, int frequency,
+                                      int channels) {
+  SDL_RWops *memory = SDL_RWFromConstMem(samples, size);
+  if (memory == NULL) {
+    return NULL;
+  }
+  sound_stream_t *stream =
+      sound_stream_init(memory, 0, size, format, frequency, channels);
+  if (stream == NULL) {
+    SDL_RWclose(memory);
+  }
+  return stream;
+}
+
+void sound_stream_close(sound_stream_t *stream) {
+  sound_stream_stop(stream);
+  Mix_FreeChunk(stream->carrier);
+  free(stream->carrier_samples);
+  SDL_FreeAudioStream(stream->converter);
+  SDL_RWclose(stream->source);
+  free(stream->block);
+  free(stream);
+}
+
+/**
+ * Goes back to the start of the samples.
+ */
+static bool sound_stream_rewind(sound_stream_t *stream) {
+  stream->position = 0;
+  return SDL_RWseek(stream->source, stream->data_start, RW_SEEK_SET) >= 0;
+}
+
+/**
+ * Reads the next block of samples into the converter, looping back to the
+ * start or flushing the converter at the end of the samples.
+ *
+ * @return false once there is nothing left to convert
+ */
+static bool sound_stream_feed(sound_stream_t *stream) {
+  if (stream->position == stream->data_size) {
+    if (stream->loops_left == 0) {
+      if (stream->flushed) {
+        return false;
+      }
+      // Lets the converter give up the samples it is holding back
+      SDL_AudioStreamFlush(stream->converter);
+      stream->flushed = true;
+      return true;
+    }
+    if (stream->loops_left > 0) {
+      stream->loops_left--;
+    }
+    if (!sound_stream_rewind(stream)) {
+      return false;
+    }
+  }
+
+  size_t bytes = stream->data_size - stream->position;
+  if (bytes > STREAM_BLOCK_BYTES) {
+    bytes = STREAM_BLOCK_BYTES;
+  }
+  size_t frames = bytes / stream->in_frame_bytes;
+  size_t read = SDL_RWread(stream->source, stream->block,
+                           stream->in_frame_bytes, frames);
+  if (read == 0) {
+    return false;
+  }
+  stream->position += read * stream->in_frame_bytes;
+  return SDL_AudioStreamPut(stream->converter, stream->block,
+                            read * stream->in_frame_bytes) == 0;
+}
+
+/**
+ * The effect on a stream's channel, run on the audio thread: replaces the
+ * carrier's silence with the next converted samples.
+ */
+static void sound_stream_fill(int channel, void *buffer, int length,
+                              void *aux) {
+  sound_stream_t *stream = aux;
+  Uint8 *out = buffer;
+  int filled = 0;
+  while (filled < length) {
+    int got =
+        SDL_AudioStreamGet(stream->converter, out + filled, length - filled);
+    if (got > 0) {
+      filled += got;
+    } else if (got < 0 || !sound_stream_feed(stream)) {
+      break;
+    }
+  }
+  memset(out + filled, stream->silence, length - filled);
+}
+
+/**
+ * Called by the mixer when a stream's channel stops playing.
+ */
+static void sound_stream_done(int channel, void *aux) {
+  sound_stream_t *stream = aux;
+  SDL_AtomicSet(&stream->channel, -1);
+}
+
+int sound_stream_play(sound_stream_t *stream, int channel, int loops) {
+  sound_stream_stop(stream);
+  if (!sound_stream_rewind(stream)) {
+    return -1;
+  }
+  SDL_AudioStreamClear(stream->converter);
+  stream->loops_left = loops;
+  stream->flushed = false;
+
+  // Plays the carrier for as long as the sound lasts once converted
+  int carrier_loops = -1;
+  if (loops >= 0) {
+    uint64_t total = stream->out_bytes * (loops + 1);
+    uint64_t plays = (total + stream->carrier->alen - 1) / stream->carrier->alen;
+    carrier_loops = plays <= 1 ? 0 : plays - 1 > INT_MAX ? INT_MAX : plays - 1;
+  }
+
+  // The effect has to be registered before the carrier starts, and playing
+  // on a busy channel would unregister it, so the channel is freed first
+  if (channel < 0) {
+    channel = Mix_GroupAvailable(-1);
+    if (channel < 0) {
+      return -1;
+    }
+  } else {
+    Mix_HaltChannel(channel);
+  }
+  SDL_AtomicSet(&stream->channel, channel);
+  if (Mix_RegisterEffect(channel, sound_stream_fill, sound_stream_done,
+                         stream) == 0) {
+    SDL_AtomicSet(&stream->channel, -1);
+    return -1;
+  }
+  if (Mix_PlayChannel(channel, stream->carrier, carrier_loops) < 0) {
+    Mix_UnregisterEffect(channel, sound_stream_fill);
+    SDL_AtomicSet(&stream->channel, -1);
+    return -1;
+  }
+  return channel;
+}
+
+void sound_stream_stop(sound_stream_t *stream) {
+  int channel = SDL_AtomicGet(&stream->channel);
+  if (channel >= 0) {
+    // Halting the channel unregisters the effect, which resets the channel
+    Mix_HaltChannel(channel);
+  }
+}
+
+bool sound_stream_playing(sound_stream_t *stream) {
+  return SDL_AtomicGet(&stream->channel) >= 0;
+}
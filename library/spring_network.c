@@ -0,0 +1,327 @@
+#include "spring_network.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#define ALLOC_TAG ALLOC_PHYSICS
+#include "alloc.h"
+
+const size_t SPRING_GROWTH_FACTOR = 2;
+const size_t SPRING_DEFAULT_ITERATIONS = 4;
+
+struct spring_network {
+  spring_mode_t mode;
+  size_t iterations;
+
+  // Bodies the springs are attached to, plus per-body scratch arrays that are
+  // gathered from the bodies at the start of every step
+  body_t **bodies;
+  double *pos_x;
+  double *pos_y;
+  double *inv_mass;
+  double *corr_x; // position correction (XPBD) or impulse (explicit)
+  double *corr_y;
+  size_t num_bodies;
+  size_t body_capacity;
+
+  // Springs, as indices into the body arrays
+  size_t *body1;
+  size_t *body2;
+  double *stiffness;
+  double *rest_length;
+  double *lambda; // accumulated XPBD multiplier for the current step
+  size_t num_springs;
+  size_t spring_capacity;
+};
+
+/**
+ * Resizes an array to hold the given number of elements.
+ * Asserts that the resize succeeded.
+ *
+ * @param array the array to resize, which may be NULL
+ * @param elem_size the size of each element
+ * @param capacity the number of elements the array should hold
+ * @return the resized array
+ */
+static void *resize_array(void *array, size_t elem_size, size_t capacity) {
+  void *resized = realloc(array, elem_size * capacity);
+  assert(resized);
+  return resized;
+}
+
+static void reserve_bodies(spring_network_t *network, size_t capacity) {
+  network->bodies =
+      resize_array(network->bodies, sizeof(body_t *), capacity);
+  network->pos_x = resize_array(network->pos_x, sizeof(double), capacity);
+  network->pos_y = resize_array(network->pos_y, sizeof(double), capacity);
+  network->inv_mass =
+      resize_array(network->inv_mass, sizeof(double), capacity);
+  network->corr_x = resize_array(network->corr_x, sizeof(double), capacity);
+  network->corr_y = resize_array(network->corr_y, sizeof(double), capacity);
+  network->body_capacity = capacity;
+}
+
+static void reserve_springs(spring_network_t *network, size_t capacity) {
+  network->body1 = resize_array(network->body1, sizeof(size_t), capacity);
+  network->body2 = resize_array(network->body2, sizeof(size_t), capacity);
+  network->stiffness =
+      resize_array(network->stiffness, sizeof(double), capacity);
+  network->rest_length =
+      resize_array(network->rest_length, sizeof(double), capacity);
+  network->lambda = resize_array(network->lambda, sizeof(double), capacity);
+  network->spring_capacity = capacity;
+}
+
+spring_network_t *spring_network_init(spring_mode_t mode,
+                                      size_t initial_capacity) {
+  spring_network_t *network = calloc(1, sizeof(spring_network_t));
+  assert(network);
+
+  if (initial_capacity == 0) {
+    initial_capacity = 1;
+  }
+  network->mode = mode;
+  network->iterations = SPRING_DEFAULT_ITERATIONS;
+  reserve_bodies(network, initial_capacity);
+  reserve_springs(network, initial_capacity);
+  return network;
+}
+
+void spring_network_free(spring_network_t *network) {
+  if (network == NULL) {
+    return;
+  }
+  free(network->bodies);
+  free(network->pos_x);
+  free(network->pos_y);
+  free(network->inv_mass);
+  free(network->corr_x);
+  free(network->corr_y);
+  free(network->body1);
+  free(network->body2);
+  free(network->stiffness);
+  free(network->rest_length);
+  free(network->lambda);
+  free(network);
+}
+
+/**
+ * Returns the index of a body in the network's body arrays,
+ * adding the body if the network doesn't reference it yet.
+ */
+static size_t spring_network_body_index(spring_network_t *network,
+                                        body_t *body) {
+  for (size_t i = 0; i < network->num_bodies; i++) {
+    if (network->bodies[i] == body) {
+      return i;
+    }
+  }
+
+  if (network->num_bodies >= network->body_capacity) {
+    reserve_bodies(network, network->body_capacity * SPRING_GROWTH_FACTOR);
+  }
+  network->bodies[network->num_bodies] = body;
+  return network->num_bodies++;
+}
+
+void spring_network_add(spring_network_t *network, body_t *body1,
+                        body_t *body2, double k, double rest_length) {
+  assert(body1 != NULL && body2 != NULL && body1 != body2);
+  assert(k > 0);
+  assert(network->mode == SPRING_XPBD || isfinite(k));
+
+  if (network->num_springs >= network->spring_capacity) {
+    reserve_springs(network, network->spring_capacity * SPRING_GROWTH_FACTOR);
+  }
+
+  size_t idx = network->num_springs;
+  network->body1[idx] = spring_network_body_index(network, body1);
+  network->body2[idx] = spring_network_body_index(network, body2);
+  network->stiffness[idx] = k;
+  network->rest_length[idx] = rest_length;
+  network->lambda[idx] = 0;
+  network->num_springs++;
+}
+
+size_t spring_network_size(spring_network_t *network) {
+  return network->num_springs;
+}
+
+void spring_network_set_iterations(spring_network_t *network,
+                                   size_t iterations) {
+  assert(iterations > 0);
+  network->iterations = iterations;
+}
+
+/**
+ * Drops every spring attached to a removed body, then compacts the body
+ * arrays. This must run before the removed bodies are freed by the scene.
+ */
+static void spring_network_prune(spring_network_t *network) {
+  bool any_removed = false;
+  for (size_t i = 0; i < network->num_bodies; i++) {
+    if (body_is_removed(network->bodies[i])) {
+      any_removed = true;
+      break;
+    }
+  }
+  if (!any_removed) {
+    return;
+  }
+
+  // Swap-remove the springs whose bodies are going away
+  size_t s = 0;
+  while (s < network->num_springs) {
+    if (body_is_removed(network->bodies[network->body1[s]]) ||
+        body_is_removed(network->bodies[network->body2[s]])) {
+      size_t last = --network->num_springs;
+      network->body1[s] = network->body1[last];
+      network->body2[s] = network->body2[last];
+      network->stiffness[s] = network->stiffness[last];
+      network->rest_length[s] = network->rest_length[last];
+    } else {
+      s++;
+    }
+  }
+
+  // Compact the live bodies, reusing corr_x to remember their new indices
+  size_t live = 0;
+  for (size_t i = 0; i < network->num_bodies; i++) {
+    if (!body_is_removed(network->bodies[i])) {
+      network->bodies[live] = network->bodies[i];
+      network->corr_x[i] = live;
+      live++;
+    }
+  }
+  network->num_bodies = live;
+  for (size_t i = 0; i < network->num_springs; i++) {
+    network->body1[i] = (size_t)network->corr_x[network->body1[i]];
+    network->body2[i] = (size_t)network->corr_x[network->body2[i]];
+  }
+}
+
+/**
+ * Accumulates the Hooke's-law impulse of every spring over the tick.
+ */
+static void spring_network_explicit(spring_network_t *network, double dt) {
+  const double *pos_x = network->pos_x, *pos_y = network->pos_y;
+  double *imp_x = network->corr_x, *imp_y = network->corr_y;
+
+  for (size_t s = 0; s < network->num_springs; s++) {
+    size_t a = network->body1[s], b = network->body2[s];
+    double dx = pos_x[b] - pos_x[a];
+    double dy = pos_y[b] - pos_y[a];
+    double length = sqrt(dx * dx + dy * dy);
+    if (length == 0) {
+      continue;
+    }
+
+    // Impulse on body1 along the spring, towards body2 when stretched
+    double scale = network->stiffness[s] *
+                   (length - network->rest_length[s]) * dt / length;
+    imp_x[a] += scale * dx;
+    imp_y[a] += scale * dy;
+    imp_x[b] -= scale * dx;
+    imp_y[b] -= scale * dy;
+  }
+}
+
+/**
+ * Projects the ticked positions onto the springs with a Gauss-Seidel sweep
+ * per iteration. Compliance is the inverse of stiffness, scaled by 1 / dt^2,
+ * so a stiff spring converges instead of overshooting.
+ */
+static void spring_network_xpbd(spring_network_t *network, double dt) {
+  const double *pos_x = network->pos_x, *pos_y = network->pos_y;
+  const double *inv_mass = network->inv_mass;
+  double *corr_x = network->corr_x, *corr_y = network->corr_y;
+  double *lambda = network->lambda;
+
+  for (size_t s = 0; s < network->num_springs; s++) {
+    lambda[s] = 0;
+  }
+
+  for (size_t iter = 0; iter < network->iterations; iter++) {
+    for (size_t s = 0; s < network->num_springs; s++) {
+      size_t a = network->body1[s], b = network->body2[s];
+      double dx = (pos_x[a] + corr_x[a]) - (pos_x[b] + corr_x[b]);
+      double dy = (pos_y[a] + corr_y[a]) - (pos_y[b] + corr_y[b]);
+      double length = sqrt(dx * dx + dy * dy);
+      double alpha = 1 / (network->stiffness[s] * dt * dt);
+      double denom = inv_mass[a] + inv_mass[b] + alpha;
+      if (length == 0 || denom == 0) {
+        continue;
+      }
+
+      double c = length - network->rest_length[s];
+      double d_lambda = (-c - alpha * lambda[s]) / denom;
+      lambda[s] += d_lambda;
+
+      double nx = dx / length, ny = dy / length;
+      corr_x[a] += inv_mass[a] * d_lambda * nx;
+      corr_y[a] += inv_mass[a] * d_lambda * ny;
+      corr_x[b] -= inv_mass[b] * d_lambda * nx;
+      corr_y[b] -= inv_mass[b] * d_lambda * ny;
+    }
+  }
+}
+
+void spring_network_step(spring_network_t *network, double dt) {
+  spring_network_prune(network);
+  if (network->num_springs == 0 || dt <= 0) {
+    return;
+  }
+
+  // Gather body state into the parallel arrays
+  for (size_t i = 0; i < network->num_bodies; i++) {
+    body_t *body = network->bodies[i];
+    vector_t centroid = body_get_centroid(body);
+    double mass = body_get_mass(body);
+    network->pos_x[i] = centroid.x;
+    network->pos_y[i] = centroid.y;
+    network->inv_mass[i] = mass == INFINITY ? 0 : 1 / mass;
+    network->corr_x[i] = 0;
+    network->corr_y[i] = 0;
+  }
+
+  if (network->mode == SPRING_EXPLICIT) {
+    spring_network_explicit(network, dt);
+  } else {
+    spring_network_xpbd(network, dt);
+  }
+
+  // Scatter the results back onto the movable bodies
+  for (size_t i = 0; i < network->num_bodies; i++) {
+    vector_t corr = {network->corr_x[i], network->corr_y[i]};
+    if (network->inv_mass[i] == 0 || vec_cmp(corr, VEC_ZERO)) {
+      continue;
+    }
+
+    body_t *body = network->bodies[i];
+    if (network->mode == SPRING_EXPLICIT) {
+      // Applied on the next body_tick(), like a force creator's force
+      body_add_impulse(body, corr);
+    } else {
+      vector_t pos = {network->pos_x[i], network->pos_y[i]};
+      body_set_centroid(body, vec_add(pos, corr));
+      body_set_velocity(body, vec_add(body_get_velocity(body),
+                                      vec_multiply(1 / dt, corr)));
+    }
+  }
+}
+
+/**
+ * The constraint solver for spring networks registered with a scene.
+ *
+ * @param network the spring network to step
+ * @param dt the number of seconds elapsed over the tick
+ */
+static void spring_network_solver(void *network, double dt) {
+  spring_network_step(network, dt);
+}
+
+void create_spring_network(scene_t *scene, spring_network_t *network) {
+  scene_add_constraint_solver(scene, spring_network_solver, network,
+                              (free_func_t)spring_network_free);
+}
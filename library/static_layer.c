@@ -0,0 +1,140 @@
+#include "static_layer.h"
+#include "sdl_wrapper.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#define ALLOC_TAG ALLOC_RENDER
+#include "alloc.h"
+
+const size_t STATIC_LAYER_INITIAL_ASSETS = 16;
+
+struct static_layer {
+  list_t *assets;
+
+  // Window-sized textures, each showing the world as the camera would at
+  // chunk_offsets[i]; they are stacked one view height apart
+  SDL_Texture **chunks;
+  double *chunk_offsets;
+  size_t num_chunks;
+  double view_height;
+
+  // The scale the chunks were drawn at, to notice when the window is resized
+  double scale;
+  bool dirty;
+};
+
+static_layer_t *static_layer_init(void) {
+  static_layer_t *layer = malloc(sizeof(static_layer_t));
+  assert(layer);
+
+  layer->assets =
+      list_init(STATIC_LAYER_INITIAL_ASSETS, (free_func_t)asset_destroy);
+  layer->chunks = NULL;
+  layer->chunk_offsets = NULL;
+  layer->num_chunks = 0;
+  layer->view_height = 0;
+  layer->scale = 0;
+  layer->dirty = true;
+  return layer;
+}
+
+/**
+ * Destroys the cached textures of a layer.
+ */
+static void static_layer_free_chunks(static_layer_t *layer) {
+  for (size_t i = 0; i < layer->num_chunks; i++) {
+    SDL_DestroyTexture(layer->chunks[i]);
+  }
+  free(layer->chunks);
+  free(layer->chunk_offsets);
+  layer->chunks = NULL;
+  layer->chunk_offsets = NULL;
+  layer->num_chunks = 0;
+}
+
+void static_layer_free(static_layer_t *layer) {
+  static_layer_free_chunks(layer);
+  list_free(layer->assets);
+  free(layer);
+}
+
+void static_layer_add(static_layer_t *layer, asset_t *asset) {
+  assert(asset_get_body(asset) != NULL);
+  list_add(layer->assets, asset);
+  layer->dirty = true;
+}
+
+size_t static_layer_num_chunks(static_layer_t *layer) {
+  return layer->num_chunks;
+}
+
+/**
+ * Redraws the textures of a layer so that together they cover every asset.
+ */
+static void static_layer_rebuild(static_layer_t *layer) {
+  static_layer_free_chunks(layer);
+  layer->scale = sdl_get_scene_scale();
+  layer->dirty = false;
+
+  size_t num_assets = list_size(layer->assets);
+  if (num_assets == 0) {
+    return;
+  }
+
+  // Find the vertical extent of the world
+  double min_y = INFINITY, max_y = -INFINITY;
+  for (size_t i = 0; i < num_assets; i++) {
+    vector_t body_min, body_max;
+    body_get_bounds(asset_get_body(list_get(layer->assets, i)), &body_min,
+                    &body_max);
+    min_y = fmin(min_y, body_min.y);
+    max_y = fmax(max_y, body_max.y);
+  }
+
+  // The first chunk's view has its bottom edge at the bottom of the world
+  vector_t view_min, view_max;
+  sdl_get_view_bounds(0, &view_min, &view_max);
+  layer->view_height = view_max.y - view_min.y;
+  double first_offset = min_y - view_min.y;
+
+  size_t num_chunks = ceil((max_y - min_y) / layer->view_height);
+  num_chunks = num_chunks > 0 ? num_chunks : 1;
+  layer->chunks = malloc(num_chunks * sizeof(SDL_Texture *));
+  layer->chunk_offsets = malloc(num_chunks * sizeof(double));
+  assert(layer->chunks);
+  assert(layer->chunk_offsets);
+  layer->num_chunks = num_chunks;
+
+  for (size_t i = 0; i < num_chunks; i++) {
+    double offset = first_offset + i * layer->view_height;
+    layer->chunk_offsets[i] = offset;
+    layer->chunks[i] = sdl_create_render_target();
+    sdl_set_render_target(layer->chunks[i]);
+    for (size_t j = 0; j < num_assets; j++) {
+      asset_render(list_get(layer->assets, j), offset);
+    }
+  }
+  sdl_set_render_target(NULL);
+}
+
+void static_layer_prepare(static_layer_t *layer) {
+  if (layer->dirty || layer->scale != sdl_get_scene_scale()) {
+    static_layer_rebuild(layer);
+  }
+}
+
+void static_layer_render(static_layer_t *layer, double vertical_offset) {
+  for (size_t i = 0; i < layer->num_chunks; i++) {
+    // How far the camera is above the chunk's view, in scene units
+    double distance = vertical_offset - layer->chunk_offsets[i];
+    if (fabs(distance) >= layer->view_height) {
+      continue;
+    }
+
+    SDL_Rect dest = {0, (int)round(distance * layer->scale), 0, 0};
+    SDL_QueryTexture(layer->chunks[i], NULL, NULL, &dest.w, &dest.h);
+    sdl_batch_draw(layer->chunks[i], NULL, dest);
+  }
+}